@@ -4,10 +4,14 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include "ring.h"
+#include "convert.h"
 
-// Ring buffer size: ~3 seconds at 48000Hz stereo (16-bit)
-#define RING_BUFFER_FRAMES  (48000 * 3)
-#define RING_BUFFER_SAMPLES (RING_BUFFER_FRAMES * 2)  // stereo
+// Ring buffer size: ~2.7 seconds at 48000Hz stereo (16-bit).
+// Must be a power of two for the lock-free ring's index masking.
+#define RING_BUFFER_SAMPLES (1 << 18)
+#define RING_BUFFER_FRAMES  (RING_BUFFER_SAMPLES / 2)  // stereo
 
 typedef enum {
     AUDIO_FORMAT_UNKNOWN,
@@ -18,42 +22,62 @@ typedef enum {
 typedef struct {
     // Audio properties
     uint32_t sample_rate;
-    uint16_t channels;
+    uint16_t channels;        // Channels delivered by audio_read() (1 or 2)
     size_t total_frames;      // Total frames in file (0 if unknown/streaming)
 
-    // Ring buffer for streaming
-    int16_t *ring_buffer;
-    size_t ring_size;         // Total size in samples
-    volatile size_t write_pos; // Producer position (decoder thread)
-    volatile size_t read_pos;  // Consumer position (audio thread)
-    volatile int finished;     // Decoder has finished
-    volatile int error;        // Error occurred
+    // Lock-free ring for streaming (decoder -> audio thread)
+    SpscRing ring;
+    atomic_int finished;      // Decoder has finished
+    atomic_int error;         // Error occurred (also used to stop decoder)
 
     // Threading
     pthread_t decoder_thread;
-    pthread_mutex_t mutex;
-    pthread_cond_t cond_space;  // Signal when space available
-    pthread_cond_t cond_data;   // Signal when data available
     int thread_running;
 
     // Format-specific handles
     AudioFormat format;
     void *decoder_handle;     // mpg123_handle* for MP3
+    int from_cache;           // MP3 served from the decoded-PCM cache
+    int preloaded;            // MP3 fully decoded up front (parallel preload)
+    struct PcmCacheWriter *cache_writer;  // Decoder tees PCM here on a miss
+    int indexed;              // MP3: full frame index loaded (seeks are exact)
+    char path[512];           // Source file (keys the MP3 frame index cache)
 
     // File info (for WAV fallback or file handle)
     int fd;
     void *mapping;            // mmap for WAV
     size_t mapping_size;
-    int16_t *wav_pcm;         // Direct PCM pointer for WAV
-    size_t wav_frames_read;   // Current position for WAV streaming
+    const uint8_t *wav_data;  // PCM data in the mapping (file format)
+    SampleFormat wav_format;  // Sample format of wav_data
+    uint16_t wav_channels;    // Channels in wav_data (mono is upmixed on read)
+    size_t wav_frame_bytes;   // Bytes per frame of wav_data
+    atomic_size_t wav_frames_read;  // Current position for WAV streaming
+    struct ReadAhead *readahead;    // Sliding mlock window (streaming WAV)
 } AudioStream;
 
 // Open audio file (detects format by extension)
 AudioStream *audio_open(const char *filename);
 
+// Stream WAVs through a locked window of this many seconds instead of
+// mlocking the whole file (0 = lock whole file, the default)
+void audio_set_wav_window(double seconds);
+
+// Bytes of WAV data held locked at peak (whole file without a window)
+size_t audio_peak_locked_bytes(const AudioStream *stream);
+
+// Decode MP3s completely on this many worker threads at open time and
+// play them from memory like a WAV (0 = stream through the decoder thread)
+void audio_set_preload_workers(int workers);
+
 // Start decoder thread (for MP3) or prepare WAV
 int audio_start(AudioStream *stream);
 
+// Position the stream at a song frame before audio_start(): a WAV (or
+// cached/preloaded MP3) by frame, an MP3 through its frame index, built
+// by one scan of the file and cached for the next seek in the same file.
+// Past the end leaves the stream finished. Returns 0 on success.
+int audio_seek(AudioStream *stream, size_t frame);
+
 // Read samples from stream (called by audio thread)
 // Returns number of frames read, 0 if buffer empty, -1 if finished
 int audio_read(AudioStream *stream, int16_t *buffer, size_t frames);
@@ -67,4 +91,11 @@ size_t audio_available(AudioStream *stream);
 // Close and free stream
 void audio_close(AudioStream *stream);
 
+// "MP3", "WAV", "MP3 (cached)" or "MP3 (preloaded)", for logs and reports
+const char *audio_format_name(const AudioStream *stream);
+
+// Decode an MP3 straight into the PCM cache (no playback).
+// Returns 0 on success.
+int audio_precache(const char *filename);
+
 #endif
@@ -0,0 +1,61 @@
+#ifndef AVCLOCK_H
+#define AVCLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Audio playback clock: where the listener is in the song, as a
+// CLOCK_MONOTONIC mapping the LED thread can schedule against.
+//
+// The audio thread feeds it (song frames handed to ALSA) - snd_pcm_delay()
+// with the time of the query. A second-order PLL smooths those samples
+// (delay granularity is often a DMA burst or a whole period) into
+// song_time = p0 + (now - t0) * rate; rate - 1 is the sound card's drift
+// against the system clock. Steps larger than AVCLOCK_STEP_US (underrun
+// gaps, a held device) relock the phase at once instead of slewing.
+//
+// With the lock on (default) each cue's deadline is read through the
+// clock, so LEDs follow the audio the listener hears, whatever the output
+// latency and however far the card's crystal wanders over a long song.
+
+#define AVCLOCK_TAU_SEC          2.0     // PLL time constant
+#define AVCLOCK_STEP_US          20000   // Larger errors relock the phase
+#define AVCLOCK_MAX_PPM          1000    // Rate clamp
+#define AVCLOCK_LOCK_TIMEOUT_MS  2000    // LED thread waits this long for audio
+
+typedef struct {
+    int locked;                 // LED timeline ran on the audio clock
+    uint64_t observations;
+    unsigned int relocks;       // Phase steps after the first lock
+    double drift_ppm;           // Audio clock vs CLOCK_MONOTONIC since the last relock
+    double pll_ppm;             // Loop rate at song end
+    double residual_rms_us;     // Raw samples vs the smoothed clock
+    double residual_max_us;
+    uint64_t offsets;           // LED commits measured
+    double offset_avg_us;       // LED commit vs audio position (+ = LED late)
+    double offset_max_us;       // Largest absolute offset
+} AvClockStats;
+
+// --free-run turns the lock off; the clock is still measured and reported
+void avclock_set_lock(int enabled);
+int avclock_lock_enabled(void);
+
+// Per song: device rate of the audio, or 0 for an LED-only song
+void avclock_song_start(unsigned int device_rate);
+int avclock_active(void);
+
+// Audio thread (RT-safe: no allocation, no locking, no I/O)
+void avclock_observe(struct timespec now, int64_t played_frames);
+// Song frames skipped (> 0) or repeated (< 0) on the way to ALSA: moves
+// the clock at once; later observations count them in played_frames
+void avclock_slip(int64_t frames);
+
+// LED thread
+int avclock_locked(void);
+struct timespec avclock_deadline(uint64_t song_us);   // When the audio reaches song_us
+double avclock_position_us(struct timespec when);      // Song time played at 'when'
+void avclock_note_commit(uint64_t song_us, struct timespec when);
+
+void avclock_get_stats(AvClockStats *stats, int led_locked);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Offline benchmarks, run with "-b <name> [arg]".
+// They need neither GPIO nor ALSA, so they also run on a dev box.
+int run_benchmark(const char *name, const char *arg);
+void list_benchmarks(void);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef CALIBRATE_H
+#define CALIBRATE_H
+
+// Output latency calibration (--calibrate) and per-device sync offsets.
+//
+// The audio clock (avclock.h) knows when a frame leaves the ALSA hw
+// pointer; what follows (USB/HDMI pipeline, DAC, amplifier, air) is
+// invisible to it. Calibration plays a click track through setup_alsa(),
+// captures it back (snd-aloop in CI, a microphone on site), finds each
+// click by cross-correlation and compares its arrival with the time the
+// audio clock gave for it. The median is saved per playback device in
+// <musicdir>/latency.cal, and play_song() delays every LED cue by it.
+
+#define CAL_RATE            48000
+#define CAL_CLICKS          16
+#define CAL_LEAD_MS         1000    // Silence before the first click
+#define CAL_INTERVAL_MS     500
+#define CAL_TAIL_MS         1000    // Silence after the last click
+#define CAL_CLICK_MS        10      // Windowed 1-6 kHz chirp
+#define CAL_MAX_LATENCY_MS  400     // Search window after each click
+#define CAL_MIN_CORRELATION 0.3     // Normalized correlation to count a click
+#define CAL_FILE            "latency.cal"
+#define CAL_CAPTURE_DEFAULT "default"
+
+typedef struct {
+    char device[128];       // alsa_device_name() at measurement time
+    long offset_us;         // Median click latency; cues are delayed by it
+    double spread_us;       // 1.4826 * MAD across the detected clicks
+    double correlation;     // Mean normalized correlation of the detected clicks
+    int detected;
+    int clicks;
+    long long when;         // Unix time of the measurement
+} CalResult;
+
+// Measure, print and save the offset of the playback device. Returns 0 on
+// success, -1 when too few clicks came back.
+int calibrate_run(const char *capture_dev);
+
+// Saved result for a device; 0 if found
+int calibration_lookup(const char *device, CalResult *out);
+const char *calibration_path(void);
+
+// "high", "medium" or "low" from clicks found, spread and correlation
+const char *calibration_confidence(const CalResult *r);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Sample-format conversion between audio_read() sources and the sink.
+//
+// Converting ourselves keeps ALSA on its native S16/S32 format, so the
+// plug layer never has to. Kernels use NEON on ARM, SSE2/SSSE3/AVX2 on
+// x86 (whatever the compiler targets), with a scalar fallback.
+
+typedef enum {
+    SAMPLE_S16,       // 16-bit little-endian
+    SAMPLE_S24_3LE,   // 24-bit packed in 3 bytes
+    SAMPLE_S32,       // 32-bit (also WAV 24-in-32, which is MSB-aligned)
+    SAMPLE_FLOAT,     // 32-bit IEEE float, nominal range [-1, 1]
+    SAMPLE_FORMAT_COUNT
+} SampleFormat;
+
+size_t sample_format_bytes(SampleFormat fmt);
+const char *sample_format_name(SampleFormat fmt);
+
+// Convert frames of interleaved src (src_channels: 1 or 2) into dst.
+// dst_fmt is SAMPLE_S16 or SAMPLE_S32; dst_channels is src_channels, or
+// 2 with mono source (upmix by duplication). src and dst must not overlap.
+void convert_frames(void *dst, SampleFormat dst_fmt, unsigned dst_channels,
+                    const void *src, SampleFormat src_fmt, unsigned src_channels,
+                    size_t frames);
+
+// Name of the kernel set compiled in ("NEON", "AVX2", "SSSE3", "SSE2", "scalar")
+const char *convert_backend(void);
+
+// Benchmark hook: route everything through the scalar kernels
+void convert_force_scalar(int enabled);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef DSP_H
+#define DSP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Per-period DSP on the stereo S16 stream at the device rate, applied in
+// place right before the samples reach ALSA:
+// - software gain (no dependency on a "PCM" mixer element)
+// - sample-accurate linear fades at song start, song end and on stop
+// - soft limiter: quadratic knee from DSP_LIMIT_THRESHOLD up to full scale
+// Fixed point (Q13 gain, 32-bit intermediates) with NEON/SSE2 kernels.
+// With unity gain, no fade in progress and the limiter off it is a no-op.
+
+#define DSP_DEFAULT_STOP_FADE_MS 250
+#define DSP_MAX_GAIN_DB          12.0
+#define DSP_LIMIT_KNEE           16384  // Input span of the knee
+#define DSP_LIMIT_THRESHOLD      (32767 - DSP_LIMIT_KNEE / 2)
+
+void dsp_set_gain_db(double db);
+void dsp_set_fades(unsigned int in_ms, unsigned int out_ms, unsigned int stop_ms);
+void dsp_set_limiter(int enabled);
+double dsp_gain_db(void);
+int dsp_limiter_enabled(void);
+
+// Called before each song. total_frames at the device rate, 0 if unknown
+// (no end fade then).
+void dsp_song_start(uint32_t rate, uint64_t total_frames);
+
+// Process frames in place and advance the song position
+void dsp_process(int16_t *buf, size_t frames);
+
+// On stop_requested: starts the stop fade on first call. Returns 1 while
+// the fade is still audible (keep feeding ALSA), 0 once it is silent or
+// when no stop fade is configured.
+int dsp_stop_fading(void);
+
+// Samples that went through the limiter knee during this song
+uint64_t dsp_limited_samples(void);
+
+// Benchmark hook: route everything through the scalar kernels
+void dsp_force_scalar(int enabled);
+
+#endif
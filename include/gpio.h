@@ -14,13 +14,39 @@
 
 #define GPIO_LEN 0xB4
 
+// Register word offsets; bank 0 is GPIO 0-31, bank 1 is GPIO 32-53
+#define GPSET0_REG  (0x1C / 4)
+#define GPSET1_REG  (0x20 / 4)
+#define GPCLR0_REG  (0x28 / 4)
+#define GPCLR1_REG  (0x2C / 4)
+#define GPLEV0_REG  (0x34 / 4)
+#define GPLEV1_REG  (0x38 / 4)
+
+#define GPIO_MAX_PIN      53
+#define LED_MAX_CHANNELS  (GPIO_MAX_PIN + 1)
+
 extern volatile uint32_t *gpio;
 
-extern const unsigned int led_lines[8];
+// Pin map: channel i of a pattern drives BCM GPIO led_lines[i]
+extern unsigned int led_lines[LED_MAX_CHANNELS];
+extern int led_count;
+
+// Set the pin map from "17,27,0,..." (BCM numbers). Returns 0 on success.
+int gpio_set_pin_map(const char *spec);
+
+// Same from a list of BCM numbers (e.g. a recording's map): every pin
+// must exist and appear once. Returns 0 on success.
+int gpio_set_pin_lines(const unsigned int *lines, int count);
+
+// Bit n set for every BCM pin n in lines
+uint64_t gpio_pins_mask(const unsigned int *lines, int count);
 
-void gpio_init(void);
+// Map the registers; -1 if neither /dev/gpiomem nor /dev/mem can be mapped.
+// Used by the mmap output backend, see output.h.
+int gpio_init(void);
 void gpio_cleanup(void);
 void gpio_all_off(const unsigned int *lines, int count);
+void gpio_all_on(const unsigned int *lines, int count);
 void gpio_set_outputs(const unsigned int *lines, int count);
 
 #endif
@@ -0,0 +1,47 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stddef.h>
+
+// Adaptive ALSA latency controller.
+//
+// Starts each run from a low-latency configuration and widens or narrows
+// it from the jitter and ALSA delay the audio thread actually observes:
+// - the live fill target (periods kept queued in ALSA) changes at any
+//   cycle boundary, which is always safe;
+// - the ALSA buffer size needs a setup_alsa() cycle, so it only changes
+//   between songs.
+
+#define LATENCY_MAX_DECISIONS 64
+
+typedef struct {
+    double time_sec;           // Playback time of the decision (0 = between songs)
+    unsigned int old_target;   // Fill target in periods
+    unsigned int new_target;
+    unsigned int old_buffer;   // ALSA buffer in periods
+    unsigned int new_buffer;
+    const char *reason;
+} LatencyDecision;
+
+void latency_set_adaptive(int enabled);
+int latency_adaptive_enabled(void);
+
+// Called before setup_alsa() for every song. min_target is the lowest
+// safe fill for the audio thread's wake pattern (in periods).
+void latency_song_start(unsigned int min_target, unsigned int period_us);
+
+// Called after playback; decides the buffer size for the next song
+void latency_song_end(void);
+
+unsigned int latency_target_periods(void);
+unsigned int latency_buffer_periods(void);
+
+// Audio thread hooks (RT-safe: no allocation, no locking, no I/O)
+void latency_observe(double time_sec, long jitter_us, long delay_frames,
+                     size_t period_frames);
+void latency_note_underrun(double time_sec);
+
+// Decisions taken during the current song (for the playback report)
+const LatencyDecision *latency_decisions(size_t *count);
+
+#endif
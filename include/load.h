@@ -5,14 +5,23 @@
 #include <stddef.h>
 
 #define MAX_PATTERNS 2048
+#define PATTERN_MAX_CHANNELS 64     // Bits in Pattern.pattern
+#define PATTERN_LINE_MAX 320
 
+// One cue. start_us is the absolute offset from the start of the show,
+// accumulated in microseconds so per-line rounding never adds up.
 typedef struct {
-	int duration_ms;
-	uint8_t pattern;
+	uint64_t start_us;
+	uint32_t duration_us;
+	uint64_t pattern;   // Bit i = channel i (i-th digit of the pattern)
 } Pattern;
 
 extern Pattern patterns[MAX_PATTERNS];
 extern int pattern_count;
+extern uint64_t pattern_total_us;   // End of the last cue
+extern int pattern_channels;        // Widest pattern in the file
+extern uint8_t pattern_levels[MAX_PATTERNS][PATTERN_MAX_CHANNELS];  // 0-255 per channel
+extern int pattern_dimmed;          // Some cue uses a level other than 0/255
 
 typedef struct {
     uint32_t sample_rate;
@@ -27,6 +36,16 @@ typedef struct {
 WavData load_wav_mmap(const char *filename);
 void free_wav_mmap(WavData *wav);
 
+// Legacy duration cues and absolute timecode cues (see load.c)
 void load_patterns(const char *filename);
 
+// mm:ss.mmm (microseconds when needed), as written by --to-absolute
+void format_timecode(char *out, size_t len, uint64_t us);
+
+// Rewrite a pattern file as absolute cues (original kept as <file>.legacy)
+int convert_patterns_absolute(const char *filename);
+
+// Print how far the old whole-ms / 10ms-tick rounding moved each cue
+int report_pattern_drift(const char *filename);
+
 #endif
@@ -3,6 +3,12 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include "latency.h"
+#include "pwm.h"
+#include "pixels.h"
+#include "avclock.h"
+#include "calibrate.h"
+#include "netsync.h"
 
 // Playback statistics structure
 typedef struct {
@@ -12,14 +18,52 @@ typedef struct {
     long *audio_wake_interval_us; // Actual interval between wakes
     long *audio_buffer_frames;   // Ring buffer fill level (for MP3)
     long *alsa_delay_frames;     // ALSA buffer delay
+    long *audio_dsp_ns;          // DSP stage time per cycle (part of runtime)
     size_t audio_samples;
     int underrun_count;
     int buffer_stall_count;      // Times we waited for decoder
+    size_t audio_wakeups;        // Audio thread wakeups (both modes)
+    long audio_wake_target_us;   // Nominal wake interval of the mode
+    const char *audio_mode;      // "TIMER" or "POLL"
+
+    // DSP stage (gain / fades / limiter)
+    double dsp_gain_db;
+    int dsp_limiter;
+    uint64_t dsp_limited_samples;
+
+    // Adaptive latency controller (-A)
+    int latency_adaptive;
+    const LatencyDecision *latency_decisions;
+    size_t latency_decision_count;
+    unsigned int latency_target_periods;  // Fill target at end of song
+    unsigned int latency_buffer_periods;  // ALSA buffer used for this song
+
+    // Audio playback clock (drift, LED timeline lock)
+    const AvClockStats *avclock;
+    long sync_offset_us;            // Output latency added to every cue
+    const char *sync_offset_source; // "calibrated", "manual" or "none"
+    const CalResult *calibration;   // The calibrated entry, NULL otherwise
+
+    // Multi-node sync: this node on the shared timeline, the leader's
+    // node table; NULL when the song ran on the local clock
+    const NetSyncStats *netsync;
 
     // GPIO/LED thread stats
     long *gpio_write_ns;         // GPIO write duration
     long *gpio_jitter_ns;        // LED thread wake jitter
     size_t gpio_samples;
+    size_t led_wakeups;          // LED thread wakeups (one per pattern change)
+    int led_channels;            // Pin map size
+    int gpio_banks;              // GPIO banks written per cue (1 or 2)
+    const char *output_backend;  // "mmap", "sim", "cdev"
+    long *led_spin_ns;           // --precise: spin before each commit, else NULL
+    long led_margin_ns;          // --precise: early-wake margin at song end
+    size_t led_late_wakes;       // --precise: woke after the deadline
+    uint64_t output_commits;     // Simulated output: commits this song
+    uint64_t output_failures;    // Updates the backend rejected (cdev)
+    int output_errno;            // First of those failures
+    const PwmStats *pwm;         // Brightness PWM thread, NULL if not used
+    const PixelStats *pixels;    // WS2812 output thread, NULL if not used
 
     // Decoder thread stats (MP3 only)
     long *decode_time_us;        // Time to decode each chunk
@@ -28,10 +72,25 @@ typedef struct {
 
     // General info
     const char *audio_format;    // "MP3", "WAV", or "NONE"
+    const char *alsa_access;     // "MMAP" or "RW" (NULL without audio)
     uint32_t sample_rate;
     uint16_t channels;
+    uint32_t device_rate;        // ALSA rate (differs when resampling)
+    const char *resampler;       // "off", "fast" or "high"
     int pattern_count;
     double playback_duration_sec;
+
+    // Memory / startup
+    double time_to_first_sample_ms;  // play_song() start -> first ALSA write
+    int start_gated;                 // Armed or multi-node start:
+    double start_ready_ms;           //   threads parked this far ahead
+    double start_audio_us;           //   first audio error vs the instant
+    double start_led_us;             //   first cue error vs the instant
+    uint64_t start_offset_us;        // Started mid-song (--offset, UDP seek, late join):
+    double seek_ms;                  //   audio seek and cue search time
+    uint32_t first_cue;              //   first record on time
+    size_t audio_locked_peak_bytes;  // Audio data held locked at peak
+    long peak_rss_kb;                // Process peak RSS (getrusage)
 } PlaybackStats;
 
 void save_playback_report(const char *filename, const PlaybackStats *stats);
@@ -0,0 +1,128 @@
+#ifndef NETSYNC_H
+#define NETSYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Multi-node time sync: one sequencer leads, the others follow over UDP.
+//
+// A follower stamps its request (t1), the leader its receipt and reply
+// (t2, t3), the follower the reply's arrival (t4), each on its own
+// CLOCK_MONOTONIC; arrivals use the kernel's receive stamps. One exchange gives the offset ((t2-t1)+(t3-t4))/2 and
+// the round trip (t4-t1)-(t3-t2). Exchanges slower than the window's best
+// round trip plus a slack (queueing, a descheduled thread) are dropped,
+// and a least-squares line through the rest gives offset and skew, so
+// the leader's clock can be read on the follower between exchanges.
+//
+// The leader announces each song's start on its clock: all nodes start
+// it at that instant and hold audio and LEDs on the leader's timeline.
+
+#define NETSYNC_PORT            5006
+#define NETSYNC_POLL_MS         250     // Follower exchange interval once locked
+#define NETSYNC_FAST_POLL_MS    20      // Until locked, and while waiting for a start
+#define NETSYNC_TIMEOUT_MS      100     // Reply wait
+#define NETSYNC_WINDOW          64      // Exchanges in the fit (16 s at 250 ms)
+#define NETSYNC_MIN_SAMPLES     8       // Accepted exchanges before the skew is fitted
+#define NETSYNC_SLACK_US        100     // Round trip allowed above the best one
+#define NETSYNC_MAX_PPM         500     // Skew clamp
+#define NETSYNC_STEP_US         5000    // Offsets this far off the line...
+#define NETSYNC_STEP_COUNT      4       // ...this many times in a row restart the fit
+#define NETSYNC_START_LEAD_MS   1000    // Leader starts each song this far ahead
+#define NETSYNC_WAIT_MS         10000   // Follower waits this long for the start
+#define NETSYNC_REPORT_WAIT_MS  1000    // Leader waits this long for follower reports
+#define NETSYNC_SLIP_US         200     // Audio off the shared timeline: slip a frame
+#define NETSYNC_SKIP_US         5000    // Behind by more: skip to it at once
+#define NETSYNC_MAX_NODES       16
+
+typedef enum {
+    NETSYNC_OFF,
+    NETSYNC_LEADER,
+    NETSYNC_FOLLOWER,
+} NetSyncRole;
+
+// One exchange, all in ns
+typedef struct {
+    int64_t t1, t2, t3, t4;
+} NetSyncExchange;
+
+// Offset/skew estimate of one follower (the bench runs several):
+// leader = local + offset + skew * (local - ref)
+typedef struct {
+    int64_t t[NETSYNC_WINDOW];          // Local midpoint of the exchange
+    int64_t offset[NETSYNC_WINDOW];     // Leader minus local
+    int64_t delay[NETSYNC_WINDOW];      // Round trip
+    unsigned int count, next;
+    unsigned int steps;                 // Consecutive exchanges off the line
+    int valid;
+    int64_t ref_ns, offset_ns;
+    double skew;
+    double residual_rms_ns;             // Accepted exchanges around the line
+    int64_t min_delay_ns;
+    uint64_t exchanges, rejected, restarts;
+} NetSyncEstimator;
+
+void netsync_estimator_reset(NetSyncEstimator *e);
+// Returns 1 if the exchange was accepted (delay filter and step check)
+int netsync_estimator_add(NetSyncEstimator *e, const NetSyncExchange *x);
+int netsync_estimator_locked(const NetSyncEstimator *e);
+int64_t netsync_estimator_leader_ns(const NetSyncEstimator *e, int64_t local_ns);
+
+// One bare exchange with a leader over a connected UDP socket. 'clock'
+// maps the CLOCK_MONOTONIC stamps to the follower's clock (the bench's
+// simulated crystals); NULL keeps them. 0 on success, -1 on timeout.
+typedef int64_t (*NetSyncClock)(void *ctx, int64_t mono_ns);
+int netsync_exchange(int fd, NetSyncClock clock, void *ctx, NetSyncExchange *x);
+
+// A node's position against the shared timeline over one song
+typedef struct {
+    uint32_t song_seq;
+    uint64_t cues;
+    double led_avg_us, led_max_us;      // LED commit (as heard) vs its cue, signed avg
+    double audio_avg_us, audio_max_us;  // Heard audio vs the timeline, absolute
+} NetSyncTimeline;
+
+typedef struct {
+    char addr[48];
+    double offset_us, skew_ppm, delay_us, residual_us;  // The follower's estimate
+    uint64_t exchanges, rejected;
+    uint32_t playing_seq;               // Song the follower started
+    NetSyncTimeline timeline;           // Its last report
+} NetSyncNode;
+
+typedef struct {
+    NetSyncRole role;
+    int locked;
+    double offset_us, skew_ppm, delay_us, residual_us;
+    uint64_t exchanges, rejected, restarts;
+    NetSyncTimeline timeline;           // This node, last song
+    NetSyncNode nodes[NETSYNC_MAX_NODES];   // Leader: followers seen
+    size_t node_count;
+} NetSyncStats;
+
+// --sync-leader[=port] / --sync-follow host[:port]; 0 on success
+int netsync_lead(int port);
+int netsync_follow(const char *leader);
+void netsync_stop(void);
+NetSyncRole netsync_role(void);
+int netsync_port(void);                 // Leader: port actually bound
+
+// Leader clock from the local one and back (RT-safe: no locking).
+// Identity on the leader and without sync.
+int64_t netsync_leader_ns(int64_t local_ns);
+int64_t netsync_local_ns(int64_t leader_ns);
+
+// Start of a song on the leader's clock. The leader announces *start_ns
+// (an armed start), but no sooner than now + NETSYNC_START_LEAD_MS, and
+// the song time it starts at (*offset_us, --offset); a follower waits for
+// the leader's announcement of the same song, with its estimator locked,
+// and takes both. -1 without sync, on timeout or on stop.
+int netsync_song_start(const char *song, uint64_t length_us, uint64_t *offset_us,
+                       int64_t *start_ns);
+
+// Song end: a follower sends its timeline to the leader; the leader waits
+// for the followers that played the song and prints the node table
+void netsync_song_end(const NetSyncTimeline *own);
+
+void netsync_get_stats(NetSyncStats *stats);
+
+#endif
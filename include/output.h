@@ -0,0 +1,94 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "gpio.h"
+
+// LED output backends.
+//
+// A frame is the pair of per-bank set/clear words the show compiler
+// already produces (ShowCue, PwmSlot). Backends:
+//   mmap  BCM registers through /dev/gpiomem or /dev/mem (default)
+//   sim   a page laid out like the BCM registers, anonymous or a tmpfs
+//         file ("sim:/dev/shm/leds") another process can watch; GPLEV
+//         follows the set/clear writes and every commit is timestamped
+//   cdev  GPIO character device v2 uAPI ("cdev:/dev/gpiochip0"): one line
+//         request holds every channel and GPIO_V2_LINE_SET_VALUES_IOCTL
+//         updates all of them per cue. No register base table and no
+//         cap_sys_rawio needed; works with the gpio-sim kernel module
+//
+// Register backends (mmio) point `gpio` at their page and output_commit()
+// inlines the stores, so the hot path is the same two stores per bank as
+// before; other backends go through commit_frame.
+//
+// A cdev update can fail (line request revoked, chip unbound): failures
+// are counted with the first errno, reported per song and at cleanup,
+// and output_commit() returns -1 so the recorder can mark the cue.
+
+typedef struct {
+    const char *name;
+    int mmio;   // Commits are plain stores through `gpio`
+    int (*init)(const char *arg, const unsigned int *lines, int count);
+    int (*commit_frame)(const uint32_t set[2], const uint32_t clr[2]);   // -1 if rejected
+    void (*all_off)(const unsigned int *lines, int count);   // Async-signal-safe
+    void (*cleanup)(void);
+    void (*read_levels)(uint32_t level[2]);   // Pin levels, per bank (GPLEV0/1)
+} OutputBackend;
+
+typedef struct {
+    uint64_t t_ns;          // CLOCK_MONOTONIC at commit
+    uint32_t set[2];
+    uint32_t clr[2];
+    uint32_t level[2];      // GPLEV0/1 after the commit
+} OutputCommit;
+
+#define OUTPUT_GPIOCHIP_DEFAULT "/dev/gpiochip0"
+#define OUTPUT_SIM_LOG_MAX  65536   // Commits logged per song, later ones only counted
+
+extern const OutputBackend output_mmap;
+extern const OutputBackend output_sim;
+extern const OutputBackend output_cdev;
+extern const OutputBackend *output;
+extern int output_bank1;    // Pin map reaches GPIO 32 and up
+
+// "mmap", "sim[:/path]" or "cdev[:/dev/gpiochipN]". Returns 0 on success.
+int output_select(const char *spec);
+const char *output_name(void);
+
+// Open the selected backend and make the pin map outputs
+int output_init(const unsigned int *lines, int count);
+void output_cleanup(void);
+int output_ready(void);
+
+static inline int output_commit(const uint32_t set[2], const uint32_t clr[2]) {
+    if (output->mmio) {
+        gpio[GPSET0_REG] = set[0];
+        if (output_bank1)
+            gpio[GPSET1_REG] = set[1];
+        __sync_synchronize();
+        gpio[GPCLR0_REG] = clr[0];
+        if (output_bank1)
+            gpio[GPCLR1_REG] = clr[1];
+        return 0;
+    }
+    return output->commit_frame(set, clr);
+}
+
+// Current pin levels as the hardware sees them (recorder readback)
+void output_read_levels(uint32_t level[2]);
+
+// Pin map all off / all on (signal handler, -s, song boundaries)
+void output_all_off(void);
+void output_all_on(void);
+
+// Updates the backend rejected since the last reset (all-off included),
+// and the first errno (0 if none)
+uint64_t output_failures(int *first_errno);
+void output_failures_reset(void);
+
+// Simulated backend commit log, cleared per song
+void output_sim_reset(void);
+size_t output_sim_log(const OutputCommit **log, uint64_t *total);
+
+#endif
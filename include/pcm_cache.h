@@ -0,0 +1,41 @@
+#ifndef PCM_CACHE_H
+#define PCM_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Persistent cache of decoded MP3s.
+//
+// Each entry is a plain 16-bit PCM WAV named after the MP3 and a hash of
+// its path, size and mtime, so an edited or replaced MP3 gets a new entry.
+// A cached song is opened through the same mmap + mlock path as a WAV and
+// never starts the decoder thread.
+
+typedef struct PcmCacheWriter PcmCacheWriter;
+
+// Enable the cache in dir (created if missing). Returns 0 on success.
+int pcm_cache_set_dir(const char *dir);
+
+// NULL while the cache is disabled
+const char *pcm_cache_get_dir(void);
+
+// Cache file for mp3_path. Returns 0 if an up-to-date entry exists.
+int pcm_cache_lookup(const char *mp3_path, char *out, size_t len);
+
+// Where mp3_path's seek index (audio_seek()) is kept, named like its PCM
+// entry. -1 while the cache is disabled.
+int pcm_cache_index_path(const char *mp3_path, char *out, size_t len);
+
+// Stream decoded PCM into a temporary file; commit renames it into place,
+// abort deletes it. Both free the writer.
+PcmCacheWriter *pcm_cache_begin(const char *mp3_path, uint32_t sample_rate,
+                                uint16_t channels);
+int pcm_cache_write(PcmCacheWriter *w, const int16_t *samples, size_t count);
+int pcm_cache_commit(PcmCacheWriter *w);
+void pcm_cache_abort(PcmCacheWriter *w);
+
+// Decode every .mp3 in music_dir that has no cache entry yet.
+// Returns the number of failures.
+int pcm_cache_precache_dir(const char *music_dir);
+
+#endif
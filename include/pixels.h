@@ -0,0 +1,67 @@
+#ifndef PIXELS_H
+#define PIXELS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "show.h"
+
+// WS2812 pixel output over SPI.
+//
+// Each WS2812 data bit becomes 3 SPI bits at 2.4 MHz (1 -> 110, 0 -> 100),
+// i.e. 800 kbit/s on the wire and 9 SPI bytes per RGB pixel, followed by
+// a low reset gap. The encoder uses nibble tables with NEON/SSSE3 shuffles
+// (scalar fallback). A frame is sent with a single SPI_IOC_MESSAGE ioctl,
+// so spidev needs a large enough buffer (spidev.bufsiz=65536 on the
+// kernel command line for more than ~450 pixels). Any path that is not a
+// character device is a file sink: encoded frames are appended to it.
+//
+// Pixels follow the same show as the GPIO outputs: the strip is split
+// into one equal segment per channel, lit in the configured colour at the
+// channel's level. The LED thread hands each cue to a separate output
+// thread, so a slow SPI transfer never delays the cue timeline; cues that
+// arrive while a frame is still on the wire are merged into the next one.
+
+#define WS2812_SPI_HZ          2400000
+#define WS2812_RESET_US        300
+#define WS2812_BYTES_PER_PIXEL 9
+#define WS2812_RESET_BYTES     (WS2812_SPI_HZ / 8 * WS2812_RESET_US / 1000000)
+#define PIXELS_DEFAULT_DEVICE  "/dev/spidev0.0"
+#define PIXELS_MAX             8192
+
+typedef struct PixelSink PixelSink;
+
+typedef struct {
+    unsigned int pixels;
+    size_t frame_bytes;        // Encoded frame incl. reset gap
+    uint64_t frames;           // Frames written
+    uint64_t merged_cues;      // Cues superseded before they were sent
+    uint64_t write_errors;
+    double encode_avg_us, encode_max_us;
+    double write_avg_us, write_max_us;
+} PixelStats;
+
+// Encoded size of a strip, reset gap included
+size_t ws2812_frame_bytes(size_t pixels);
+
+// Encode len bytes of GRB data into len * 3 SPI bytes
+void ws2812_encode(uint8_t *dst, const uint8_t *grb, size_t len);
+const char *ws2812_backend(void);
+void ws2812_force_scalar(int enabled);
+
+// Character device: spidev (mode 0, 8 bits, WS2812_SPI_HZ); anything else
+// is created/truncated as a file sink
+PixelSink *pixel_sink_open(const char *path);
+int pixel_sink_is_spi(const PixelSink *sink);
+// rx may be NULL; with spidev it receives MISO (loopback tests)
+int pixel_sink_write(PixelSink *sink, const uint8_t *tx, uint8_t *rx, size_t len);
+void pixel_sink_close(PixelSink *sink);
+
+// Show output (--pixels); rgb is 0xRRGGBB
+void pixels_configure(unsigned int count, const char *device, uint32_t rgb);
+int pixels_enabled(void);
+int pixels_start(const Show *show);
+void pixels_cue(uint32_t index);   // LED thread, RT-safe
+void pixels_stop(void);
+void pixels_get_stats(PixelStats *stats);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <signal.h>
+#include "resample.h"
 
 // Global stop flag - set by signal handler in main.c
 extern volatile sig_atomic_t stop_requested;
@@ -11,7 +12,36 @@ void play_song(const char *base_name);
 void reset_runtime_state(void);
 void set_verbose_mode(int enabled);
 void set_music_dir(const char *dir);
+const char *get_music_dir(void);
 void set_auto_off(int enabled);
 int get_auto_off(void);
+void set_audio_poll_mode(int enabled);
+
+// LED precision mode: wake early by an adaptive margin, spin to each cue
+void set_led_precise(int enabled);
+
+// Fixed LED delay for the output latency, instead of the calibrated one
+void set_sync_offset_ms(double ms);
+
+// Start the next song at a CLOCK_REALTIME instant, "seconds[.fraction]"
+// since the epoch or "+seconds" from now: everything is prepared and the
+// device pre-rolled ahead of it. -1 if the time does not parse.
+int set_start_at(const char *when);
+
+// Start the next song this far in: audio seeked, LEDs at the pattern in
+// effect there. With --start-at the instant is when that point plays.
+// -1 if negative.
+int set_start_offset_ms(double ms);
+
+// Run ALSA at this rate for every song, resampling as needed (0 = song rate)
+void set_device_rate(unsigned int rate);
+void set_resample_quality(ResampleQuality quality);
+
+// Close an ALSA device kept open between songs (at exit)
+void player_close_audio(void);
+
+// Wake a poll-mode audio thread after stop_requested was set.
+// Async-signal-safe, called from the signal handler.
+void player_signal_stop(void);
 
 #endif
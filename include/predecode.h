@@ -0,0 +1,30 @@
+#ifndef PREDECODE_H
+#define PREDECODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Whole-song MP3 decode on a pool of worker threads.
+//
+// The MP3 is scanned once for an exact frame index, split into
+// frame-aligned segments, and each worker decodes its segment with its
+// own mpg123 handle straight into one contiguous buffer. Workers start a
+// few MPEG frames before their segment to prime the decoder (bit
+// reservoir, synthesis filter) and discard that overlap, so the seams
+// are sample-exact.
+
+typedef struct {
+    int16_t *pcm;             // Anonymous mmap, mlocked when possible
+    size_t bytes;             // Size of the mapping
+    size_t frames;            // PCM frames (per channel)
+    uint32_t sample_rate;
+    uint16_t channels;
+} PredecodedPcm;
+
+// Returns 0 on success. workers <= 0 uses one per online CPU.
+int predecode_mp3(const char *filename, int workers, PredecodedPcm *out);
+
+// Only for buffers not handed over to an AudioStream
+void predecode_free(PredecodedPcm *pcm);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef PWM_H
+#define PWM_H
+
+#include <stdint.h>
+
+// Software PWM for per-channel brightness.
+//
+// Levels 0-255 are shown with binary-coded modulation: every PWM period is
+// split into 8 slots of 1, 2, 4 ... 128 units (255 units in total), and a
+// channel is on during slot b when bit b of its level is set. The GPSET/
+// GPCLR words of all 8 slots are precomputed per cue (a PwmFrame), so the
+// PWM thread does two register stores per slot and bank and nothing else.
+// Frames are swapped only at period boundaries.
+//
+// The LED thread stays the cue source: at each cue it publishes the next
+// frame instead of writing GPIO. The PWM thread runs SCHED_FIFO, pinned to
+// one core (the last one by default), and spins through the last stretch
+// of each slot on multi-core Pis; the Pi 1 only sleeps.
+
+#define PWM_BITS          8
+#define PWM_MAX_LEVEL     ((1 << PWM_BITS) - 1)
+#define PWM_DEFAULT_HZ    200
+#define PWM_PRIORITY      79
+
+typedef struct {
+    uint32_t set[2];    // Per bank
+    uint32_t clr[2];
+} PwmSlot;
+
+typedef struct {
+    PwmSlot slot[PWM_BITS];
+} PwmFrame;
+
+typedef struct {
+    unsigned int target_hz;
+    double achieved_hz;        // Periods / elapsed time
+    double duty_err_avg;       // Per period: sum of slot weight errors,
+    double duty_err_max;       // bounds the duty error of any level (%)
+    uint64_t periods;
+    uint64_t late_slots;       // Written more than half a unit late
+    int cpu;                   // -1 if not pinned
+} PwmStats;
+
+void pwm_set_frequency(unsigned int hz);
+unsigned int pwm_frequency(void);
+void pwm_set_cpu(int cpu);    // -1 = last core
+
+// Slot masks for one set of levels (levels[i] drives lines[i])
+void pwm_build_frame(PwmFrame *frame, const uint8_t *levels, int count,
+                     const unsigned int *lines);
+
+// Start the PWM thread; outputs stay untouched until the first frame.
+// Slots are committed through the selected output backend (output.h).
+// Returns 0 on success.
+int pwm_start(void);
+
+// Publish the frame for the next period (LED thread, RT-safe)
+void pwm_set_frame(const PwmFrame *frame);
+
+// Stop and join the thread. Unless stopping on a signal, the outputs are
+// left at the last frame's on/off threshold (level >= 128 on).
+void pwm_stop(void);
+
+void pwm_get_stats(PwmStats *stats);
+
+#endif
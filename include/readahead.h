@@ -0,0 +1,30 @@
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// Bounded-memory streaming for mmap'd WAVs.
+//
+// Instead of mlocking the whole file, a background thread keeps a locked
+// window of window_bytes ahead of the play position: it prefetches with
+// madvise(MADV_WILLNEED), pins with mlock(), and unlocks + drops
+// (MADV_DONTNEED) what has already been played. Only the first window is
+// loaded before playback starts, so startup no longer scales with file size.
+
+typedef struct ReadAhead ReadAhead;
+
+// position counts frames already consumed from data (bytes_per_frame each).
+// Locks the first window synchronously, then starts the reader thread.
+ReadAhead *readahead_start(void *mapping, size_t mapping_size,
+                           const void *data, size_t bytes_per_frame,
+                           atomic_size_t *position, size_t window_bytes);
+
+// Stop the thread and unlock everything (mapping itself stays)
+void readahead_stop(ReadAhead *ra);
+
+// Most bytes held locked at any one time
+size_t readahead_peak_locked(const ReadAhead *ra);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdint.h>
+#include <time.h>
+#include "show.h"
+
+// Output timeline recorder (--record) and analyzer (--analyze).
+//
+// The LED thread pushes one fixed-size record per commit into a lock-free
+// ring (no I/O, no locks on the RT path); a normal-priority writer thread
+// streams them to the file. With --record-levels the pin levels are read
+// back right after each commit (GPLEV0/1, or GET_VALUES on cdev), so the
+// file shows what the pins did, not only what was written.
+//
+// File: RecHeader, then RecRecord[] in host byte order. The header names
+// the pattern file and pin map, so --analyze can rebuild the intended
+// cue timeline and diff the two.
+
+#define REC_MAGIC    "SEQREC"
+#define REC_VERSION  1
+#define REC_PATH_MAX 512
+
+#define REC_FLAG_LEVELS  1u    // Header: level readback; record: levels valid
+#define REC_FLAG_DIMMED  2u    // Header: PWM show, records are frame handoffs
+#define REC_FLAG_FAILED  4u    // Record: the output backend rejected the commit
+
+typedef struct {
+    uint64_t t_ns;          // Commit time since the LED timeline start
+    uint32_t cue;           // Show record index
+    uint32_t flags;
+    uint32_t set[2];        // Words written (GPSET0/1)
+    uint32_t level[2];      // Pin levels read back after the commit
+} RecRecord;
+
+// Start/stop around one song; path is a file or a directory (<song>.rec)
+void recorder_configure(const char *path, int read_levels);
+int recorder_enabled(void);
+int recorder_start(const char *song, const char *pattern_file, const Show *show);
+// LED thread: song time 0 and the first cue played (> 0 mid-show)
+void recorder_timeline_start(struct timespec start, uint32_t first_cue);
+// LED thread; failed: output_commit() returned -1
+void recorder_commit(uint32_t cue, struct timespec when, const uint32_t set[2], int failed);
+void recorder_stop(void);
+
+// Diff a recording against its pattern file (or pattern_file if not NULL).
+// Returns 0 if every cue was committed exactly once with the right pins
+// and accepted by the output.
+int recorder_analyze(const char *rec_path, const char *pattern_file);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Streaming sample-rate converter for the stereo S16 audio path.
+//
+// Rational polyphase filter: the rate ratio is reduced to L/M and one
+// Q15 coefficient set is precomputed per output phase, so every output
+// frame is a single fixed-point dot product (SIMD on NEON/SSE2). Lets the
+// ALSA device run at one fixed rate while songs come in at 32/44.1/48 kHz.
+
+typedef enum {
+    RESAMPLE_FAST,   // Linear interpolation (2 taps): for the Pi 1
+    RESAMPLE_HIGH,   // 32-tap Kaiser-windowed sinc per phase
+} ResampleQuality;
+
+// Largest reduced interpolation factor L (44.1k <-> 48k is 160/147)
+#define RESAMPLE_MAX_PHASES 1024
+
+typedef struct Resampler Resampler;
+
+// Pull-mode input, same contract as audio_read(): frames read, 0 when
+// nothing is available right now, -1 when the source is finished
+typedef int (*ResampleSource)(void *ctx, int16_t *buffer, size_t frames);
+
+// NULL if the ratio needs more than RESAMPLE_MAX_PHASES phases
+Resampler *resampler_create(uint32_t in_rate, uint32_t out_rate, ResampleQuality quality);
+void resampler_free(Resampler *r);
+
+// Produce up to 'frames' output frames, pulling input as needed.
+// Returns frames produced, 0 if the source had nothing yet, -1 at the end.
+int resampler_read(Resampler *r, int16_t *out, size_t frames,
+                   ResampleSource source, void *ctx);
+
+// Output frames obtainable from in_frames more input plus what is buffered
+size_t resampler_output_frames(const Resampler *r, size_t in_frames);
+
+// "fast"/"high" for the CLI, parsed back by resample_quality_from_name()
+const char *resample_quality_name(ResampleQuality quality);
+int resample_quality_from_name(const char *name, ResampleQuality *out);
+
+// Taps per output frame (2 or 32), for reports
+unsigned resampler_taps(const Resampler *r);
+
+#endif
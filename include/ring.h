@@ -0,0 +1,38 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define RING_CACHE_LINE 64
+
+// Wait-free single-producer / single-consumer ring of int16 samples.
+//
+// head is only written by the producer (decoder thread), tail only by the
+// consumer (audio thread). Both are free-running counters, masked with
+// (capacity - 1) on access, so capacity must be a power of two and the
+// full/empty cases need no reserved slot. Each index lives on its own
+// cache line so the two threads never false-share.
+typedef struct {
+    _Alignas(RING_CACHE_LINE) atomic_size_t head;  // Producer position
+    _Alignas(RING_CACHE_LINE) atomic_size_t tail;  // Consumer position
+    _Alignas(RING_CACHE_LINE) int16_t *data;
+    size_t capacity;          // In samples, power of two
+    size_t mask;              // capacity - 1
+} SpscRing;
+
+// Allocate ring storage; capacity is rounded up to a power of two.
+// Returns 0 on success, -1 on allocation failure.
+int ring_init(SpscRing *ring, size_t capacity);
+void ring_free(SpscRing *ring);
+
+// Samples ready for the consumer / free for the producer
+size_t ring_used(SpscRing *ring);
+size_t ring_space(SpscRing *ring);
+
+// Copy up to count samples in/out. Never blocks; returns samples moved.
+size_t ring_write(SpscRing *ring, const int16_t *src, size_t count);
+size_t ring_read(SpscRing *ring, int16_t *dst, size_t count);
+
+#endif
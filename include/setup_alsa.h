@@ -3,12 +3,48 @@
 
 #include <alsa/asoundlib.h>
 #include <stdint.h>
+#include <time.h>
+
+#define ALSA_DEFAULT_BUFFER_PERIODS 12
 
 extern snd_pcm_t *pcm;
 
+// Set by setup_alsa(): 1 if the device runs with MMAP_INTERLEAVED access
+extern int alsa_mmap_active;
+
+// Set by setup_alsa(): ALSA buffer size the device actually granted
+extern snd_pcm_uframes_t alsa_buffer_frames;
+
+// Ask setup_alsa() for mmap access (zero-copy writes into the DMA area)
+void alsa_request_mmap(int enabled);
+
+// ALSA buffer length in periods used by the next setup_alsa() (min 2)
+void alsa_set_buffer_periods(unsigned int periods);
+
 void setup_alsa(unsigned int sample_rate, unsigned int channels);
 void alsa_close(void);
 
+// Fixed device rate: keep the device open between songs and only run
+// setup_alsa() again when rate, channels, buffer length or access change
+void alsa_setup_persistent(unsigned int sample_rate, unsigned int channels);
+
+// Card and device of the open playback PCM ("bcm2835 Headphones,0"),
+// the key for calibrated sync offsets
+const char *alsa_device_name(void);
+
+// Timestamp hw pointer updates on CLOCK_MONOTONIC (snd_pcm_htimestamp)
+void alsa_enable_tstamps(snd_pcm_t *p, snd_pcm_sw_params_t *sw_params);
+
+// Pre-roll: with hold set, writes only queue and the stream stays
+// PREPARED until snd_pcm_start(); clearing it restores auto-start
+// (needed again after an xrun). Returns a negative ALSA error.
+int alsa_hold_start(snd_pcm_t *p, int hold);
+
+// Frames that have passed the DAC (playback) or ADC (capture) and when.
+// frames_done is what the caller wrote or read. Returns -1 on error.
+int alsa_stream_position(snd_pcm_t *p, snd_pcm_uframes_t buffer_frames,
+                         uint64_t frames_done, struct timespec *when, int64_t *pos);
+
 int init_mixer(const char *card, const char *selem_name);
 int set_hw_volume(long volume_percent);
 
@@ -0,0 +1,60 @@
+#ifndef SHOW_H
+#define SHOW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pwm.h"
+
+// Compiled LED shows.
+//
+// `sequencer --compile song.txt` turns a pattern file into song.show: a
+// header followed by one record per pattern change, holding the absolute
+// cue time and the GPSET/GPCLR words of both banks for the configured pin
+// map. The player mmaps and mlocks it, so the LED thread only does two
+// register stores per cue and bank in use. A missing or stale .show
+// (source size or mtime, pin map or format version changed) falls back to
+// parsing the text file. Shows with brightness levels also carry one
+// PwmFrame (precomputed PWM slot masks) per record.
+//
+// Records are stored in host byte order.
+
+#define SHOW_MAGIC   "SEQSHOW"
+#define SHOW_VERSION 4
+
+typedef struct {
+    uint64_t abs_time_us;   // Offset from the start of the show
+    uint32_t gpset_mask[2]; // Pins to switch on, per bank
+    uint32_t gpclr_mask[2]; // Pins to switch off, per bank
+} ShowCue;
+
+typedef struct {
+    const ShowCue *cues;
+    const PwmFrame *frames; // Per record, NULL unless the show dims
+    uint32_t count;         // Records (pattern changes only)
+    uint32_t source_cues;   // Cue lines in the pattern file
+    uint64_t total_us;      // End of the last cue
+    int banks;              // 2 if the pin map uses GPIO 32 and up
+    int compiled;           // Mapped from a .show file
+
+    void *mapping;          // mmap of the .show, or NULL
+    size_t mapping_size;
+    ShowCue *owned;         // Built from the text file, or NULL
+    PwmFrame *owned_frames;
+} Show;
+
+// Path of the compiled file for a pattern file (.txt -> .show)
+int show_compiled_path(const char *txt_path, char *out, size_t len);
+
+// Compile txt_path next to it. Returns 0 on success.
+int show_compile(const char *txt_path);
+
+// Load the up-to-date compiled show for txt_path, or parse the text.
+// Returns 0 on success.
+int show_load(const char *txt_path, Show *show);
+void show_free(Show *show);
+
+// First record at or after song_us (count if none): a binary search over
+// the cue times, for starting mid-show
+uint32_t show_find(const Show *show, uint64_t song_us);
+
+#endif
@@ -6,6 +6,11 @@
 #define MAX_SONG_NAME 64
 #define UDP_PORT 5005
 
+// {"song":"name"}, {"cmd":"arm","song":"name","at":"<epoch>[.frac]"}
+// which also sets the song's start (set_start_at()), or
+// {"cmd":"seek","song":"name","offset":<ms>} which starts it that far in
+// (set_start_offset_ms(); an arm takes an "offset" too). Returns 1 for an
+// arm or seek, 0 for a plain song, -1 on timeout or error.
 int receive_udp_song(char *song_out, size_t len);
 void emulate_udp_from_file(const char *filename);
 
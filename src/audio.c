@@ -1,4 +1,7 @@
 #include "audio.h"
+#include "pcm_cache.h"
+#include "predecode.h"
+#include "readahead.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,10 +12,24 @@
 #include <sys/stat.h>
 #include <mpg123.h>
 #include <syslog.h>
+#include <time.h>
 
 // Minimum buffer time in milliseconds before signaling data available
 #define MIN_BUFFER_MS 100
 
+// Decoder back-off while the ring is full, and audio_start() poll interval.
+// The ring holds seconds of audio, so a few ms of slack costs nothing.
+#define DECODER_BACKOFF_MS 5
+#define PREBUFFER_POLL_MS  1
+
+// MP3 seek index: mpg123 keeps every frame's file offset (a growing index
+// instead of its default thinned one), so a seek lands on the exact frame.
+// The indexes of the last few files seeked in are kept for the next seek,
+// and with a PCM cache (-c) every index is also saved next to the entries.
+#define MP3_INDEX_GROW  1024    // Entries added at a time
+#define MP3_INDEX_CACHE 4       // Files remembered
+#define MP3_INDEX_MAGIC "SEQIDX1"
+
 // WAV header structures
 #pragma pack(push, 1)
 typedef struct {
@@ -36,7 +53,46 @@ typedef struct {
 } FmtChunk;
 #pragma pack(pop)
 
+#define WAVE_FORMAT_PCM        0x0001
+#define WAVE_FORMAT_IEEE_FLOAT 0x0003
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+// Offset of the SubFormat GUID in a WAVE_FORMAT_EXTENSIBLE fmt chunk;
+// its first two bytes are the real format tag
+#define FMT_EXT_SUBFORMAT_OFFSET 24
+
+typedef struct {
+    char path[512];
+    off_t size;
+    time_t mtime;
+    off_t *offsets;
+    off_t step;
+    size_t fill;
+    off_t length;           // Exact length in frames, from the scan
+} Mp3Index;
+
+// Saved index: this header, then 'fill' 64-bit file offsets (off_t may be
+// 32 bits wide)
+typedef struct {
+    char     magic[8];
+    int64_t  step;
+    int64_t  length;
+    uint64_t fill;
+} Mp3IndexFile;
+
 static int mpg123_initialized = 0;
+static int preload_workers = 0;
+static double wav_window_sec = 0;
+static Mp3Index mp3_index_cache[MP3_INDEX_CACHE];
+static unsigned int mp3_index_next = 0;
+
+void audio_set_wav_window(double seconds) {
+    wav_window_sec = seconds;
+}
+
+void audio_set_preload_workers(int workers) {
+    preload_workers = workers;
+}
 
 static AudioFormat detect_format(const char *filename) {
     const char *ext = strrchr(filename, '.');
@@ -48,6 +104,34 @@ static AudioFormat detect_format(const char *filename) {
     return AUDIO_FORMAT_UNKNOWN;
 }
 
+// Map a fmt chunk onto a SampleFormat. The container size comes from
+// block_align, so 24-bit samples may be packed (3 bytes) or padded to 4;
+// padded ones are MSB-aligned in WAV and convert exactly like S32.
+static int wav_sample_format(const FmtChunk *fmt, const uint8_t *fmt_data,
+                             uint32_t fmt_size, SampleFormat *out) {
+    uint16_t tag = fmt->audio_format;
+    if (tag == WAVE_FORMAT_EXTENSIBLE) {
+        if (fmt_size < FMT_EXT_SUBFORMAT_OFFSET + 2) return -1;
+        memcpy(&tag, fmt_data + FMT_EXT_SUBFORMAT_OFFSET, sizeof(tag));
+    }
+
+    if (fmt->num_channels == 0) return -1;
+    unsigned container = fmt->block_align / fmt->num_channels;
+
+    if (tag == WAVE_FORMAT_IEEE_FLOAT && container == 4) {
+        *out = SAMPLE_FLOAT;
+        return 0;
+    }
+    if (tag != WAVE_FORMAT_PCM) return -1;
+
+    switch (container) {
+    case 2: *out = SAMPLE_S16;     return fmt->bits_per_sample == 16 ? 0 : -1;
+    case 3: *out = SAMPLE_S24_3LE; return 0;
+    case 4: *out = SAMPLE_S32;     return 0;
+    default: return -1;
+    }
+}
+
 static int open_wav(AudioStream *stream, const char *filename) {
     int fd = open(filename, O_RDONLY);
     if (fd < 0) {
@@ -84,6 +168,8 @@ static int open_wav(AudioStream *stream, const char *filename) {
     p += sizeof(RiffHeader);
 
     FmtChunk fmt = {0};
+    const uint8_t *fmt_data = NULL;
+    uint32_t fmt_size = 0;
     uint32_t data_size = 0;
     uint8_t *data_ptr = NULL;
 
@@ -92,6 +178,8 @@ static int open_wav(AudioStream *stream, const char *filename) {
 
         if (memcmp(ch->chunk_id, "fmt ", 4) == 0) {
             memcpy(&fmt, p + sizeof(ChunkHeader), sizeof(FmtChunk));
+            fmt_data = p + sizeof(ChunkHeader);
+            fmt_size = ch->chunk_size;
         } else if (memcmp(ch->chunk_id, "data", 4) == 0) {
             data_size = ch->chunk_size;
             data_ptr = p + sizeof(ChunkHeader);
@@ -107,21 +195,44 @@ static int open_wav(AudioStream *stream, const char *filename) {
         return -1;
     }
 
-    if (fmt.audio_format != 1 || fmt.bits_per_sample != 16) {
-        fprintf(stderr, "Unsupported WAV format (need PCM 16-bit)\n");
+    SampleFormat sample_format;
+    if (fmt.num_channels < 1 || fmt.num_channels > 2 ||
+        wav_sample_format(&fmt, fmt_data, fmt_size, &sample_format) < 0) {
+        fprintf(stderr, "Unsupported WAV format (need mono/stereo PCM 16/24/32-bit or float)\n");
         munmap(mapping, file_size);
         return -1;
     }
 
+    size_t bytes_per_frame = fmt.num_channels * sample_format_bytes(sample_format);
+
     stream->format = AUDIO_FORMAT_WAV;
     stream->sample_rate = fmt.sample_rate;
-    stream->channels = fmt.num_channels;
-    stream->total_frames = data_size / (fmt.num_channels * 2);
+    stream->channels = 2;  // Mono is upmixed in audio_read()
+    stream->total_frames = data_size / bytes_per_frame;
     stream->mapping = mapping;
     stream->mapping_size = file_size;
-    stream->wav_pcm = (int16_t *)data_ptr;
+    stream->wav_data = data_ptr;
+    stream->wav_format = sample_format;
+    stream->wav_channels = fmt.num_channels;
+    stream->wav_frame_bytes = bytes_per_frame;
     stream->wav_frames_read = 0;
 
+    if (sample_format != SAMPLE_S16 || fmt.num_channels != 2)
+        printf("WAV %s %s, converting to S16 stereo (%s)\n",
+               sample_format_name(sample_format),
+               fmt.num_channels == 1 ? "mono" : "stereo", convert_backend());
+
+    if (wav_window_sec > 0) {
+        // Bounded memory: only a window ahead of the play position is locked
+        size_t window = (size_t)(wav_window_sec * fmt.sample_rate) * bytes_per_frame;
+        stream->readahead = readahead_start(mapping, file_size, data_ptr,
+                                            bytes_per_frame,
+                                            &stream->wav_frames_read, window);
+        if (stream->readahead)
+            return 0;
+        fprintf(stderr, "WAV streaming unavailable, locking whole file\n");
+    }
+
     // Lock WAV data into RAM for real-time playback
     if (mlock(mapping, file_size) != 0) {
         perror("mlock WAV (continuing anyway)");
@@ -149,6 +260,7 @@ static int open_mp3(AudioStream *stream, const char *filename) {
     // Force output format: 16-bit signed, stereo, 44100Hz
     mpg123_param(mh, MPG123_FLAGS, MPG123_FORCE_STEREO, 0);
     mpg123_param(mh, MPG123_ADD_FLAGS, MPG123_QUIET, 0);
+    mpg123_param(mh, MPG123_INDEX_SIZE, -MP3_INDEX_GROW, 0);
 
     if (mpg123_open(mh, filename) != MPG123_OK) {
         fprintf(stderr, "mpg123_open: %s\n", mpg123_strerror(mh));
@@ -182,6 +294,49 @@ static int open_mp3(AudioStream *stream, const char *filename) {
     return 0;
 }
 
+// Whole-file parallel decode; afterwards the stream behaves like a WAV
+// whose mapping is the anonymous, mlocked PCM buffer
+static int open_preloaded(AudioStream *stream, const char *filename) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    PredecodedPcm pcm;
+    if (predecode_mp3(filename, preload_workers, &pcm) < 0) {
+        fprintf(stderr, "Parallel preload failed, streaming instead\n");
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    double audio_sec = (double)pcm.frames / pcm.sample_rate;
+    printf("Preloaded %.1f s of audio in %.2f s on %d workers (%.1fx real time)\n",
+           audio_sec, wall, preload_workers, wall > 0 ? audio_sec / wall : 0);
+
+    stream->format = AUDIO_FORMAT_WAV;
+    stream->preloaded = 1;
+    stream->sample_rate = pcm.sample_rate;
+    stream->channels = pcm.channels;
+    stream->total_frames = pcm.frames;
+    stream->mapping = pcm.pcm;
+    stream->mapping_size = pcm.bytes;
+    stream->wav_data = (const uint8_t *)pcm.pcm;
+    stream->wav_format = SAMPLE_S16;
+    stream->wav_channels = pcm.channels;
+    stream->wav_frame_bytes = pcm.channels * sizeof(int16_t);
+    stream->wav_frames_read = 0;
+
+    // Seed the PCM cache from memory while we have the whole song
+    if (pcm_cache_get_dir()) {
+        PcmCacheWriter *w = pcm_cache_begin(filename, pcm.sample_rate, pcm.channels);
+        if (w && pcm_cache_write(w, pcm.pcm, pcm.frames * pcm.channels) == 0)
+            pcm_cache_commit(w);
+        else
+            pcm_cache_abort(w);
+    }
+
+    return 0;
+}
+
 AudioStream *audio_open(const char *filename) {
     AudioFormat fmt = detect_format(filename);
     if (fmt == AUDIO_FORMAT_UNKNOWN) {
@@ -189,19 +344,42 @@ AudioStream *audio_open(const char *filename) {
         return NULL;
     }
 
-    AudioStream *stream = calloc(1, sizeof(AudioStream));
+    // Cache-line aligned so the ring's head/tail never share a line
+    AudioStream *stream = aligned_alloc(RING_CACHE_LINE, sizeof(AudioStream));
     if (!stream) {
-        perror("calloc AudioStream");
+        perror("aligned_alloc AudioStream");
         return NULL;
     }
+    memset(stream, 0, sizeof(AudioStream));
 
     stream->fd = -1;
+    snprintf(stream->path, sizeof(stream->path), "%s", filename);
 
     int result;
     if (fmt == AUDIO_FORMAT_WAV) {
         result = open_wav(stream, filename);
     } else {
-        result = open_mp3(stream, filename);
+        // A cached decode plays exactly like a WAV: mmap + mlock, no decoder
+        char cached[512];
+        result = -1;
+        if (pcm_cache_lookup(filename, cached, sizeof(cached)) == 0) {
+            result = open_wav(stream, cached);
+            if (result == 0)
+                stream->from_cache = 1;
+        }
+
+        if (result < 0 && preload_workers > 0) {
+            result = open_preloaded(stream, filename);
+        }
+
+        if (result < 0) {
+            result = open_mp3(stream, filename);
+
+            // First play: the decoder fills the cache as a side effect
+            if (result == 0 && pcm_cache_get_dir())
+                stream->cache_writer = pcm_cache_begin(filename, stream->sample_rate,
+                                                       stream->channels);
+        }
     }
 
     if (result < 0) {
@@ -211,22 +389,21 @@ AudioStream *audio_open(const char *filename) {
 
     // Allocate ring buffer for MP3 streaming
     if (stream->format == AUDIO_FORMAT_MP3) {
-        stream->ring_size = RING_BUFFER_SAMPLES;
-        stream->ring_buffer = calloc(stream->ring_size, sizeof(int16_t));
-        if (!stream->ring_buffer) {
+        if (ring_init(&stream->ring, RING_BUFFER_SAMPLES) < 0) {
             perror("calloc ring_buffer");
             audio_close(stream);
             return NULL;
         }
-
-        pthread_mutex_init(&stream->mutex, NULL);
-        pthread_cond_init(&stream->cond_space, NULL);
-        pthread_cond_init(&stream->cond_data, NULL);
     }
 
     return stream;
 }
 
+static void sleep_ms(long ms) {
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = ms * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
 // Decoder thread for MP3
 static void *mp3_decoder_thread(void *arg) {
     AudioStream *stream = (AudioStream *)arg;
@@ -247,8 +424,12 @@ static void *mp3_decoder_thread(void *arg) {
                               decode_samples * sizeof(int16_t), &done);
 
         if (ret == MPG123_DONE || done == 0) {
+            // Complete decode: publish the cache entry
+            if (stream->cache_writer && ret == MPG123_DONE) {
+                pcm_cache_commit(stream->cache_writer);
+                stream->cache_writer = NULL;
+            }
             stream->finished = 1;
-            pthread_cond_signal(&stream->cond_data);
             break;
         }
 
@@ -256,63 +437,36 @@ static void *mp3_decoder_thread(void *arg) {
             syslog(LOG_ERR, "mpg123_read error: %s", mpg123_strerror(mh));
             stream->error = 1;
             stream->finished = 1;
-            pthread_cond_signal(&stream->cond_data);
             break;
         }
 
         size_t samples_decoded = done / sizeof(int16_t);
+
+        if (stream->cache_writer &&
+            pcm_cache_write(stream->cache_writer, decode_buf, samples_decoded) != 0) {
+            syslog(LOG_WARNING, "PCM cache write failed, not caching this song");
+            pcm_cache_abort(stream->cache_writer);
+            stream->cache_writer = NULL;
+        }
         size_t samples_written = 0;
 
         while (samples_written < samples_decoded && !stream->error) {
-            pthread_mutex_lock(&stream->mutex);
-
-            // Calculate available space in ring buffer
-            size_t write_pos = stream->write_pos;
-            size_t read_pos = stream->read_pos;
-            size_t used = (write_pos >= read_pos) ?
-                          (write_pos - read_pos) :
-                          (stream->ring_size - read_pos + write_pos);
-            size_t space = stream->ring_size - used - 1;
-
-            // Wait if buffer is full
-            while (space < 2 && !stream->error) {
-                pthread_cond_wait(&stream->cond_space, &stream->mutex);
-                write_pos = stream->write_pos;
-                read_pos = stream->read_pos;
-                used = (write_pos >= read_pos) ?
-                       (write_pos - read_pos) :
-                       (stream->ring_size - read_pos + write_pos);
-                space = stream->ring_size - used - 1;
-            }
-
-            if (stream->error) {
-                pthread_mutex_unlock(&stream->mutex);
-                break;
-            }
-
-            // Write samples to ring buffer
+            // Only whole frames are published so the reader never sees
+            // half a stereo pair
             size_t to_write = samples_decoded - samples_written;
+            size_t space = ring_space(&stream->ring);
+            space -= space % stream->channels;
             if (to_write > space) to_write = space;
 
-            size_t first_chunk = stream->ring_size - write_pos;
-            if (first_chunk > to_write) first_chunk = to_write;
-
-            memcpy(&stream->ring_buffer[write_pos],
-                   &decode_buf[samples_written],
-                   first_chunk * sizeof(int16_t));
-
-            if (to_write > first_chunk) {
-                memcpy(&stream->ring_buffer[0],
-                       &decode_buf[samples_written + first_chunk],
-                       (to_write - first_chunk) * sizeof(int16_t));
+            if (to_write == 0) {
+                // Ring full: back off instead of blocking the reader
+                sleep_ms(DECODER_BACKOFF_MS);
+                continue;
             }
 
-            stream->write_pos = (write_pos + to_write) % stream->ring_size;
-            samples_written += to_write;
-
-            // Signal data available
-            pthread_cond_signal(&stream->cond_data);
-            pthread_mutex_unlock(&stream->mutex);
+            samples_written += ring_write(&stream->ring,
+                                          &decode_buf[samples_written],
+                                          to_write);
         }
     }
 
@@ -334,75 +488,219 @@ int audio_start(AudioStream *stream) {
 
         // Wait for initial buffer fill (MIN_BUFFER_MS worth of frames)
         size_t min_buffer_frames = (stream->sample_rate * MIN_BUFFER_MS) / 1000;
-        pthread_mutex_lock(&stream->mutex);
         while (audio_available(stream) < min_buffer_frames &&
                !stream->finished && !stream->error) {
-            pthread_cond_wait(&stream->cond_data, &stream->mutex);
+            sleep_ms(PREBUFFER_POLL_MS);
         }
-        pthread_mutex_unlock(&stream->mutex);
     }
 
     return 0;
 }
 
-int audio_read(AudioStream *stream, int16_t *buffer, size_t frames) {
-    if (!stream) return -1;
+static Mp3Index *mp3_index_lookup(const char *path, const struct stat *st) {
+    for (int i = 0; i < MP3_INDEX_CACHE; i++) {
+        Mp3Index *e = &mp3_index_cache[i];
+        if (e->offsets && strcmp(e->path, path) == 0 &&
+            e->size == st->st_size && e->mtime == st->st_mtime)
+            return e;
+    }
+    return NULL;
+}
 
-    size_t samples_needed = frames * stream->channels;
+static void mp3_index_store(const char *path, const struct stat *st, mpg123_handle *mh,
+                            off_t length) {
+    off_t *offsets, step;
+    size_t fill;
+    if (mpg123_index(mh, &offsets, &step, &fill) != MPG123_OK || fill == 0)
+        return;
+    off_t *copy = malloc(fill * sizeof(off_t));
+    if (!copy)
+        return;
+    memcpy(copy, offsets, fill * sizeof(off_t));
+
+    Mp3Index *e = &mp3_index_cache[mp3_index_next++ % MP3_INDEX_CACHE];
+    free(e->offsets);
+    snprintf(e->path, sizeof(e->path), "%s", path);
+    e->size = st->st_size;
+    e->mtime = st->st_mtime;
+    e->offsets = copy;
+    e->step = step;
+    e->fill = fill;
+    e->length = length;
+}
 
-    if (stream->format == AUDIO_FORMAT_WAV) {
-        // Direct read from mmap'd WAV
-        size_t frames_left = stream->total_frames - stream->wav_frames_read;
-        if (frames_left == 0) return -1;  // Finished
+// Index saved by an earlier run, handed to mpg123. -1 if there is none.
+static int mp3_index_read(const char *path, mpg123_handle *mh, off_t *length) {
+    char file[512];
+    if (pcm_cache_index_path(path, file, sizeof(file)) != 0)
+        return -1;
+    FILE *f = fopen(file, "rb");
+    if (!f)
+        return -1;
 
-        size_t to_read = (frames < frames_left) ? frames : frames_left;
-        size_t samples = to_read * stream->channels;
+    Mp3IndexFile h;
+    int64_t *raw = NULL;
+    off_t *offsets = NULL;
+    int rc = -1;
+    if (fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, MP3_INDEX_MAGIC, 8) == 0 &&
+        h.fill > 0 && h.fill < SIZE_MAX / sizeof(int64_t) &&
+        (raw = malloc(h.fill * sizeof(int64_t))) != NULL &&
+        (offsets = malloc(h.fill * sizeof(off_t))) != NULL &&
+        fread(raw, sizeof(int64_t), h.fill, f) == h.fill) {
+        for (uint64_t i = 0; i < h.fill; i++)
+            offsets[i] = (off_t)raw[i];
+        if (mpg123_set_index(mh, offsets, (off_t)h.step, (size_t)h.fill) == MPG123_OK) {
+            *length = (off_t)h.length;
+            rc = 0;
+        }
+    }
+    free(raw);
+    free(offsets);
+    fclose(f);
+    return rc;
+}
 
-        memcpy(buffer,
-               &stream->wav_pcm[stream->wav_frames_read * stream->channels],
-               samples * sizeof(int16_t));
+// Save mpg123's index for the next run (written aside, renamed into place)
+static void mp3_index_write(const char *path, mpg123_handle *mh, off_t length) {
+    char file[512], tmp[540];
+    off_t *offsets, step;
+    size_t fill;
+    if (pcm_cache_index_path(path, file, sizeof(file)) != 0 ||
+        mpg123_index(mh, &offsets, &step, &fill) != MPG123_OK || fill == 0)
+        return;
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%d", file, (int)getpid());
+    FILE *f = fopen(tmp, "wb");
+    if (!f)
+        return;
+
+    Mp3IndexFile h = { MP3_INDEX_MAGIC, step, length, fill };
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    for (size_t i = 0; ok && i < fill; i++) {
+        int64_t v = offsets[i];
+        ok = fwrite(&v, sizeof(v), 1, f) == 1;
+    }
+    if (fclose(f) != 0 || !ok || rename(tmp, file) != 0)
+        unlink(tmp);
+}
 
-        stream->wav_frames_read += to_read;
-        return (int)to_read;
+// Full frame index: remembered, saved in the PCM cache, or one pass over
+// the frame headers (no decoding), which also gives the exact length
+static int mp3_load_index(AudioStream *stream) {
+    mpg123_handle *mh = (mpg123_handle *)stream->decoder_handle;
+    struct stat st;
+    if (stat(stream->path, &st) != 0) {
+        perror(stream->path);
+        return -1;
     }
 
-    // MP3: read from ring buffer
-    pthread_mutex_lock(&stream->mutex);
+    off_t length;
+    Mp3Index *e = mp3_index_lookup(stream->path, &st);
+    if (e && mpg123_set_index(mh, e->offsets, e->step, e->fill) == MPG123_OK) {
+        length = e->length;
+    } else if (mp3_index_read(stream->path, mh, &length) == 0) {
+        mp3_index_store(stream->path, &st, mh, length);
+    } else {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (mpg123_scan(mh) != MPG123_OK) {
+            fprintf(stderr, "mpg123_scan: %s\n", mpg123_strerror(mh));
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        length = mpg123_length(mh);
+        mp3_index_store(stream->path, &st, mh, length);
+        mp3_index_write(stream->path, mh, length);
+        printf("Indexed MP3 frames in %.1f ms\n",
+               (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6);
+    }
 
-    size_t write_pos = stream->write_pos;
-    size_t read_pos = stream->read_pos;
-    size_t available = (write_pos >= read_pos) ?
-                       (write_pos - read_pos) :
-                       (stream->ring_size - read_pos + write_pos);
+    if (length > 0)
+        stream->total_frames = (size_t)length;
+    stream->indexed = 1;
+    return 0;
+}
 
-    if (available == 0) {
-        pthread_mutex_unlock(&stream->mutex);
-        if (stream->finished) return -1;
-        return 0;  // Buffer empty, try again
+int audio_seek(AudioStream *stream, size_t frame) {
+    if (!stream || stream->thread_running)
+        return -1;
+    if (frame == 0)
+        return 0;
+
+    if (stream->format == AUDIO_FORMAT_WAV) {
+        if (frame > stream->total_frames)
+            frame = stream->total_frames;
+        atomic_store(&stream->wav_frames_read, frame);
+
+        if (stream->readahead) {
+            // Start reading the window at the new position; the readahead
+            // thread locks it on its next poll
+            size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            size_t off = (size_t)(stream->wav_data - (const uint8_t *)stream->mapping) +
+                         frame * stream->wav_frame_bytes;
+            off -= off % page;
+            size_t len = (size_t)(wav_window_sec * stream->sample_rate) * stream->wav_frame_bytes;
+            if (len > stream->mapping_size - off)
+                len = stream->mapping_size - off;
+            madvise((uint8_t *)stream->mapping + off, len, MADV_WILLNEED);
+        }
+        return 0;
     }
 
-    size_t to_read = samples_needed;
-    if (to_read > available) to_read = available;
+    if (!stream->indexed && mp3_load_index(stream) < 0)
+        return -1;
+
+    // Only a complete decode can seed the PCM cache
+    if (stream->cache_writer) {
+        pcm_cache_abort(stream->cache_writer);
+        stream->cache_writer = NULL;
+    }
 
-    // Align to frame boundary
-    to_read = (to_read / stream->channels) * stream->channels;
+    if (stream->total_frames && frame >= stream->total_frames) {
+        stream->finished = 1;
+        return 0;
+    }
 
-    size_t first_chunk = stream->ring_size - read_pos;
-    if (first_chunk > to_read) first_chunk = to_read;
+    mpg123_handle *mh = (mpg123_handle *)stream->decoder_handle;
+    if (mpg123_seek(mh, (off_t)frame, SEEK_SET) < 0) {
+        fprintf(stderr, "mpg123_seek: %s\n", mpg123_strerror(mh));
+        return -1;
+    }
+    return 0;
+}
 
-    memcpy(buffer, &stream->ring_buffer[read_pos],
-           first_chunk * sizeof(int16_t));
+int audio_read(AudioStream *stream, int16_t *buffer, size_t frames) {
+    if (!stream) return -1;
 
-    if (to_read > first_chunk) {
-        memcpy(&buffer[first_chunk], &stream->ring_buffer[0],
-               (to_read - first_chunk) * sizeof(int16_t));
+    size_t samples_needed = frames * stream->channels;
+
+    if (stream->format == AUDIO_FORMAT_WAV) {
+        // Direct read from mmap'd WAV
+        size_t pos = atomic_load_explicit(&stream->wav_frames_read, memory_order_relaxed);
+        size_t frames_left = stream->total_frames - pos;
+        if (frames_left == 0) return -1;  // Finished
+
+        size_t to_read = (frames < frames_left) ? frames : frames_left;
+        const uint8_t *src = stream->wav_data + pos * stream->wav_frame_bytes;
+
+        if (stream->wav_format == SAMPLE_S16 && stream->wav_channels == stream->channels)
+            memcpy(buffer, src, to_read * stream->wav_frame_bytes);
+        else
+            convert_frames(buffer, SAMPLE_S16, stream->channels,
+                           src, stream->wav_format, stream->wav_channels, to_read);
+
+        // Readahead thread only needs to see the position eventually
+        atomic_store_explicit(&stream->wav_frames_read, pos + to_read,
+                              memory_order_relaxed);
+        return (int)to_read;
     }
 
-    stream->read_pos = (read_pos + to_read) % stream->ring_size;
+    // MP3: read from the lock-free ring (never blocks the RT thread).
+    // Check finished before draining so a final partial read still counts.
+    int decoder_done = stream->finished;
+    size_t to_read = ring_read(&stream->ring, buffer, samples_needed);
 
-    // Signal space available to decoder
-    pthread_cond_signal(&stream->cond_space);
-    pthread_mutex_unlock(&stream->mutex);
+    if (to_read == 0)
+        return decoder_done ? -1 : 0;  // Finished, or empty - try again
 
     return (int)(to_read / stream->channels);
 }
@@ -424,13 +722,7 @@ size_t audio_available(AudioStream *stream) {
         return stream->total_frames - stream->wav_frames_read;
     }
 
-    size_t write_pos = stream->write_pos;
-    size_t read_pos = stream->read_pos;
-    size_t samples = (write_pos >= read_pos) ?
-                     (write_pos - read_pos) :
-                     (stream->ring_size - read_pos + write_pos);
-
-    return samples / stream->channels;
+    return ring_used(&stream->ring) / stream->channels;
 }
 
 void audio_close(AudioStream *stream) {
@@ -439,27 +731,83 @@ void audio_close(AudioStream *stream) {
     // Stop decoder thread
     if (stream->thread_running) {
         stream->error = 1;  // Signal thread to stop
-        pthread_cond_signal(&stream->cond_space);
         pthread_join(stream->decoder_thread, NULL);
         stream->thread_running = 0;
     }
 
+    // Playback stopped before the decode completed: drop the partial entry
+    if (stream->cache_writer) {
+        pcm_cache_abort(stream->cache_writer);
+        stream->cache_writer = NULL;
+    }
+
     // Close format-specific resources
     if (stream->format == AUDIO_FORMAT_MP3 && stream->decoder_handle) {
         mpg123_close((mpg123_handle *)stream->decoder_handle);
         mpg123_delete((mpg123_handle *)stream->decoder_handle);
     }
 
+    if (stream->readahead) {
+        readahead_stop(stream->readahead);
+        stream->readahead = NULL;
+    }
+
     if (stream->mapping) {
         munmap(stream->mapping, stream->mapping_size);
     }
 
-    if (stream->ring_buffer) {
-        pthread_mutex_destroy(&stream->mutex);
-        pthread_cond_destroy(&stream->cond_space);
-        pthread_cond_destroy(&stream->cond_data);
-        free(stream->ring_buffer);
+    if (stream->ring.data) {
+        ring_free(&stream->ring);
     }
 
     free(stream);
 }
+
+size_t audio_peak_locked_bytes(const AudioStream *stream) {
+    if (!stream || !stream->mapping) return 0;
+    if (stream->readahead) return readahead_peak_locked(stream->readahead);
+    return stream->mapping_size;
+}
+
+const char *audio_format_name(const AudioStream *stream) {
+    if (!stream) return "NONE";
+    if (stream->from_cache) return "MP3 (cached)";
+    if (stream->preloaded) return "MP3 (preloaded)";
+    return stream->format == AUDIO_FORMAT_MP3 ? "MP3" : "WAV";
+}
+
+int audio_precache(const char *filename) {
+    AudioStream stream = {0};
+    if (open_mp3(&stream, filename) < 0)
+        return -1;
+
+    mpg123_handle *mh = (mpg123_handle *)stream.decoder_handle;
+    PcmCacheWriter *w = pcm_cache_begin(filename, stream.sample_rate, stream.channels);
+    const size_t decode_samples = (stream.sample_rate / 10) * stream.channels;
+    int16_t *decode_buf = malloc(decode_samples * sizeof(int16_t));
+    int result = -1;
+
+    if (w && decode_buf) {
+        for (;;) {
+            size_t done = 0;
+            int ret = mpg123_read(mh, (unsigned char *)decode_buf,
+                                  decode_samples * sizeof(int16_t), &done);
+            if (ret == MPG123_DONE || (ret == MPG123_OK && done == 0)) {
+                result = pcm_cache_commit(w);
+                w = NULL;
+                break;
+            }
+            if ((ret != MPG123_OK && ret != MPG123_NEW_FORMAT) ||
+                pcm_cache_write(w, decode_buf, done / sizeof(int16_t)) != 0) {
+                fprintf(stderr, "precache %s: %s\n", filename, mpg123_strerror(mh));
+                break;
+            }
+        }
+    }
+
+    pcm_cache_abort(w);
+    free(decode_buf);
+    mpg123_close(mh);
+    mpg123_delete(mh);
+    return result;
+}
@@ -0,0 +1,226 @@
+#include "avclock.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define PLL_ZETA  0.7   // Damping
+// Published models rotate through these. Slips publish several times a
+// period, so the audio thread may come back to the slot the LED thread is
+// copying: each slot carries a sequence, and a torn copy is taken again
+// from the newest slot (never the one being written, so it cannot spin on
+// a writer it preempted).
+#define MODEL_SLOTS 4
+
+typedef struct {
+    int64_t t0_ns;      // CLOCK_MONOTONIC anchor
+    double p0_ns;       // Song position at the anchor
+    double rate;        // Song ns per monotonic ns
+} AvModel;
+
+typedef struct {
+    atomic_uint seq;    // Odd while the audio thread rewrites the slot
+    AvModel m;
+} AvSlot;
+
+static int lock_enabled = 1;
+static unsigned int rate_hz = 0;
+
+static AvSlot models[MODEL_SLOTS];
+static unsigned int model_next = 0;
+static _Atomic(AvSlot *) model = NULL;
+
+// Loop state, audio thread only
+static int pll_locked = 0;
+static int64_t pll_t_ns;
+static double pll_p_ns;
+static double pll_rate;
+
+// Audio thread stats, read after join
+static uint64_t observations;
+static unsigned int relocks;
+static double residual_sq_sum, residual_max;
+static uint64_t residuals;
+// Least-squares drift since the last (re)lock: y = position - elapsed vs x = elapsed
+static int64_t base_t_ns;
+static double base_p_ns;
+static double fit_n, fit_x, fit_y, fit_xx, fit_xy;
+
+// LED thread stats, read after join
+static uint64_t offset_count;
+static double offset_sum, offset_max;
+
+static inline int64_t ts_ns(struct timespec t) {
+    return (int64_t)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+void avclock_set_lock(int enabled) {
+    lock_enabled = enabled;
+}
+
+int avclock_lock_enabled(void) {
+    return lock_enabled;
+}
+
+void avclock_song_start(unsigned int device_rate) {
+    rate_hz = device_rate;
+    atomic_store(&model, NULL);
+    model_next = 0;
+    pll_locked = 0;
+    pll_rate = 1.0;
+    observations = 0;
+    relocks = 0;
+    residual_sq_sum = residual_max = 0;
+    residuals = 0;
+    fit_n = fit_x = fit_y = fit_xx = fit_xy = 0;
+    offset_count = 0;
+    offset_sum = offset_max = 0;
+}
+
+int avclock_active(void) {
+    return rate_hz != 0;
+}
+
+static void publish(void) {
+    AvSlot *slot = &models[model_next];
+    model_next = (model_next + 1) % MODEL_SLOTS;
+    unsigned int seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->m.t0_ns = pll_t_ns;
+    slot->m.p0_ns = pll_p_ns;
+    slot->m.rate = pll_rate;
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&model, slot, memory_order_release);
+}
+
+// LED thread: a whole copy of the current model
+static AvModel current_model(void) {
+    for (;;) {
+        AvSlot *slot = atomic_load_explicit(&model, memory_order_acquire);
+        unsigned int seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        AvModel m = slot->m;
+        atomic_thread_fence(memory_order_acquire);
+        if (!(seq & 1) && atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq)
+            return m;
+    }
+}
+
+// Take the sample as the new phase; the rate estimate survives a relock
+static void snap(int64_t t, double p) {
+    pll_t_ns = t;
+    pll_p_ns = p;
+    pll_locked = 1;
+    base_t_ns = t;
+    base_p_ns = p;
+    fit_n = fit_x = fit_y = fit_xx = fit_xy = 0;
+    publish();
+}
+
+void avclock_observe(struct timespec now, int64_t played_frames) {
+    if (rate_hz == 0)
+        return;
+
+    int64_t t = ts_ns(now);
+    double p = (double)played_frames * 1e9 / rate_hz;
+    observations++;
+
+    if (!pll_locked) {
+        snap(t, p);
+        return;
+    }
+
+    double dt = (t - pll_t_ns) / 1e9;
+    if (dt <= 0)
+        return;
+
+    // Error in song ns, positive when the audio is ahead of the clock
+    double predicted = pll_p_ns + (t - pll_t_ns) * pll_rate;
+    double err = p - predicted;
+    if (fabs(err) > AVCLOCK_STEP_US * 1000.0) {
+        relocks++;
+        snap(t, p);
+        return;
+    }
+
+    // Type-2 loop: proportional phase pull, integral term on the rate
+    const double wn = 1.0 / AVCLOCK_TAU_SEC;
+    double kp = 2.0 * PLL_ZETA * wn * dt;
+    pll_p_ns = predicted + (kp < 1.0 ? kp : 1.0) * err;
+    pll_rate += wn * wn * dt * err / 1e9;
+    if (pll_rate > 1.0 + AVCLOCK_MAX_PPM / 1e6)
+        pll_rate = 1.0 + AVCLOCK_MAX_PPM / 1e6;
+    if (pll_rate < 1.0 - AVCLOCK_MAX_PPM / 1e6)
+        pll_rate = 1.0 - AVCLOCK_MAX_PPM / 1e6;
+    pll_t_ns = t;
+    publish();
+
+    residual_sq_sum += err * err;
+    if (fabs(err) > residual_max)
+        residual_max = fabs(err);
+    residuals++;
+
+    double x = (t - base_t_ns) / 1e9;
+    double y = (p - base_p_ns) / 1e9 - x;
+    fit_n++;
+    fit_x += x;
+    fit_y += y;
+    fit_xx += x * x;
+    fit_xy += x * y;
+}
+
+int avclock_locked(void) {
+    return atomic_load_explicit(&model, memory_order_acquire) != NULL;
+}
+
+struct timespec avclock_deadline(uint64_t song_us) {
+    AvModel m = current_model();
+    int64_t t = m.t0_ns + (int64_t)llround(((double)song_us * 1000.0 - m.p0_ns) / m.rate);
+    return (struct timespec){ .tv_sec = t / 1000000000LL, .tv_nsec = t % 1000000000LL };
+}
+
+void avclock_slip(int64_t frames) {
+    if (rate_hz == 0 || !pll_locked)
+        return;
+    double ns = (double)frames * 1e9 / rate_hz;
+    pll_p_ns += ns;
+    base_p_ns += ns;
+    publish();
+}
+
+double avclock_position_us(struct timespec when) {
+    AvModel m = current_model();
+    return (m.p0_ns + (ts_ns(when) - m.t0_ns) * m.rate) / 1000.0;
+}
+
+void avclock_note_commit(uint64_t song_us, struct timespec when) {
+    if (!avclock_locked())
+        return;
+
+    // Where the audio was at the commit, minus where the cue sits
+    double off = avclock_position_us(when) - (double)song_us;
+    offset_sum += off;
+    if (fabs(off) > offset_max)
+        offset_max = fabs(off);
+    offset_count++;
+}
+
+void avclock_get_stats(AvClockStats *stats, int led_locked) {
+    memset(stats, 0, sizeof(*stats));
+    stats->locked = led_locked;
+    stats->observations = observations;
+    stats->relocks = relocks;
+    stats->pll_ppm = (pll_rate - 1.0) * 1e6;
+    stats->drift_ppm = stats->pll_ppm;
+    double den = fit_n * fit_xx - fit_x * fit_x;
+    if (fit_n >= 2 && den > 0)
+        stats->drift_ppm = (fit_n * fit_xy - fit_x * fit_y) / den * 1e6;
+    if (residuals > 0) {
+        stats->residual_rms_us = sqrt(residual_sq_sum / residuals) / 1000.0;
+        stats->residual_max_us = residual_max / 1000.0;
+    }
+    stats->offsets = offset_count;
+    if (offset_count > 0)
+        stats->offset_avg_us = offset_sum / offset_count;
+    stats->offset_max_us = offset_max;
+}
@@ -0,0 +1,1186 @@
+#include "bench.h"
+#include "ring.h"
+#include "predecode.h"
+#include "audio.h"
+#include "convert.h"
+#include "resample.h"
+#include "dsp.h"
+#include "pixels.h"
+#include "output.h"
+#include "gpio.h"
+#include "avclock.h"
+#include "netsync.h"
+#include "show.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <math.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define BENCH_RATE          44100
+#define BENCH_CHANNELS      2
+#define BENCH_PERIOD_FRAMES (BENCH_RATE / 100)  // 10ms, like the audio thread
+#define BENCH_CHUNK_FRAMES  (BENCH_RATE / 10)   // 100ms, like the decoder
+#define BENCH_RING_SAMPLES  (1 << 18)
+#define BENCH_RING_SECONDS  3
+
+// --------------------------------------------------------------
+// Helpers
+// --------------------------------------------------------------
+static long time_diff_ns(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1000000000L +
+           (end.tv_nsec - start.tv_nsec);
+}
+
+static int cmp_long(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_latency(const char *label, long *ns, size_t count) {
+    if (count == 0) {
+        printf("%-12s no samples\n", label);
+        return;
+    }
+    qsort(ns, count, sizeof(long), cmp_long);
+    double sum = 0;
+    for (size_t i = 0; i < count; i++)
+        sum += ns[i];
+    printf("%-12s n=%zu min=%.2f avg=%.2f p99=%.2f p99.9=%.2f max=%.2f us\n",
+           label, count, ns[0] / 1000.0, sum / count / 1000.0,
+           ns[count * 99 / 100] / 1000.0, ns[count * 999 / 1000] / 1000.0,
+           ns[count - 1] / 1000.0);
+}
+
+// Run the calling thread as the audio thread does (SCHED_FIFO 75)
+static void bench_make_rt(void) {
+    struct sched_param param = {.sched_priority = 75};
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+        printf("(SCHED_FIFO unavailable, reader runs at normal priority)\n");
+}
+
+// --------------------------------------------------------------
+// ring: worst-case audio_read() latency, lock-free vs mutex ring
+// --------------------------------------------------------------
+
+// Reference copy of the previous mutex + condvar ring, kept only
+// so the benchmark can compare against it.
+typedef struct {
+    int16_t *buf;
+    size_t size;
+    size_t write_pos, read_pos;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_space;
+} MutexRing;
+
+typedef struct {
+    int use_mutex;
+    SpscRing spsc;
+    MutexRing locked;
+    atomic_int stop;
+} RingBench;
+
+static size_t mutex_ring_used(MutexRing *r) {
+    return (r->write_pos >= r->read_pos) ?
+           (r->write_pos - r->read_pos) :
+           (r->size - r->read_pos + r->write_pos);
+}
+
+static void mutex_ring_write(RingBench *b, const int16_t *src, size_t count) {
+    MutexRing *r = &b->locked;
+    size_t written = 0;
+    while (written < count && !b->stop) {
+        pthread_mutex_lock(&r->mutex);
+        size_t space = r->size - mutex_ring_used(r) - 1;
+        while (space < 2 && !b->stop) {
+            pthread_cond_wait(&r->cond_space, &r->mutex);
+            space = r->size - mutex_ring_used(r) - 1;
+        }
+        size_t n = count - written;
+        if (n > space) n = space;
+        size_t first = r->size - r->write_pos;
+        if (first > n) first = n;
+        memcpy(&r->buf[r->write_pos], &src[written], first * sizeof(int16_t));
+        memcpy(r->buf, &src[written + first], (n - first) * sizeof(int16_t));
+        r->write_pos = (r->write_pos + n) % r->size;
+        written += n;
+        pthread_mutex_unlock(&r->mutex);
+    }
+}
+
+static size_t mutex_ring_read(MutexRing *r, int16_t *dst, size_t count) {
+    pthread_mutex_lock(&r->mutex);
+    size_t used = mutex_ring_used(r);
+    if (count > used) count = used;
+    size_t first = r->size - r->read_pos;
+    if (first > count) first = count;
+    memcpy(dst, &r->buf[r->read_pos], first * sizeof(int16_t));
+    memcpy(&dst[first], r->buf, (count - first) * sizeof(int16_t));
+    r->read_pos = (r->read_pos + count) % r->size;
+    pthread_cond_signal(&r->cond_space);
+    pthread_mutex_unlock(&r->mutex);
+    return count;
+}
+
+static void *ring_bench_producer(void *arg) {
+    RingBench *b = arg;
+    size_t chunk = BENCH_CHUNK_FRAMES * BENCH_CHANNELS;
+    int16_t *src = calloc(chunk, sizeof(int16_t));
+    if (!src) return NULL;
+
+    while (!b->stop) {
+        if (b->use_mutex) {
+            mutex_ring_write(b, src, chunk);
+        } else {
+            size_t done = 0;
+            while (done < chunk && !b->stop) {
+                size_t n = ring_write(&b->spsc, &src[done], chunk - done);
+                if (n == 0) sched_yield();
+                done += n;
+            }
+        }
+    }
+
+    free(src);
+    return NULL;
+}
+
+static void ring_bench_run(RingBench *b, long *lat, size_t max_samples,
+                           size_t *count) {
+    size_t period = BENCH_PERIOD_FRAMES * BENCH_CHANNELS;
+    int16_t *dst = calloc(period, sizeof(int16_t));
+    if (!dst) return;
+
+    atomic_store(&b->stop, 0);
+    pthread_t producer;
+    pthread_create(&producer, NULL, ring_bench_producer, b);
+
+    struct timespec begin, now, t0, t1;
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 200000 };
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    *count = 0;
+
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (b->use_mutex)
+            mutex_ring_read(&b->locked, dst, period);
+        else
+            ring_read(&b->spsc, dst, period);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        if (*count < max_samples)
+            lat[(*count)++] = time_diff_ns(t0, t1);
+
+        nanosleep(&pause, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while (time_diff_ns(begin, now) < BENCH_RING_SECONDS * 1000000000L);
+
+    atomic_store(&b->stop, 1);
+    if (b->use_mutex) {
+        pthread_mutex_lock(&b->locked.mutex);
+        pthread_cond_broadcast(&b->locked.cond_space);
+        pthread_mutex_unlock(&b->locked.mutex);
+    }
+    pthread_join(producer, NULL);
+    free(dst);
+}
+
+static int bench_ring(const char *arg) {
+    const size_t max_samples = 100000;
+    long *lat = malloc(max_samples * sizeof(long));
+    RingBench *b = aligned_alloc(RING_CACHE_LINE, sizeof(RingBench));
+    if (!lat || !b) {
+        free(lat);
+        free(b);
+        return 1;
+    }
+    memset(b, 0, sizeof(*b));
+
+    if (ring_init(&b->spsc, BENCH_RING_SAMPLES) < 0) {
+        free(lat);
+        free(b);
+        return 1;
+    }
+    b->locked.size = BENCH_RING_SAMPLES;
+    b->locked.buf = calloc(b->locked.size, sizeof(int16_t));
+    pthread_mutex_init(&b->locked.mutex, NULL);
+    pthread_cond_init(&b->locked.cond_space, NULL);
+
+    printf("Reader: %d frames every 200 us, writer: %d-frame chunks, %d s each\n",
+           BENCH_PERIOD_FRAMES, BENCH_CHUNK_FRAMES, BENCH_RING_SECONDS);
+    bench_make_rt();
+
+    size_t count;
+    b->use_mutex = 1;
+    ring_bench_run(b, lat, max_samples, &count);
+    print_latency("mutex ring", lat, count);
+
+    b->use_mutex = 0;
+    ring_bench_run(b, lat, max_samples, &count);
+    print_latency("spsc ring", lat, count);
+
+    pthread_mutex_destroy(&b->locked.mutex);
+    pthread_cond_destroy(&b->locked.cond_space);
+    free(b->locked.buf);
+    ring_free(&b->spsc);
+    free(b);
+    free(lat);
+    return 0;
+}
+
+// --------------------------------------------------------------
+// predecode: parallel MP3 decode throughput for 1..N workers
+// --------------------------------------------------------------
+static int bench_predecode(const char *arg) {
+    if (!arg) {
+        fprintf(stderr, "usage: -b predecode file.mp3\n");
+        return 1;
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+
+    printf("workers  wall_s  audio_s  audio_s/wall_s  speedup\n");
+    double base = 0;
+    for (int w = 1; w <= cpus; w++) {
+        struct timespec t0, t1;
+        PredecodedPcm pcm;
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (predecode_mp3(arg, w, &pcm) < 0) {
+            fprintf(stderr, "predecode failed with %d workers\n", w);
+            return 1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        double wall = time_diff_ns(t0, t1) / 1e9;
+        double audio = (double)pcm.frames / pcm.sample_rate;
+        double rate = wall > 0 ? audio / wall : 0;
+        if (w == 1) base = rate;
+        printf("%7d  %6.2f  %7.1f  %14.1f  %6.2fx\n",
+               w, wall, audio, rate, base > 0 ? rate / base : 0);
+        predecode_free(&pcm);
+    }
+    return 0;
+}
+
+// --------------------------------------------------------------
+// wavstream: whole-file mlock vs locked sliding window
+// --------------------------------------------------------------
+#define WAVSTREAM_WINDOW_SEC 2.0
+
+static long read_status_kb(const char *key) {
+    FILE *f = fopen("/proc/self/status", "r");
+    if (!f) return 0;
+    char line[128];
+    long kb = 0;
+    size_t key_len = strlen(key);
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, key, key_len) == 0) {
+            kb = atol(line + key_len);
+            break;
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+// Evict the file from the page cache so both modes start cold
+static void drop_file_cache(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+static int wavstream_run(const char *path, double window_sec) {
+    drop_file_cache(path);
+    audio_set_wav_window(window_sec);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    AudioStream *stream = audio_open(path);
+    if (!stream || audio_start(stream) < 0) {
+        fprintf(stderr, "cannot open %s\n", path);
+        audio_close(stream);
+        return 1;
+    }
+
+    size_t period = stream->sample_rate / 100;
+    int16_t *buf = malloc(period * stream->channels * sizeof(int16_t));
+    if (!buf) {
+        audio_close(stream);
+        return 1;
+    }
+    audio_read(stream, buf, period);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    // Play through at ~50x real time (10ms of audio every 200us)
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 200000 };
+    long peak_rss = read_status_kb("VmRSS:");
+    long peak_lck = read_status_kb("VmLck:");
+    size_t n = 0;
+    while (audio_read(stream, buf, period) > 0) {
+        if (++n % 50 == 0) {
+            long rss = read_status_kb("VmRSS:");
+            long lck = read_status_kb("VmLck:");
+            if (rss > peak_rss) peak_rss = rss;
+            if (lck > peak_lck) peak_lck = lck;
+        }
+        nanosleep(&pause, NULL);
+    }
+
+    printf("%-16s first sample %8.1f ms  peak RSS %7.1f MB  peak locked %7.1f MB\n",
+           window_sec > 0 ? "window 2 s" : "whole-file mlock",
+           time_diff_ns(t0, t1) / 1e6, peak_rss / 1024.0, peak_lck / 1024.0);
+
+    free(buf);
+    audio_close(stream);
+    return 0;
+}
+
+static int bench_wavstream(const char *arg) {
+    if (!arg) {
+        fprintf(stderr, "usage: -b wavstream file.wav\n");
+        return 1;
+    }
+    if (wavstream_run(arg, 0) != 0)
+        return 1;
+    return wavstream_run(arg, WAVSTREAM_WINDOW_SEC);
+}
+
+// --------------------------------------------------------------
+// convert: sample-format kernels, SIMD vs scalar
+// --------------------------------------------------------------
+#define CONVERT_BENCH_RATE  48000
+#define CONVERT_BENCH_CHUNK 480     // 10ms periods, as audio_read() sees them
+
+static void convert_fill(uint8_t *buf, SampleFormat fmt, size_t samples) {
+    uint32_t x = 12345;
+    for (size_t i = 0; i < samples; i++) {
+        x = x * 1664525u + 1013904223u;
+        if (fmt == SAMPLE_FLOAT) {
+            // Slightly beyond full scale so the clamp paths are exercised
+            float f = ((int32_t)x / 2147483648.0f) * 1.1f;
+            memcpy(buf + i * 4, &f, 4);
+        } else {
+            memcpy(buf + i * sample_format_bytes(fmt), &x, sample_format_bytes(fmt));
+        }
+    }
+}
+
+// Seconds spent converting 'frames' frames in period-sized calls
+static double convert_time(void *dst, SampleFormat dst_fmt, unsigned dst_ch,
+                           const uint8_t *src, SampleFormat src_fmt, unsigned src_ch,
+                           size_t frames) {
+    size_t in_frame = sample_format_bytes(src_fmt) * src_ch;
+    size_t out_frame = sample_format_bytes(dst_fmt) * dst_ch;
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t f = 0; f + CONVERT_BENCH_CHUNK <= frames; f += CONVERT_BENCH_CHUNK)
+        convert_frames((uint8_t *)dst + f * out_frame, dst_fmt, dst_ch,
+                       src + f * in_frame, src_fmt, src_ch, CONVERT_BENCH_CHUNK);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return time_diff_ns(t0, t1) / 1e9;
+}
+
+// Largest per-sample difference between the two outputs
+static long convert_max_diff(const void *a, const void *b, SampleFormat fmt, size_t samples) {
+    long worst = 0;
+    for (size_t i = 0; i < samples; i++) {
+        long d = fmt == SAMPLE_S32 ?
+            labs((long)((const int32_t *)a)[i] - ((const int32_t *)b)[i]) :
+            labs((long)((const int16_t *)a)[i] - ((const int16_t *)b)[i]);
+        if (d > worst) worst = d;
+    }
+    return worst;
+}
+
+static int bench_convert(const char *arg) {
+    double seconds = arg ? atof(arg) : 10.0;
+    if (seconds <= 0) seconds = 10.0;
+    size_t frames = (size_t)(seconds * CONVERT_BENCH_RATE);
+    frames -= frames % CONVERT_BENCH_CHUNK;
+
+    uint8_t *src = malloc(frames * 2 * 4);
+    void *out_simd = malloc(frames * 2 * 4);
+    void *out_scalar = malloc(frames * 2 * 4);
+    if (!src || !out_simd || !out_scalar) {
+        fprintf(stderr, "convert bench: out of memory\n");
+        free(src); free(out_simd); free(out_scalar);
+        return 1;
+    }
+
+    printf("%.0f s of %d Hz audio, %s kernels vs scalar\n",
+           seconds, CONVERT_BENCH_RATE, convert_backend());
+    printf("%-9s %-5s %-10s %10s %10s %8s %9s %8s\n", "input", "out", "channels",
+           "scalar", "simd", "speedup", "CPU @48k", "maxdiff");
+
+    const SampleFormat inputs[] = { SAMPLE_S16, SAMPLE_S24_3LE, SAMPLE_S32, SAMPLE_FLOAT };
+    const SampleFormat outputs[] = { SAMPLE_S16, SAMPLE_S32 };
+
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        for (size_t o = 0; o < sizeof(outputs) / sizeof(outputs[0]); o++) {
+            for (unsigned src_ch = 1; src_ch <= 2; src_ch++) {
+                SampleFormat in = inputs[i], out = outputs[o];
+                if (in == out && src_ch == 2)
+                    continue;  // plain memcpy
+                convert_fill(src, in, frames * src_ch);
+
+                convert_force_scalar(1);
+                double t_scalar = convert_time(out_scalar, out, 2, src, in, src_ch, frames);
+                convert_force_scalar(0);
+                double t_simd = convert_time(out_simd, out, 2, src, in, src_ch, frames);
+
+                printf("%-9s %-5s %-10s %8.2fms %8.2fms %7.1fx %8.3f%% %8ld\n",
+                       sample_format_name(in), out == SAMPLE_S16 ? "S16" : "S32",
+                       src_ch == 1 ? "mono->2ch" : "stereo",
+                       t_scalar * 1e3, t_simd * 1e3,
+                       t_simd > 0 ? t_scalar / t_simd : 0,
+                       t_simd / seconds * 100.0,
+                       convert_max_diff(out_simd, out_scalar, out, frames * 2));
+            }
+        }
+    }
+
+    free(src);
+    free(out_simd);
+    free(out_scalar);
+    return 0;
+}
+
+// --------------------------------------------------------------
+// resample: CPU cost per second of audio and SNR, both qualities
+// --------------------------------------------------------------
+#define RESAMPLE_BENCH_TONE_HZ 1000.0
+#define RESAMPLE_BENCH_PERIOD_MS 10
+
+#if defined(RPI1)
+#define BENCH_PLATFORM "RPI1"
+#elif defined(RPI2)
+#define BENCH_PLATFORM "RPI2"
+#elif defined(RPI3)
+#define BENCH_PLATFORM "RPI3"
+#elif defined(RPI4)
+#define BENCH_PLATFORM "RPI4"
+#else
+#define BENCH_PLATFORM "unknown"
+#endif
+
+typedef struct {
+    const int16_t *pcm;
+    size_t frames, pos;
+} ToneSource;
+
+static int tone_source_read(void *ctx, int16_t *buffer, size_t frames) {
+    ToneSource *src = ctx;
+    size_t left = src->frames - src->pos;
+    if (left == 0) return -1;
+    if (frames > left) frames = left;
+    memcpy(buffer, src->pcm + src->pos * 2, frames * 2 * sizeof(int16_t));
+    src->pos += frames;
+    return (int)frames;
+}
+
+// Signal-to-noise of a resampled tone against the ideal tone at the
+// output rate, skipping the filter ramp at both ends
+static double tone_snr_db(const int16_t *out, size_t frames, uint32_t rate) {
+    double sig = 0, err = 0;
+    size_t skip = rate / 100;
+    for (size_t i = skip; i + skip < frames; i++) {
+        double ideal = 16384.0 * sin(2 * M_PI * RESAMPLE_BENCH_TONE_HZ * i / rate);
+        double d = out[2 * i] - ideal;
+        sig += ideal * ideal;
+        err += d * d;
+    }
+    return err > 0 ? 10 * log10(sig / err) : 200;
+}
+
+static int bench_resample(const char *arg) {
+    double seconds = arg ? atof(arg) : 10.0;
+    if (seconds <= 0) seconds = 10.0;
+
+    static const uint32_t pairs[][2] = {
+        { 44100, 48000 }, { 32000, 48000 }, { 48000, 44100 }, { 32000, 44100 },
+    };
+    const ResampleQuality qualities[] = { RESAMPLE_FAST, RESAMPLE_HIGH };
+
+    printf("PLATFORM=%s, %.0f s of %g Hz tone per run, %d ms output periods\n",
+           BENCH_PLATFORM, seconds, RESAMPLE_BENCH_TONE_HZ, RESAMPLE_BENCH_PERIOD_MS);
+    printf("%-15s %-5s %5s %12s %12s %8s\n", "conversion", "mode", "taps",
+           "ms/s audio", "CPU", "SNR");
+
+    for (size_t p = 0; p < sizeof(pairs) / sizeof(pairs[0]); p++) {
+        uint32_t in_rate = pairs[p][0], out_rate = pairs[p][1];
+        size_t in_frames = (size_t)(seconds * in_rate);
+        size_t out_cap = (size_t)(seconds * out_rate) + out_rate;
+        int16_t *in = malloc(in_frames * 2 * sizeof(int16_t));
+        int16_t *out = malloc(out_cap * 2 * sizeof(int16_t));
+        if (!in || !out) {
+            free(in);
+            free(out);
+            return 1;
+        }
+        for (size_t i = 0; i < in_frames; i++)
+            in[2 * i] = in[2 * i + 1] =
+                (int16_t)lrint(16384.0 * sin(2 * M_PI * RESAMPLE_BENCH_TONE_HZ * i / in_rate));
+
+        for (size_t q = 0; q < sizeof(qualities) / sizeof(qualities[0]); q++) {
+            Resampler *r = resampler_create(in_rate, out_rate, qualities[q]);
+            if (!r) continue;
+
+            ToneSource src = { .pcm = in, .frames = in_frames };
+            size_t period = out_rate * RESAMPLE_BENCH_PERIOD_MS / 1000;
+            size_t produced = 0;
+            struct timespec t0, t1;
+
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            while (produced + period <= out_cap) {
+                int n = resampler_read(r, out + produced * 2, period, tone_source_read, &src);
+                if (n <= 0) break;
+                produced += n;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+
+            double ms = time_diff_ns(t0, t1) / 1e6;
+            char label[32];
+            snprintf(label, sizeof(label), "%u->%u", in_rate, out_rate);
+            printf("%-15s %-5s %5u %12.3f %11.3f%% %6.1f dB\n", label,
+                   resample_quality_name(qualities[q]), resampler_taps(r),
+                   ms / seconds, ms / seconds / 10.0,
+                   tone_snr_db(out, produced, out_rate));
+            resampler_free(r);
+        }
+        free(in);
+        free(out);
+    }
+    return 0;
+}
+
+// --------------------------------------------------------------
+// dsp: gain / fade / limiter stage cost per 10ms period
+// --------------------------------------------------------------
+#define DSP_BENCH_RATE    48000
+#define DSP_BENCH_PERIOD  (DSP_BENCH_RATE / 100)
+
+typedef struct {
+    const char *label;
+    double gain_db;
+    int limiter;
+    unsigned int fade_in_ms;
+} DspCase;
+
+// Average ns per period over 'periods' periods of a loud tone
+static double dsp_time(const DspCase *c, int16_t *buf, const int16_t *src, size_t periods) {
+    dsp_set_gain_db(c->gain_db);
+    dsp_set_limiter(c->limiter);
+    dsp_set_fades(c->fade_in_ms, 0, 0);
+    dsp_song_start(DSP_BENCH_RATE, 0);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (size_t p = 0; p < periods; p++) {
+        int16_t *out = buf + p * DSP_BENCH_PERIOD * 2;
+        memcpy(out, src + p * DSP_BENCH_PERIOD * 2, DSP_BENCH_PERIOD * 2 * sizeof(int16_t));
+        dsp_process(out, DSP_BENCH_PERIOD);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (double)time_diff_ns(t0, t1) / periods;
+}
+
+static int bench_dsp(const char *arg) {
+    double seconds = arg ? atof(arg) : 10.0;
+    if (seconds <= 0) seconds = 10.0;
+    size_t periods = (size_t)(seconds * 100);
+    size_t samples = periods * DSP_BENCH_PERIOD * 2;
+
+    int16_t *src = malloc(samples * sizeof(int16_t));
+    int16_t *out_simd = malloc(samples * sizeof(int16_t));
+    int16_t *out_scalar = malloc(samples * sizeof(int16_t));
+    if (!src || !out_simd || !out_scalar) {
+        free(src); free(out_simd); free(out_scalar);
+        return 1;
+    }
+    // -3 dBFS tone: +6 dB of gain pushes it well into the limiter knee
+    for (size_t i = 0; i < samples / 2; i++)
+        src[2 * i] = src[2 * i + 1] =
+            (int16_t)lrint(23170.0 * sin(2 * M_PI * 440.0 * i / DSP_BENCH_RATE));
+
+    const DspCase cases[] = {
+        { "gain -6 dB", -6.0, 0, 0 },
+        { "gain +6 dB + limiter", 6.0, 1, 0 },
+        { "fade-in (whole run)", 0.0, 1, (unsigned int)(seconds * 1000) },
+    };
+
+    printf("%.0f s at %d Hz, %d-frame periods\n", seconds, DSP_BENCH_RATE, DSP_BENCH_PERIOD);
+    printf("%-22s %12s %12s %8s %8s\n", "case", "scalar", "simd", "speedup", "match");
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        dsp_force_scalar(1);
+        double t_scalar = dsp_time(&cases[c], out_scalar, src, periods);
+        dsp_force_scalar(0);
+        double t_simd = dsp_time(&cases[c], out_simd, src, periods);
+        int match = memcmp(out_scalar, out_simd, samples * sizeof(int16_t)) == 0;
+        printf("%-22s %9.2f us %9.2f us %7.1fx %8s\n", cases[c].label,
+               t_scalar / 1000.0, t_simd / 1000.0,
+               t_simd > 0 ? t_scalar / t_simd : 0, match ? "yes" : "NO");
+    }
+
+    // Leave the stage as the command line would have it
+    dsp_set_gain_db(0);
+    dsp_set_limiter(0);
+
+    free(src);
+    free(out_simd);
+    free(out_scalar);
+    return 0;
+}
+
+// --------------------------------------------------------------
+// ws2812: pixel encode cost, wire time and frame rate per strip size
+// --------------------------------------------------------------
+#define WS2812_BENCH_FRAMES 200
+
+static double ws2812_encode_time(uint8_t *dst, const uint8_t *grb, size_t pixels) {
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int f = 0; f < WS2812_BENCH_FRAMES; f++)
+        ws2812_encode(dst, grb, pixels * 3);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (double)time_diff_ns(t0, t1) / WS2812_BENCH_FRAMES;
+}
+
+// Decode the 3-bit symbols back to data bytes; -1 on a malformed symbol
+static int ws2812_decode_check(const uint8_t *spi, const uint8_t *grb, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uint32_t bits = (uint32_t)spi[3 * i] << 16 | spi[3 * i + 1] << 8 | spi[3 * i + 2];
+        uint8_t byte = 0;
+        for (int b = 7; b >= 0; b--) {
+            uint32_t sym = (bits >> (3 * b)) & 7;
+            if (sym != 4 && sym != 6)
+                return -1;
+            byte = byte << 1 | (sym == 6);
+        }
+        if (byte != grb[i])
+            return -1;
+    }
+    return 0;
+}
+
+// Write frames to a sink back to back; spidev also reads MISO so a
+// MOSI->MISO jumper verifies the stream
+static void ws2812_sink_run(const char *path, const uint8_t *spi, size_t bytes, size_t pixels) {
+    PixelSink *sink = pixel_sink_open(path);
+    if (!sink)
+        return;
+    uint8_t *rx = pixel_sink_is_spi(sink) ? malloc(bytes) : NULL;
+
+    struct timespec t0, t1;
+    int errors = 0, mismatches = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int f = 0; f < WS2812_BENCH_FRAMES; f++) {
+        if (rx)
+            memset(rx, 0, bytes);
+        if (pixel_sink_write(sink, spi, rx, bytes) != 0)
+            errors++;
+        else if (rx && memcmp(rx, spi, bytes) != 0)
+            mismatches++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double frame_ns = (double)time_diff_ns(t0, t1) / WS2812_BENCH_FRAMES;
+
+    printf("  %-6zu %s: %.1f us/frame, %.1f fps measured, %d write errors",
+           pixels, pixel_sink_is_spi(sink) ? "spidev" : "file", frame_ns / 1000.0,
+           frame_ns > 0 ? 1e9 / frame_ns : 0, errors);
+    if (rx)
+        printf(", loopback %s", mismatches ? "MISMATCH" : "ok");
+    printf("\n");
+    if (errors && pixel_sink_is_spi(sink))
+        printf("         (frames over 4096 bytes need spidev.bufsiz raised)\n");
+
+    free(rx);
+    pixel_sink_close(sink);
+}
+
+static int bench_ws2812(const char *arg) {
+    const size_t sizes[] = { 300, 1000, 3000 };
+    size_t max_pixels = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+
+    uint8_t *grb = malloc(max_pixels * 3);
+    uint8_t *spi_simd = calloc(1, ws2812_frame_bytes(max_pixels));
+    uint8_t *spi_scalar = calloc(1, ws2812_frame_bytes(max_pixels));
+    if (!grb || !spi_simd || !spi_scalar) {
+        free(grb); free(spi_simd); free(spi_scalar);
+        return 1;
+    }
+    srand(1);
+    for (size_t i = 0; i < max_pixels * 3; i++)
+        grb[i] = (uint8_t)rand();
+
+    printf("WS2812 over SPI at %.1f MHz (3 bits per bit), %s encoder vs scalar, %d frames\n",
+           WS2812_SPI_HZ / 1e6, ws2812_backend(), WS2812_BENCH_FRAMES);
+    printf("%-7s %8s %10s %10s %8s %10s %9s %6s\n", "pixels", "bytes", "scalar",
+           "simd", "speedup", "wire", "max fps", "match");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t pixels = sizes[s], bytes = ws2812_frame_bytes(pixels);
+
+        ws2812_force_scalar(1);
+        double t_scalar = ws2812_encode_time(spi_scalar, grb, pixels);
+        ws2812_force_scalar(0);
+        double t_simd = ws2812_encode_time(spi_simd, grb, pixels);
+
+        int match = memcmp(spi_simd, spi_scalar, bytes) == 0 &&
+                    ws2812_decode_check(spi_simd, grb, pixels * 3) == 0;
+        // The transfer dominates: the encoder of the next frame only adds
+        // to it when both run on the same thread, as in the pixel thread
+        double wire_ns = bytes * 8 * 1e9 / WS2812_SPI_HZ;
+        printf("%-7zu %8zu %7.1f us %7.1f us %7.1fx %7.0f us %9.1f %6s\n", pixels, bytes,
+               t_scalar / 1000.0, t_simd / 1000.0, t_simd > 0 ? t_scalar / t_simd : 0,
+               wire_ns / 1000.0, 1e9 / (t_simd + wire_ns), match ? "yes" : "NO");
+    }
+
+    if (arg) {
+        printf("Sink %s:\n", arg);
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            ws2812_encode(spi_simd, grb, sizes[s] * 3);
+            ws2812_sink_run(arg, spi_simd, ws2812_frame_bytes(sizes[s]), sizes[s]);
+        }
+    }
+
+    free(grb);
+    free(spi_simd);
+    free(spi_scalar);
+    return 0;
+}
+
+// --------------------------------------------------------------
+// output: per-commit cost as gpio_write_ns measures it, per backend
+// --------------------------------------------------------------
+#define OUTPUT_BENCH_COMMITS 100000
+
+// The LED thread's stores before the backend layer, kept for comparison
+static void output_direct_commit(const uint32_t set[2], const uint32_t clr[2]) {
+    volatile uint32_t *GPSET0 = gpio + GPSET0_REG;
+    volatile uint32_t *GPCLR0 = gpio + GPCLR0_REG;
+    *GPSET0 = set[0];
+    __sync_synchronize();
+    *GPCLR0 = clr[0];
+}
+
+static void output_bench_run(const char *label, int direct, long *ns, size_t commits) {
+    uint64_t mask = gpio_pins_mask(led_lines, led_count);
+    for (size_t i = 0; i < commits; i++) {
+        uint64_t on = mask & (i * 0x9E3779B97F4A7C15ull);
+        const uint32_t set[2] = { (uint32_t)on, (uint32_t)(on >> 32) };
+        const uint32_t clr[2] = { (uint32_t)(mask & ~on), (uint32_t)((mask & ~on) >> 32) };
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (direct)
+            output_direct_commit(set, clr);
+        else
+            output_commit(set, clr);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns[i] = time_diff_ns(t0, t1);
+    }
+    print_latency(label, ns, commits);   // Sorts ns
+    printf("%-12s jitter (p99 - min) %.2f us, (max - min) %.2f us\n", "",
+           (ns[commits * 99 / 100] - ns[0]) / 1000.0, (ns[commits - 1] - ns[0]) / 1000.0);
+}
+
+static int bench_output(const char *arg) {
+    size_t commits = OUTPUT_BENCH_COMMITS;
+    long *ns = malloc(commits * sizeof(long));
+    if (!ns)
+        return 1;
+    const OutputBackend *selected = output;
+    bench_make_rt();
+    printf("%zu commits, %d channels, timed like gpio_write_ns (clock_gettime around the commit)\n",
+           commits, led_count);
+
+    // These three write the simulated register page, so only the commit
+    // path differs
+    output_select("sim");
+    if (output_init(led_lines, led_count) != 0) {
+        free(ns);
+        output = selected;
+        return 1;
+    }
+    output_bench_run("direct", 1, ns, commits);
+    output = &output_mmap;
+    output_bench_run("mmap path", 0, ns, commits);
+    output = &output_sim;
+    output_bench_run("sim", 0, ns, commits);
+    uint64_t total;
+    output_sim_log(NULL, &total);
+    printf("sim logged %llu commits, GPLEV0=0x%08x\n", (unsigned long long)total, gpio[GPLEV0_REG]);
+    output_cleanup();
+
+    // Real hardware: "mmap" (registers) or "cdev[:/dev/gpiochipN]"
+    // (a gpio-sim chip works too), to choose a backend per deployment
+    int rc = 0;
+    if (arg) {
+        if (output_select(arg) != 0 || output_init(led_lines, led_count) != 0) {
+            fprintf(stderr, "Cannot open output %s\n", arg);
+            rc = 1;
+        } else {
+            output_bench_run(arg, 0, ns, commits);
+            output_all_off();
+            output_cleanup();
+        }
+    }
+    output = selected;
+    free(ns);
+    return rc;
+}
+
+// --------------------------------------------------------------
+// Registry
+// --------------------------------------------------------------
+typedef struct {
+    const char *name;
+    int (*fn)(const char *arg);
+    const char *help;
+} Benchmark;
+
+// --------------------------------------------------------------
+// Audio clock: PLL tracking on a simulated sound card
+// --------------------------------------------------------------
+#define AVC_BENCH_RATE      48000
+#define AVC_BENCH_WAKE_MS   30      // Timer-mode audio thread
+#define AVC_BENCH_LATENCY   0.08    // Output latency: song 0 is heard 80 ms in
+#define AVC_BENCH_SETTLE    (2 * AVCLOCK_TAU_SEC)
+
+typedef struct {
+    const char *name;
+    double ppm;             // Card crystal vs CLOCK_MONOTONIC
+    unsigned int granule;   // Position granularity in frames (1 = hw timestamp)
+    double gap_ms;          // Underrun gap half way through (0 = none)
+} AvcCase;
+
+static struct timespec avc_ts(double t) {
+    return (struct timespec){ (time_t)t, (long)((t - floor(t)) * 1e9) };
+}
+
+static void avc_bench_run(const AvcCase *c, double seconds) {
+    avclock_song_start(AVC_BENCH_RATE);
+    srand(1);
+
+    double rate = 1.0 + c->ppm / 1e6;
+    double gap = 0, max_err = 0, sq_err = 0;
+    size_t checked = 0, wakes = (size_t)(seconds * 1000 / AVC_BENCH_WAKE_MS);
+
+    for (size_t k = 0; k < wakes; k++) {
+        // Audio thread wakes with up to 200 us of jitter
+        double t = 10.0 + k * AVC_BENCH_WAKE_MS / 1000.0 + (rand() % 200) * 1e-6;
+        if (c->gap_ms > 0 && gap == 0 && t > 10.0 + seconds / 2)
+            gap = c->gap_ms / 1000.0;
+        double heard = (t - 10.0 - AVC_BENCH_LATENCY - gap) * rate;
+        int64_t frames = (int64_t)floor(heard * AVC_BENCH_RATE / c->granule) * c->granule;
+        avclock_observe(avc_ts(t), frames);
+
+        // Deadline the LED thread would use for a cue 10 ms ahead
+        if (t - 10.0 < AVC_BENCH_SETTLE || heard < 0)
+            continue;
+        double cue = heard + 0.01;
+        struct timespec d = avclock_deadline((uint64_t)(cue * 1e6));
+        double want = 10.0 + AVC_BENCH_LATENCY + gap + cue / rate;
+        double err = fabs(d.tv_sec + d.tv_nsec / 1e9 - want);
+        if (err > max_err)
+            max_err = err;
+        sq_err += err * err;
+        checked++;
+    }
+
+    AvClockStats s;
+    avclock_get_stats(&s, 1);
+    printf("%-26s %+8.1f %+8.2f %10.1f %10.1f %7u %12.1f\n", c->name, c->ppm, s.drift_ppm,
+           checked ? sqrt(sq_err / checked) * 1e6 : 0, max_err * 1e6, s.relocks,
+           fabs(c->ppm) * seconds);
+}
+
+static int bench_avclock(const char *arg) {
+    double seconds = arg ? atof(arg) : 300.0;
+    if (seconds <= AVC_BENCH_SETTLE) seconds = 300.0;
+
+    const AvcCase cases[] = {
+        { "exact crystal, hw tstamp", 0, 1, 0 },
+        { "+80 ppm, hw tstamp", 80, 1, 0 },
+        { "-250 ppm, hw tstamp", -250, 1, 0 },
+        { "+80 ppm, 64-frame bursts", 80, 64, 0 },
+        { "+80 ppm, 480-frame bursts", 80, 480, 0 },
+        { "+80 ppm, 40 ms underrun", 80, 1, 40 },
+    };
+
+    printf("%.0f s song, %d Hz, audio thread every %d ms, deadlines checked after %.0f s\n",
+           seconds, AVC_BENCH_RATE, AVC_BENCH_WAKE_MS, AVC_BENCH_SETTLE);
+    printf("%-26s %8s %8s %10s %10s %7s %12s\n", "case", "ppm", "measured",
+           "rms us", "max us", "relocks", "free-run us");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+        avc_bench_run(&cases[i], seconds);
+    printf("(free-run: LED offset a system-clock timeline would reach by the end)\n");
+    avclock_song_start(0);
+    return 0;
+}
+
+// --------------------------------------------------------------
+// Multi-node sync: followers with simulated clocks over loopback
+// --------------------------------------------------------------
+#define NS_BENCH_POLL_MS    50
+#define NS_BENCH_NODES      4
+#define NS_BENCH_CONGESTED  5       // One exchange in this many queued...
+#define NS_BENCH_QUEUE_US   3000    // ...by up to this long, one way
+
+typedef struct {
+    const char *name;
+    double ppm;             // Crystal vs the leader
+    double offset_s;        // Clock offset (different boot times)
+    int congested;          // Outbound leg queued now and then
+    // Run state
+    int fd;
+    unsigned int calls;
+    int64_t true_ns;        // Leader clock at the last stamp
+    NetSyncEstimator est;
+    double raw_max, err_sq, err_max;
+    size_t checked;
+} NsNode;
+
+// Local clock of a node. A congested node's request sometimes sits in a
+// queue after it was stamped: its t1 reads as that much earlier, which
+// skews the exchange by half the wait.
+static int64_t ns_node_clock(void *ctx, int64_t mono) {
+    NsNode *n = ctx;
+    n->true_ns = mono;
+    if (n->congested && n->calls++ % 2 == 0 && rand() % NS_BENCH_CONGESTED == 0)
+        mono -= (int64_t)(rand() % NS_BENCH_QUEUE_US) * 1000;
+    return mono + (int64_t)(mono * n->ppm / 1e6) + (int64_t)(n->offset_s * 1e9);
+}
+
+static int64_t ns_node_local(const NsNode *n, int64_t true_ns) {
+    return true_ns + (int64_t)(true_ns * n->ppm / 1e6) + (int64_t)(n->offset_s * 1e9);
+}
+
+static int bench_netsync(const char *arg) {
+    double seconds = arg ? atof(arg) : 20.0;
+    if (seconds < 5) seconds = 20.0;
+
+    NsNode nodes[NS_BENCH_NODES] = {
+        { .name = "same crystal" },
+        { .name = "+40 ppm, booted 2.5 s later", .ppm = 40, .offset_s = -2.5 },
+        { .name = "-65 ppm, booted 7 s earlier", .ppm = -65, .offset_s = 7.0 },
+        { .name = "+120 ppm, congested link", .ppm = 120, .offset_s = 0.013, .congested = 1 },
+    };
+
+    if (netsync_lead(0) != 0)
+        return 1;
+    struct sockaddr_in leader = {0};
+    leader.sin_family = AF_INET;
+    leader.sin_port = htons((uint16_t)netsync_port());
+    leader.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int i = 0; i < NS_BENCH_NODES; i++) {
+        nodes[i].fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (nodes[i].fd < 0 ||
+            connect(nodes[i].fd, (struct sockaddr *)&leader, sizeof(leader)) != 0) {
+            perror("socket");
+            netsync_stop();
+            return 1;
+        }
+        netsync_estimator_reset(&nodes[i].est);
+    }
+    srand(1);
+
+    // Inter-node skew: every node's reading of the leader clock at one
+    // instant, spread between the earliest and the latest
+    double spread_sq = 0, spread_max = 0;
+    size_t spreads = 0, rounds = (size_t)(seconds * 1000 / NS_BENCH_POLL_MS);
+    for (size_t k = 0; k < rounds; k++) {
+        for (int i = 0; i < NS_BENCH_NODES; i++) {
+            NsNode *n = &nodes[i];
+            NetSyncExchange x;
+            if (netsync_exchange(n->fd, ns_node_clock, n, &x) != 0)
+                continue;
+
+            // A single exchange's own offset, and the fit's prediction for
+            // the reply's arrival before the exchange is added
+            double raw = fabs(((x.t2 - x.t1) + (x.t3 - x.t4)) / 2.0 - (n->true_ns - x.t4));
+            if (k > 0 && raw > n->raw_max)
+                n->raw_max = raw;
+            if (netsync_estimator_locked(&n->est)) {
+                double err = fabs((double)(netsync_estimator_leader_ns(&n->est, x.t4) - n->true_ns));
+                n->err_sq += err * err;
+                if (err > n->err_max)
+                    n->err_max = err;
+                n->checked++;
+            }
+            netsync_estimator_add(&n->est, &x);
+        }
+
+        int all_locked = 1;
+        for (int i = 0; i < NS_BENCH_NODES; i++)
+            all_locked &= netsync_estimator_locked(&nodes[i].est);
+        if (all_locked) {
+            struct timespec t;
+            clock_gettime(CLOCK_MONOTONIC, &t);
+            int64_t now = (int64_t)t.tv_sec * 1000000000LL + t.tv_nsec;
+            double lo = INFINITY, hi = -INFINITY;
+            for (int i = 0; i < NS_BENCH_NODES; i++) {
+                double e = (double)(netsync_estimator_leader_ns(&nodes[i].est,
+                                    ns_node_local(&nodes[i], now)) - now);
+                if (e < lo) lo = e;
+                if (e > hi) hi = e;
+            }
+            spread_sq += (hi - lo) * (hi - lo);
+            if (hi - lo > spread_max)
+                spread_max = hi - lo;
+            spreads++;
+        }
+
+        struct timespec poll_wait = { 0, NS_BENCH_POLL_MS * 1000000L };
+        nanosleep(&poll_wait, NULL);
+    }
+
+    printf("%.0f s, %d followers over loopback, one exchange each every %d ms, fit over %d\n",
+           seconds, NS_BENCH_NODES, NS_BENCH_POLL_MS, NETSYNC_WINDOW);
+    printf("%-30s %8s %9s %8s %8s %9s %9s %10s\n", "node", "ppm", "measured", "rtt us",
+           "rejected", "rms us", "max us", "1-shot us");
+    for (int i = 0; i < NS_BENCH_NODES; i++) {
+        NsNode *n = &nodes[i];
+        // Leader ticks per local tick - 1 is -ppm / (1 + ppm)
+        printf("%-30s %+8.1f %+9.2f %8.1f %3llu/%-4llu %9.1f %9.1f %10.1f\n", n->name, n->ppm,
+               -n->est.skew * 1e6, n->est.min_delay_ns / 1000.0,
+               (unsigned long long)n->est.rejected, (unsigned long long)n->est.exchanges,
+               n->checked ? sqrt(n->err_sq / n->checked) / 1000.0 : 0, n->err_max / 1000.0,
+               n->raw_max / 1000.0);
+        close(n->fd);
+    }
+    printf("Inter-node skew: rms=%.1f us, max=%.1f us over %zu instants\n",
+           spreads ? sqrt(spread_sq / spreads) / 1000.0 : 0, spread_max / 1000.0, spreads);
+    printf("(1-shot: worst offset a single exchange would have given, no filter or fit)\n");
+    netsync_stop();
+    return 0;
+}
+
+// --------------------------------------------------------------
+// seek: starting mid-song, audio and LED timeline
+// --------------------------------------------------------------
+#define SEEK_BENCH_CUES    1000000  // Synthetic show: a change every 10 ms (2.8 h)
+#define SEEK_BENCH_LOOKUPS 1000
+
+// Open, seek to a fraction of the file, time to the first frames there
+static int seek_run(const char *path, double fraction) {
+    AudioStream *stream = audio_open(path);
+    if (!stream) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+    size_t frame = (size_t)(stream->total_frames * fraction);
+
+    struct timespec t0, t1, t2;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int rc = audio_seek(stream, frame);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (rc == 0)
+        rc = audio_start(stream);
+
+    size_t period = stream->sample_rate / 100;
+    int16_t buf[2 * 4800];
+    if (period > 4800) period = 4800;
+    while (rc == 0 && audio_read(stream, buf, period) == 0)
+        ;
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    if (rc == 0)
+        printf("%5.1f%%  %-16s %10.1f s %10.2f ms %12.2f ms\n", fraction * 100,
+               audio_format_name(stream), (double)frame / stream->sample_rate,
+               time_diff_ns(t0, t1) / 1e6, time_diff_ns(t0, t2) / 1e6);
+    else
+        fprintf(stderr, "seek to %.1f%% failed\n", fraction * 100);
+    audio_close(stream);
+    return rc != 0;
+}
+
+static int bench_seek(const char *arg) {
+    if (arg) {
+        // Near the end first: an MP3's first seek scans the file once, the
+        // next ones (and the first again, last) use the cached frame index
+        const double at[] = { 0.99, 0.5, 0.1, 0.9, 0.99 };
+        printf("%s\n%6s  %-16s %12s %13s %15s\n", arg, "at", "format", "position",
+               "seek", "first frames");
+        for (size_t i = 0; i < sizeof(at) / sizeof(at[0]); i++)
+            if (seek_run(arg, at[i]) != 0)
+                return 1;
+    }
+
+    ShowCue *cues = calloc(SEEK_BENCH_CUES, sizeof(ShowCue));
+    if (!cues) {
+        fprintf(stderr, "seek bench: out of memory\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < SEEK_BENCH_CUES; i++)
+        cues[i].abs_time_us = (uint64_t)i * 10000;
+    Show show = { .cues = cues, .count = SEEK_BENCH_CUES,
+                  .total_us = (uint64_t)SEEK_BENCH_CUES * 10000 };
+
+    // Same targets for both: binary search vs walking from cue 0
+    uint32_t x = 12345;
+    uint64_t sum = 0;
+    struct timespec t0, t1, t2;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < SEEK_BENCH_LOOKUPS; i++) {
+        x = x * 1664525u + 1013904223u;
+        sum += show_find(&show, x % show.total_us);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    x = 12345;
+    for (int i = 0; i < SEEK_BENCH_LOOKUPS; i++) {
+        x = x * 1664525u + 1013904223u;
+        uint64_t us = x % show.total_us;
+        uint32_t c = 0;
+        while (c < show.count && cues[c].abs_time_us < us)
+            c++;
+        sum -= c;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    printf("LED timeline, %d changes: binary search %.2f us, linear walk %.1f us per lookup%s\n",
+           SEEK_BENCH_CUES, time_diff_ns(t0, t1) / 1e3 / SEEK_BENCH_LOOKUPS,
+           time_diff_ns(t1, t2) / 1e3 / SEEK_BENCH_LOOKUPS, sum ? " (MISMATCH)" : "");
+    free(cues);
+    return sum != 0;
+}
+
+static const Benchmark benchmarks[] = {
+    { "ring", bench_ring, "audio_read() latency: lock-free vs mutex ring" },
+    { "wavstream", bench_wavstream, "WAV startup time and peak RSS: whole-file mlock vs window (arg: file.wav)" },
+    { "predecode", bench_predecode, "parallel MP3 decode throughput, 1..N workers (arg: file.mp3)" },
+    { "resample", bench_resample, "resampler CPU per second of audio and SNR, fast vs high (arg: seconds)" },
+    { "dsp", bench_dsp, "gain/fade/limiter stage cost per 10ms period, SIMD vs scalar (arg: seconds)" },
+    { "convert", bench_convert, "sample-format conversion kernels, SIMD vs scalar (arg: seconds)" },
+    { "output", bench_output, "LED commit cost and jitter per output backend (arg: mmap or cdev[:chip] on hardware)" },
+    { "avclock", bench_avclock, "audio clock PLL: deadline error vs simulated card drift and granularity (arg: seconds)" },
+    { "netsync", bench_netsync, "multi-node clock sync: offset/skew error of simulated followers over loopback (arg: seconds)" },
+    { "ws2812", bench_ws2812, "WS2812 SPI encode time and frame rate for 300/1000/3000 pixels (arg: spidev or file)" },
+    { "seek", bench_seek, "start-from-offset cost: audio seek across the file, LED cue search (arg: file.mp3 or .wav)" },
+};
+
+void list_benchmarks(void) {
+    printf("Available benchmarks:\n");
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+        printf("  %-12s %s\n", benchmarks[i].name, benchmarks[i].help);
+}
+
+int run_benchmark(const char *name, const char *arg) {
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        if (strcmp(benchmarks[i].name, name) == 0)
+            return benchmarks[i].fn(arg);
+    }
+    fprintf(stderr, "Unknown benchmark: %s\n", name);
+    list_benchmarks();
+    return 1;
+}
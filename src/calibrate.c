@@ -0,0 +1,401 @@
+#include "calibrate.h"
+#include "setup_alsa.h"
+#include "avclock.h"
+#include "player.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#define CAL_CHANNELS     2
+#define CAL_PERIOD       (CAL_RATE / 100)                   // 10 ms writes
+#define CAL_CLICK_FRAMES (CAL_RATE * CAL_CLICK_MS / 1000)
+#define CAL_TOTAL_FRAMES ((CAL_LEAD_MS + CAL_CLICKS * CAL_INTERVAL_MS + CAL_TAIL_MS) * \
+                          (CAL_RATE / 1000))
+#define CAL_CAPTURE_FRAMES (CAL_TOTAL_FRAMES + CAL_RATE)    // Capture runs a little longer
+#define CAL_CAPTURE_LATENCY_US 100000
+#define CAL_MAX_DEVICES  32
+
+static char cal_path[600];
+
+const char *calibration_path(void) {
+    snprintf(cal_path, sizeof(cal_path), "%s%s", get_music_dir(), CAL_FILE);
+    return cal_path;
+}
+
+const char *calibration_confidence(const CalResult *r) {
+    if (r->detected == r->clicks && r->spread_us < 250 && r->correlation >= 0.6)
+        return "high";
+    if (r->detected * 2 >= r->clicks && r->spread_us < 1000)
+        return "medium";
+    return "low";
+}
+
+// --------------------------------------------------------------
+// Calibration file: one tab-separated line per device
+// --------------------------------------------------------------
+static int parse_line(char *line, CalResult *r) {
+    char *tab = strchr(line, '\t');
+    if (line[0] == '#' || !tab)
+        return -1;
+    *tab = '\0';
+    memset(r, 0, sizeof(*r));
+    snprintf(r->device, sizeof(r->device), "%.*s", (int)sizeof(r->device) - 1, line);
+    return sscanf(tab + 1, "%ld %lf %lf %d %d %lld", &r->offset_us, &r->spread_us,
+                  &r->correlation, &r->detected, &r->clicks, &r->when) == 6 ? 0 : -1;
+}
+
+static size_t load_all(CalResult *all, size_t max) {
+    FILE *f = fopen(calibration_path(), "r");
+    if (!f)
+        return 0;
+    char line[512];
+    size_t n = 0;
+    while (n < max && fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+        if (parse_line(line, &all[n]) == 0)
+            n++;
+    }
+    fclose(f);
+    return n;
+}
+
+int calibration_lookup(const char *device, CalResult *out) {
+    CalResult all[CAL_MAX_DEVICES];
+    size_t n = load_all(all, CAL_MAX_DEVICES);
+    for (size_t i = 0; i < n; i++) {
+        if (strcmp(all[i].device, device) == 0) {
+            *out = all[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int save_result(const CalResult *r) {
+    CalResult all[CAL_MAX_DEVICES];
+    size_t n = load_all(all, CAL_MAX_DEVICES);
+    size_t i;
+    for (i = 0; i < n; i++)
+        if (strcmp(all[i].device, r->device) == 0)
+            break;
+    if (i == CAL_MAX_DEVICES)
+        i--;   // Full: replace the last entry
+    all[i] = *r;
+    if (i == n)
+        n++;
+
+    // Write a temporary file and rename it, so a crash never loses the others
+    char tmp[620];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", calibration_path());
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        perror(tmp);
+        return -1;
+    }
+    fprintf(f, "# device\toffset_us spread_us correlation detected clicks unix_time\n");
+    for (i = 0; i < n; i++)
+        fprintf(f, "%s\t%ld %.1f %.3f %d %d %lld\n", all[i].device, all[i].offset_us,
+                all[i].spread_us, all[i].correlation, all[i].detected, all[i].clicks,
+                all[i].when);
+    if (fclose(f) != 0 || rename(tmp, calibration_path()) != 0) {
+        perror(calibration_path());
+        return -1;
+    }
+    return 0;
+}
+
+// --------------------------------------------------------------
+// Click track
+// --------------------------------------------------------------
+// Linear chirp under a Hann window: broadband, so the correlation peak is
+// one sample wide, and 1-6 kHz suits small speakers and microphones alike
+static void make_click(float *click) {
+    const double f0 = 1000.0, f1 = 6000.0, len = CAL_CLICK_FRAMES / (double)CAL_RATE;
+    for (int i = 0; i < CAL_CLICK_FRAMES; i++) {
+        double t = i / (double)CAL_RATE;
+        double phase = 2 * M_PI * (f0 * t + (f1 - f0) * t * t / (2 * len));
+        double w = 0.5 - 0.5 * cos(2 * M_PI * i / (CAL_CLICK_FRAMES - 1));
+        click[i] = (float)(w * sin(phase));
+    }
+}
+
+static uint64_t click_frame(int k) {
+    return (uint64_t)(CAL_LEAD_MS + k * CAL_INTERVAL_MS) * (CAL_RATE / 1000);
+}
+
+// Track frames [from, from + frames) into an interleaved stereo buffer
+static void render_track(int16_t *out, uint64_t from, size_t frames, const float *click) {
+    memset(out, 0, frames * CAL_CHANNELS * sizeof(int16_t));
+    for (int k = 0; k < CAL_CLICKS; k++) {
+        uint64_t c = click_frame(k);
+        for (size_t i = 0; i < frames; i++) {
+            uint64_t f = from + i;
+            if (f >= c && f < c + CAL_CLICK_FRAMES) {
+                int16_t v = (int16_t)lrintf(click[f - c] * 16384.0f);   // -6 dBFS
+                out[2 * i] = out[2 * i + 1] = v;
+            }
+        }
+    }
+}
+
+// --------------------------------------------------------------
+// Capture timeline: least-squares frame -> CLOCK_MONOTONIC
+// --------------------------------------------------------------
+typedef struct {
+    double n, x, y, xx, xy;
+    int64_t t_first_ns;
+} CapFit;
+
+static void capfit_add(CapFit *fit, struct timespec when, int64_t pos) {
+    int64_t t = (int64_t)when.tv_sec * 1000000000LL + when.tv_nsec;
+    if (fit->n == 0)
+        fit->t_first_ns = t;
+    double x = (double)pos, y = (t - fit->t_first_ns) / 1e9;
+    fit->n++;
+    fit->x += x;
+    fit->y += y;
+    fit->xx += x * x;
+    fit->xy += x * y;
+}
+
+static int capfit_solve(const CapFit *fit, double *a, double *b) {
+    double den = fit->n * fit->xx - fit->x * fit->x;
+    if (fit->n < 2 || den <= 0)
+        return -1;
+    *b = (fit->n * fit->xy - fit->x * fit->y) / den;
+    *a = (fit->y - *b * fit->x) / fit->n;
+    return 0;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// --------------------------------------------------------------
+// Measurement
+// --------------------------------------------------------------
+static snd_pcm_t *open_capture(const char *dev, snd_pcm_uframes_t *buffer_frames) {
+    snd_pcm_t *cap;
+    int err = snd_pcm_open(&cap, dev, SND_PCM_STREAM_CAPTURE, SND_PCM_NONBLOCK);
+    if (err < 0) {
+        fprintf(stderr, "Cannot open capture device %s: %s\n", dev, snd_strerror(err));
+        return NULL;
+    }
+    err = snd_pcm_set_params(cap, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED,
+                             1, CAL_RATE, 1, CAL_CAPTURE_LATENCY_US);
+    if (err < 0) {
+        fprintf(stderr, "Cannot set up capture (mono, %d Hz): %s\n", CAL_RATE, snd_strerror(err));
+        snd_pcm_close(cap);
+        return NULL;
+    }
+
+    snd_pcm_uframes_t period;
+    snd_pcm_get_params(cap, buffer_frames, &period);
+    snd_pcm_sw_params_t *sw_params;
+    if (snd_pcm_sw_params_malloc(&sw_params) == 0) {
+        snd_pcm_sw_params_current(cap, sw_params);
+        alsa_enable_tstamps(cap, sw_params);
+        snd_pcm_sw_params(cap, sw_params);
+        snd_pcm_sw_params_free(sw_params);
+    }
+    return cap;
+}
+
+// Read what the capture has; returns -1 on overrun (timeline broken)
+static int drain_capture(snd_pcm_t *cap, int16_t *buf, uint64_t *read) {
+    while (*read < CAL_CAPTURE_FRAMES) {
+        snd_pcm_uframes_t room = CAL_CAPTURE_FRAMES - *read;
+        snd_pcm_sframes_t r = snd_pcm_readi(cap, buf + *read, room < 1024 ? room : 1024);
+        if (r == -EAGAIN || r == 0)
+            return 0;
+        if (r < 0)
+            return -1;
+        *read += r;
+    }
+    return 0;
+}
+
+// Best match of the click in cap[from, to): normalized correlation, and
+// the sub-sample position from a parabola through the peak
+static double find_click(const int16_t *cap, uint64_t from, uint64_t to,
+                         const float *click, double click_energy, double *where) {
+    double best = 0, best_ncc = 0;
+    uint64_t best_j = from;
+    double prev = 0, cur = 0, next = 0;
+
+    for (uint64_t j = from; j < to; j++) {
+        double dot = 0, energy = 0;
+        for (int i = 0; i < CAL_CLICK_FRAMES; i++) {
+            double s = cap[j + i];
+            dot += click[i] * s;
+            energy += s * s;
+        }
+        // Polarity is unknown with a microphone: match on |correlation|
+        if (fabs(dot) > best) {
+            best = fabs(dot);
+            best_j = j;
+            best_ncc = energy > 0 ? best / sqrt(click_energy * energy) : 0;
+        }
+    }
+
+    *where = (double)best_j;
+    if (best_j > from && best_j + 1 < to) {
+        for (int d = -1; d <= 1; d++) {
+            double dot = 0;
+            for (int i = 0; i < CAL_CLICK_FRAMES; i++)
+                dot += click[i] * cap[best_j + d + i];
+            if (d < 0) prev = fabs(dot); else if (d == 0) cur = fabs(dot); else next = fabs(dot);
+        }
+        double den = prev - 2 * cur + next;
+        if (den < 0)
+            *where += 0.5 * (prev - next) / den;
+    }
+    return best_ncc;
+}
+
+int calibrate_run(const char *capture_dev) {
+    if (!capture_dev)
+        capture_dev = CAL_CAPTURE_DEFAULT;
+
+    float click[CAL_CLICK_FRAMES];
+    make_click(click);
+    double click_energy = 0;
+    for (int i = 0; i < CAL_CLICK_FRAMES; i++)
+        click_energy += (double)click[i] * click[i];
+
+    int16_t *out = malloc(CAL_PERIOD * CAL_CHANNELS * sizeof(int16_t));
+    int16_t *cap_buf = calloc(CAL_CAPTURE_FRAMES, sizeof(int16_t));
+    if (!out || !cap_buf) {
+        free(out);
+        free(cap_buf);
+        return -1;
+    }
+
+    snd_pcm_uframes_t cap_buffer = 0;
+    snd_pcm_t *cap = open_capture(capture_dev, &cap_buffer);
+    if (!cap) {
+        free(out);
+        free(cap_buf);
+        return -1;
+    }
+
+    setup_alsa(CAL_RATE, CAL_CHANNELS);
+    printf("Calibrating %s: %d clicks every %d ms, capture from %s\n",
+           alsa_device_name(), CAL_CLICKS, CAL_INTERVAL_MS, capture_dev);
+
+    // The playback side is timed exactly like a song (audio clock)
+    avclock_song_start(CAL_RATE);
+    CapFit fit = {0};
+    uint64_t written = 0, cap_read = 0;
+    int xruns = 0, overrun = 0;
+
+    snd_pcm_start(cap);
+    while (written < CAL_TOTAL_FRAMES && !stop_requested) {
+        size_t frames = CAL_TOTAL_FRAMES - written < CAL_PERIOD ?
+                        CAL_TOTAL_FRAMES - written : CAL_PERIOD;
+        render_track(out, written, frames, click);
+        snd_pcm_sframes_t w = alsa_mmap_active ? snd_pcm_mmap_writei(pcm, out, frames)
+                                               : snd_pcm_writei(pcm, out, frames);
+        if (w < 0) {
+            // The audio clock relocks across the gap; the click is resent
+            xruns++;
+            snd_pcm_prepare(pcm);
+            continue;
+        }
+        written += w;
+
+        struct timespec when;
+        int64_t pos;
+        if (alsa_stream_position(pcm, alsa_buffer_frames, written, &when, &pos) == 0)
+            avclock_observe(when, pos);
+
+        if (drain_capture(cap, cap_buf, &cap_read) != 0) {
+            overrun = 1;
+            break;
+        }
+        if (alsa_stream_position(cap, cap_buffer, cap_read, &when, &pos) == 0)
+            capfit_add(&fit, when, pos);
+    }
+    alsa_close();   // Drains: the tail keeps the capture going meanwhile
+    drain_capture(cap, cap_buf, &cap_read);
+    snd_pcm_close(cap);
+    free(out);
+
+    double a, b;
+    if (stop_requested || overrun || !avclock_locked() || capfit_solve(&fit, &a, &b) != 0) {
+        fprintf(stderr, "Calibration failed: %s\n", stop_requested ? "interrupted" :
+                overrun ? "capture overrun" : "no stream timing");
+        free(cap_buf);
+        avclock_song_start(0);
+        return -1;
+    }
+
+    // Each click: when the audio clock said it left the pointer, and when
+    // the capture heard it
+    CalResult r = {0};
+    snprintf(r.device, sizeof(r.device), "%s", alsa_device_name());
+    r.clicks = CAL_CLICKS;
+    double latency_us[CAL_CLICKS], ncc_sum = 0;
+
+    printf("%5s %12s %12s %8s\n", "click", "sent s", "latency ms", "corr");
+    for (int k = 0; k < CAL_CLICKS; k++) {
+        struct timespec sent = avclock_deadline(click_frame(k) * 1000000ULL / CAL_RATE);
+        double sent_s = (sent.tv_sec * 1000000000LL + sent.tv_nsec - fit.t_first_ns) / 1e9;
+        double c0 = (sent_s - a) / b;   // Capture frame at send time
+
+        int64_t from = (int64_t)c0 - CAL_RATE / 500;   // 2 ms early
+        int64_t to = (int64_t)c0 + (int64_t)CAL_RATE * CAL_MAX_LATENCY_MS / 1000;
+        if (from < 0)
+            from = 0;
+        if (to > (int64_t)cap_read - CAL_CLICK_FRAMES)
+            to = (int64_t)cap_read - CAL_CLICK_FRAMES;
+        if (to <= from) {
+            printf("%5d %12.3f %12s %8s\n", k, sent_s, "-", "-");
+            continue;
+        }
+
+        double where;
+        double ncc = find_click(cap_buf, from, to, click, click_energy, &where);
+        double heard_s = a + b * where;
+        double lat_us = (heard_s - sent_s) * 1e6;
+        int ok = ncc >= CAL_MIN_CORRELATION;
+        printf("%5d %12.3f %12.3f %8.3f%s\n", k, sent_s, lat_us / 1000.0, ncc, ok ? "" : "  (not found)");
+        if (ok) {
+            latency_us[r.detected++] = lat_us;
+            ncc_sum += ncc;
+        }
+    }
+    free(cap_buf);
+    avclock_song_start(0);
+
+    if (r.detected * 2 < r.clicks) {
+        fprintf(stderr, "Calibration failed: %d of %d clicks found (check the capture "
+                "device and levels)\n", r.detected, r.clicks);
+        return -1;
+    }
+
+    qsort(latency_us, r.detected, sizeof(double), cmp_double);
+    double median = latency_us[r.detected / 2];
+    double dev[CAL_CLICKS];
+    for (int i = 0; i < r.detected; i++)
+        dev[i] = fabs(latency_us[i] - median);
+    qsort(dev, r.detected, sizeof(double), cmp_double);
+
+    r.offset_us = lround(median);
+    r.spread_us = 1.4826 * dev[r.detected / 2];
+    r.correlation = ncc_sum / r.detected;
+    r.when = (long long)time(NULL);
+
+    printf("Offset: %+.3f ms, spread %.3f ms, %d/%d clicks, correlation %.2f (%s confidence)%s\n",
+           r.offset_us / 1000.0, r.spread_us / 1000.0, r.detected, r.clicks, r.correlation,
+           calibration_confidence(&r), xruns ? ", playback underruns" : "");
+    if (save_result(&r) != 0)
+        return -1;
+    printf("Saved for '%s' in %s\n", r.device, calibration_path());
+    return 0;
+}
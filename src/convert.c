@@ -0,0 +1,495 @@
+#include "convert.h"
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CONVERT_NEON 1
+#elif defined(__SSE2__)
+#include <immintrin.h>
+#define CONVERT_SSE2 1
+#if defined(__SSSE3__)
+#define CONVERT_SSSE3 1
+#endif
+#if defined(__AVX2__)
+#define CONVERT_AVX2 1
+#endif
+#endif
+
+// All kernels work on n samples (frames * channels) and tolerate any
+// alignment; vector loops stop early and the scalar tail finishes up.
+
+typedef void (*ConvertKernel)(void *dst, const void *src, size_t n);
+
+static int force_scalar = 0;
+
+size_t sample_format_bytes(SampleFormat fmt) {
+    switch (fmt) {
+    case SAMPLE_S16:     return 2;
+    case SAMPLE_S24_3LE: return 3;
+    case SAMPLE_S32:     return 4;
+    case SAMPLE_FLOAT:   return 4;
+    default:             return 0;
+    }
+}
+
+const char *sample_format_name(SampleFormat fmt) {
+    switch (fmt) {
+    case SAMPLE_S16:     return "S16_LE";
+    case SAMPLE_S24_3LE: return "S24_3LE";
+    case SAMPLE_S32:     return "S32_LE";
+    case SAMPLE_FLOAT:   return "FLOAT_LE";
+    default:             return "unknown";
+    }
+}
+
+const char *convert_backend(void) {
+#if defined(CONVERT_NEON)
+    return "NEON";
+#elif defined(CONVERT_AVX2)
+    return "AVX2";
+#elif defined(CONVERT_SSSE3)
+    return "SSSE3";
+#elif defined(CONVERT_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void convert_force_scalar(int enabled) {
+    force_scalar = enabled;
+}
+
+// ----------------------------------------------------------------------------
+// Scalar kernels (also the tails of the vector ones)
+// ----------------------------------------------------------------------------
+
+static inline int16_t float_to_s16(float x) {
+    float v = x * 32768.0f;
+    if (v > 32767.0f) v = 32767.0f;
+    if (v < -32768.0f) v = -32768.0f;
+    return (int16_t)lrintf(v);
+}
+
+static inline int32_t float_to_s32(float x) {
+    // 2147483520 is the largest float below 2^31
+    float v = x * 2147483648.0f;
+    if (v > 2147483520.0f) v = 2147483520.0f;
+    if (v < -2147483648.0f) v = -2147483648.0f;
+    return (int32_t)lrintf(v);
+}
+
+static void s24_to_s16_scalar(void *dst, const void *src, size_t n) {
+    int16_t *d = dst;
+    const uint8_t *s = src;
+    for (size_t i = 0; i < n; i++)
+        d[i] = (int16_t)(s[3 * i + 1] | (s[3 * i + 2] << 8));
+}
+
+static void s32_to_s16_scalar(void *dst, const void *src, size_t n) {
+    int16_t *d = dst;
+    const int32_t *s = src;
+    for (size_t i = 0; i < n; i++)
+        d[i] = (int16_t)(s[i] >> 16);
+}
+
+static void float_to_s16_scalar(void *dst, const void *src, size_t n) {
+    int16_t *d = dst;
+    const float *s = src;
+    for (size_t i = 0; i < n; i++)
+        d[i] = float_to_s16(s[i]);
+}
+
+static void s16_to_s32_scalar(void *dst, const void *src, size_t n) {
+    int32_t *d = dst;
+    const int16_t *s = src;
+    for (size_t i = 0; i < n; i++)
+        d[i] = (int32_t)((uint32_t)(uint16_t)s[i] << 16);
+}
+
+static void s24_to_s32_scalar(void *dst, const void *src, size_t n) {
+    int32_t *d = dst;
+    const uint8_t *s = src;
+    for (size_t i = 0; i < n; i++)
+        d[i] = (int32_t)(((uint32_t)s[3 * i] << 8) |
+                         ((uint32_t)s[3 * i + 1] << 16) |
+                         ((uint32_t)s[3 * i + 2] << 24));
+}
+
+static void float_to_s32_scalar(void *dst, const void *src, size_t n) {
+    int32_t *d = dst;
+    const float *s = src;
+    for (size_t i = 0; i < n; i++)
+        d[i] = float_to_s32(s[i]);
+}
+
+static void copy16(void *dst, const void *src, size_t n) {
+    memcpy(dst, src, n * 2);
+}
+
+static void copy32(void *dst, const void *src, size_t n) {
+    memcpy(dst, src, n * 4);
+}
+
+// ----------------------------------------------------------------------------
+// NEON kernels
+// ----------------------------------------------------------------------------
+
+#if defined(CONVERT_NEON)
+
+static void s24_to_s16_simd(void *dst, const void *src, size_t n) {
+    int16_t *d = dst;
+    const uint8_t *s = src;
+    size_t i = 0;
+    // vld3 deinterleaves the three bytes of 16 samples into separate
+    // registers; the top two bytes zipped together are the S16 sample
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x3_t b = vld3q_u8(s + 3 * i);
+        uint8x16x2_t z = vzipq_u8(b.val[1], b.val[2]);
+        vst1q_u8((uint8_t *)(d + i), z.val[0]);
+        vst1q_u8((uint8_t *)(d + i + 8), z.val[1]);
+    }
+    s24_to_s16_scalar(d + i, s + 3 * i, n - i);
+}
+
+static void s32_to_s16_simd(void *dst, const void *src, size_t n) {
+    int16_t *d = dst;
+    const int32_t *s = src;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x4_t lo = vshrn_n_s32(vld1q_s32(s + i), 16);
+        int16x4_t hi = vshrn_n_s32(vld1q_s32(s + i + 4), 16);
+        vst1q_s16(d + i, vcombine_s16(lo, hi));
+    }
+    s32_to_s16_scalar(d + i, s + i, n - i);
+}
+
+// Float to int rounded to nearest, ties to even, as lrintf() does in the
+// scalar kernels (vcvtq alone truncates). ARMv7 has no rounding convert:
+// below 2^23, adding then subtracting 2^23 with the value's sign rounds in
+// the add (NEON always rounds to nearest); from 2^23 up floats are whole.
+static inline int32x4_t cvt_nearest_s32(float32x4_t v) {
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(v);
+#else
+    const float32x4_t two23 = vdupq_n_f32(8388608.0f);
+    uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(v), vdupq_n_u32(0x80000000u));
+    uint32x4_t small = vcaltq_f32(v, two23);
+    uint32x4_t magic = vandq_u32(vorrq_u32(vreinterpretq_u32_f32(two23), sign), small);
+    float32x4_t m = vreinterpretq_f32_u32(magic);
+    return vcvtq_s32_f32(vsubq_f32(vaddq_f32(v, m), m));
+#endif
+}
+
+static void float_to_s16_simd(void *dst, const void *src, size_t n) {
+    int16_t *d = dst;
+    const float *s = src;
+    size_t i = 0;
+    // The convert saturates, vqmovn saturates again to 16 bits: no explicit clamp
+    for (; i + 8 <= n; i += 8) {
+        int32x4_t a = cvt_nearest_s32(vmulq_n_f32(vld1q_f32(s + i), 32768.0f));
+        int32x4_t b = cvt_nearest_s32(vmulq_n_f32(vld1q_f32(s + i + 4), 32768.0f));
+        vst1q_s16(d + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+    float_to_s16_scalar(d + i, s + i, n - i);
+}
+
+static void s16_to_s32_simd(void *dst, const void *src, size_t n) {
+    int32_t *d = dst;
+    const int16_t *s = src;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vld1q_s16(s + i);
+        vst1q_s32(d + i, vshll_n_s16(vget_low_s16(v), 16));
+        vst1q_s32(d + i + 4, vshll_n_s16(vget_high_s16(v), 16));
+    }
+    s16_to_s32_scalar(d + i, s + i, n - i);
+}
+
+static void s24_to_s32_simd(void *dst, const void *src, size_t n) {
+    int32_t *d = dst;
+    const uint8_t *s = src;
+    const uint8x16_t zero = vdupq_n_u8(0);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x3_t b = vld3q_u8(s + 3 * i);
+        uint8x16x2_t lo = vzipq_u8(zero, b.val[0]);      // [0, b0]
+        uint8x16x2_t hi = vzipq_u8(b.val[1], b.val[2]);  // [b1, b2]
+        uint16x8x2_t w0 = vzipq_u16(vreinterpretq_u16_u8(lo.val[0]),
+                                    vreinterpretq_u16_u8(hi.val[0]));
+        uint16x8x2_t w1 = vzipq_u16(vreinterpretq_u16_u8(lo.val[1]),
+                                    vreinterpretq_u16_u8(hi.val[1]));
+        vst1q_u16((uint16_t *)(d + i), w0.val[0]);
+        vst1q_u16((uint16_t *)(d + i + 4), w0.val[1]);
+        vst1q_u16((uint16_t *)(d + i + 8), w1.val[0]);
+        vst1q_u16((uint16_t *)(d + i + 12), w1.val[1]);
+    }
+    s24_to_s32_scalar(d + i, s + 3 * i, n - i);
+}
+
+static void float_to_s32_simd(void *dst, const void *src, size_t n) {
+    int32_t *d = dst;
+    const float *s = src;
+    size_t i = 0;
+    // Same top as the scalar kernel (the convert would saturate to INT_MAX)
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t f = vmulq_n_f32(vld1q_f32(s + i), 2147483648.0f);
+        vst1q_s32(d + i, cvt_nearest_s32(vminq_f32(f, vdupq_n_f32(2147483520.0f))));
+    }
+    float_to_s32_scalar(d + i, s + i, n - i);
+}
+
+static void upmix16_simd(int16_t *d, const int16_t *s, size_t frames) {
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        int16x8_t v = vld1q_s16(s + i);
+        int16x8x2_t z = vzipq_s16(v, v);
+        vst1q_s16(d + 2 * i, z.val[0]);
+        vst1q_s16(d + 2 * i + 8, z.val[1]);
+    }
+    for (; i < frames; i++)
+        d[2 * i] = d[2 * i + 1] = s[i];
+}
+
+static void upmix32_simd(int32_t *d, const int32_t *s, size_t frames) {
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        int32x4_t v = vld1q_s32(s + i);
+        int32x4x2_t z = vzipq_s32(v, v);
+        vst1q_s32(d + 2 * i, z.val[0]);
+        vst1q_s32(d + 2 * i + 4, z.val[1]);
+    }
+    for (; i < frames; i++)
+        d[2 * i] = d[2 * i + 1] = s[i];
+}
+
+// ----------------------------------------------------------------------------
+// SSE2 / SSSE3 / AVX2 kernels
+// ----------------------------------------------------------------------------
+
+#elif defined(CONVERT_SSE2)
+
+static void s24_to_s16_simd(void *dst, const void *src, size_t n) {
+#if defined(CONVERT_SSSE3)
+    int16_t *d = dst;
+    const uint8_t *s = src;
+    // Pick bytes 1,2 of each 3-byte sample; 4 samples per 16-byte load.
+    // The second load reads 4 bytes past the 8 samples consumed, hence
+    // the extra margin in the loop bound.
+    const __m128i pick = _mm_setr_epi8(1, 2, 4, 5, 7, 8, 10, 11,
+                                       -1, -1, -1, -1, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 10 <= n; i += 8) {
+        __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + 3 * i)), pick);
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + 3 * i + 12)), pick);
+        _mm_storeu_si128((__m128i *)(d + i), _mm_unpacklo_epi64(a, b));
+    }
+    s24_to_s16_scalar(d + i, s + 3 * i, n - i);
+#else
+    s24_to_s16_scalar(dst, src, n);
+#endif
+}
+
+static void s32_to_s16_simd(void *dst, const void *src, size_t n) {
+    int16_t *d = dst;
+    const int32_t *s = src;
+    size_t i = 0;
+#if defined(CONVERT_AVX2)
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(s + i)), 16);
+        __m256i b = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i *)(s + i + 8)), 16);
+        // packs works per 128-bit lane; put the quadwords back in order
+        __m256i p = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i *)(d + i), p);
+    }
+#endif
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(s + i)), 16);
+        __m128i b = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(s + i + 4)), 16);
+        _mm_storeu_si128((__m128i *)(d + i), _mm_packs_epi32(a, b));
+    }
+    s32_to_s16_scalar(d + i, s + i, n - i);
+}
+
+static void float_to_s16_simd(void *dst, const void *src, size_t n) {
+    int16_t *d = dst;
+    const float *s = src;
+    size_t i = 0;
+    // Clamp first: cvtps turns out-of-range values into INT_MIN
+#if defined(CONVERT_AVX2)
+    const __m256 scale8 = _mm256_set1_ps(32768.0f);
+    const __m256 max8 = _mm256_set1_ps(1.0f), min8 = _mm256_set1_ps(-1.0f);
+    for (; i + 16 <= n; i += 16) {
+        __m256 fa = _mm256_loadu_ps(s + i), fb = _mm256_loadu_ps(s + i + 8);
+        fa = _mm256_mul_ps(_mm256_max_ps(_mm256_min_ps(fa, max8), min8), scale8);
+        fb = _mm256_mul_ps(_mm256_max_ps(_mm256_min_ps(fb, max8), min8), scale8);
+        __m256i p = _mm256_packs_epi32(_mm256_cvtps_epi32(fa), _mm256_cvtps_epi32(fb));
+        _mm256_storeu_si256((__m256i *)(d + i), _mm256_permute4x64_epi64(p, 0xD8));
+    }
+#endif
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    const __m128 max = _mm_set1_ps(1.0f), min = _mm_set1_ps(-1.0f);
+    for (; i + 8 <= n; i += 8) {
+        __m128 fa = _mm_loadu_ps(s + i), fb = _mm_loadu_ps(s + i + 4);
+        fa = _mm_mul_ps(_mm_max_ps(_mm_min_ps(fa, max), min), scale);
+        fb = _mm_mul_ps(_mm_max_ps(_mm_min_ps(fb, max), min), scale);
+        _mm_storeu_si128((__m128i *)(d + i),
+                         _mm_packs_epi32(_mm_cvtps_epi32(fa), _mm_cvtps_epi32(fb)));
+    }
+    float_to_s16_scalar(d + i, s + i, n - i);
+}
+
+static void s16_to_s32_simd(void *dst, const void *src, size_t n) {
+    int32_t *d = dst;
+    const int16_t *s = src;
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    // Interleaving zeros below each sample is exactly << 16
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        _mm_storeu_si128((__m128i *)(d + i), _mm_unpacklo_epi16(zero, v));
+        _mm_storeu_si128((__m128i *)(d + i + 4), _mm_unpackhi_epi16(zero, v));
+    }
+    s16_to_s32_scalar(d + i, s + i, n - i);
+}
+
+static void s24_to_s32_simd(void *dst, const void *src, size_t n) {
+#if defined(CONVERT_SSSE3)
+    int32_t *d = dst;
+    const uint8_t *s = src;
+    const __m128i place = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5,
+                                        -1, 6, 7, 8, -1, 9, 10, 11);
+    size_t i = 0;
+    // 16-byte load, 12 bytes used: keep 4 bytes of margin at the end
+    for (; i + 6 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + 3 * i));
+        _mm_storeu_si128((__m128i *)(d + i), _mm_shuffle_epi8(v, place));
+    }
+    s24_to_s32_scalar(d + i, s + 3 * i, n - i);
+#else
+    s24_to_s32_scalar(dst, src, n);
+#endif
+}
+
+static void float_to_s32_simd(void *dst, const void *src, size_t n) {
+    int32_t *d = dst;
+    const float *s = src;
+    const __m128 scale = _mm_set1_ps(2147483648.0f);
+    const __m128 max = _mm_set1_ps(2147483520.0f), min = _mm_set1_ps(-2147483648.0f);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 f = _mm_mul_ps(_mm_loadu_ps(s + i), scale);
+        f = _mm_max_ps(_mm_min_ps(f, max), min);
+        _mm_storeu_si128((__m128i *)(d + i), _mm_cvtps_epi32(f));
+    }
+    float_to_s32_scalar(d + i, s + i, n - i);
+}
+
+static void upmix16_simd(int16_t *d, const int16_t *s, size_t frames) {
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        _mm_storeu_si128((__m128i *)(d + 2 * i), _mm_unpacklo_epi16(v, v));
+        _mm_storeu_si128((__m128i *)(d + 2 * i + 8), _mm_unpackhi_epi16(v, v));
+    }
+    for (; i < frames; i++)
+        d[2 * i] = d[2 * i + 1] = s[i];
+}
+
+static void upmix32_simd(int32_t *d, const int32_t *s, size_t frames) {
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        _mm_storeu_si128((__m128i *)(d + 2 * i), _mm_unpacklo_epi32(v, v));
+        _mm_storeu_si128((__m128i *)(d + 2 * i + 4), _mm_unpackhi_epi32(v, v));
+    }
+    for (; i < frames; i++)
+        d[2 * i] = d[2 * i + 1] = s[i];
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Dispatch
+// ----------------------------------------------------------------------------
+
+static void upmix16_scalar(int16_t *d, const int16_t *s, size_t frames) {
+    for (size_t i = 0; i < frames; i++)
+        d[2 * i] = d[2 * i + 1] = s[i];
+}
+
+static void upmix32_scalar(int32_t *d, const int32_t *s, size_t frames) {
+    for (size_t i = 0; i < frames; i++)
+        d[2 * i] = d[2 * i + 1] = s[i];
+}
+
+static const ConvertKernel scalar_to_s16[SAMPLE_FORMAT_COUNT] = {
+    [SAMPLE_S16] = copy16,
+    [SAMPLE_S24_3LE] = s24_to_s16_scalar,
+    [SAMPLE_S32] = s32_to_s16_scalar,
+    [SAMPLE_FLOAT] = float_to_s16_scalar,
+};
+
+static const ConvertKernel scalar_to_s32[SAMPLE_FORMAT_COUNT] = {
+    [SAMPLE_S16] = s16_to_s32_scalar,
+    [SAMPLE_S24_3LE] = s24_to_s32_scalar,
+    [SAMPLE_S32] = copy32,
+    [SAMPLE_FLOAT] = float_to_s32_scalar,
+};
+
+#if defined(CONVERT_NEON) || defined(CONVERT_SSE2)
+static const ConvertKernel simd_to_s16[SAMPLE_FORMAT_COUNT] = {
+    [SAMPLE_S16] = copy16,
+    [SAMPLE_S24_3LE] = s24_to_s16_simd,
+    [SAMPLE_S32] = s32_to_s16_simd,
+    [SAMPLE_FLOAT] = float_to_s16_simd,
+};
+
+static const ConvertKernel simd_to_s32[SAMPLE_FORMAT_COUNT] = {
+    [SAMPLE_S16] = s16_to_s32_simd,
+    [SAMPLE_S24_3LE] = s24_to_s32_simd,
+    [SAMPLE_S32] = copy32,
+    [SAMPLE_FLOAT] = float_to_s32_simd,
+};
+#define HAVE_SIMD_KERNELS 1
+#endif
+
+void convert_frames(void *dst, SampleFormat dst_fmt, unsigned dst_channels,
+                    const void *src, SampleFormat src_fmt, unsigned src_channels,
+                    size_t frames) {
+    if (frames == 0 || src_fmt >= SAMPLE_FORMAT_COUNT) return;
+
+    const ConvertKernel *table = dst_fmt == SAMPLE_S32 ? scalar_to_s32 : scalar_to_s16;
+#ifdef HAVE_SIMD_KERNELS
+    if (!force_scalar)
+        table = dst_fmt == SAMPLE_S32 ? simd_to_s32 : simd_to_s16;
+#endif
+    ConvertKernel kernel = table[src_fmt];
+
+    if (dst_channels == src_channels) {
+        kernel(dst, src, frames * src_channels);
+        return;
+    }
+
+    // Mono -> stereo: convert into the upper half of dst, then expand
+    // forwards. Frame i is read from slot frames+i and written to slots
+    // 2i and 2i+1, which never overtakes data not yet read.
+    size_t out_bytes = dst_fmt == SAMPLE_S32 ? 4 : 2;
+    uint8_t *upper = (uint8_t *)dst + frames * out_bytes;
+    kernel(upper, src, frames);
+
+#ifdef HAVE_SIMD_KERNELS
+    if (!force_scalar) {
+        if (dst_fmt == SAMPLE_S32)
+            upmix32_simd(dst, (const int32_t *)upper, frames);
+        else
+            upmix16_simd(dst, (const int16_t *)upper, frames);
+        return;
+    }
+#endif
+    if (dst_fmt == SAMPLE_S32)
+        upmix32_scalar(dst, (const int32_t *)upper, frames);
+    else
+        upmix16_scalar(dst, (const int16_t *)upper, frames);
+}
@@ -0,0 +1,272 @@
+#include "dsp.h"
+#include <math.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DSP_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define DSP_SSE2 1
+#endif
+
+#define GAIN_UNITY   8192      // Q13
+#define ENV_UNITY    32768     // Q15 envelope
+#define GAIN_CHUNK   1024      // Frames per ramp chunk
+
+// Knee: d = |x| - threshold in [0, KNEE], y = threshold + d - d^2 / (2 * KNEE).
+// Slope 1 at the threshold, 0 (and y = 32767) at the end of the knee.
+#define KNEE_SHIFT   15        // log2(2 * DSP_LIMIT_KNEE)
+
+static int16_t gain_q13 = GAIN_UNITY;
+static double gain_db = 0.0;
+static unsigned int fade_in_ms = 0, fade_out_ms = 0;
+static unsigned int stop_fade_ms = DSP_DEFAULT_STOP_FADE_MS;
+static int limiter_enabled = 0;
+static int force_scalar = 0;
+
+// Per-song state, in frames at the device rate
+static uint64_t position;
+static uint64_t total_frames;
+static uint64_t fade_in_frames, fade_out_frames, stop_frames;
+static uint64_t stop_start;
+static int stopping;
+static uint64_t limited_samples;
+
+static int16_t ramp_gains[GAIN_CHUNK * 2];
+
+void dsp_set_gain_db(double db) {
+    if (db > DSP_MAX_GAIN_DB) db = DSP_MAX_GAIN_DB;
+    gain_db = db;
+    gain_q13 = (int16_t)lrint(GAIN_UNITY * pow(10.0, db / 20.0));
+}
+
+void dsp_set_fades(unsigned int in_ms, unsigned int out_ms, unsigned int stop_ms) {
+    fade_in_ms = in_ms;
+    fade_out_ms = out_ms;
+    stop_fade_ms = stop_ms;
+}
+
+void dsp_set_limiter(int enabled) {
+    limiter_enabled = enabled;
+}
+
+double dsp_gain_db(void) {
+    return gain_db;
+}
+
+int dsp_limiter_enabled(void) {
+    return limiter_enabled;
+}
+
+void dsp_force_scalar(int enabled) {
+    force_scalar = enabled;
+}
+
+void dsp_song_start(uint32_t rate, uint64_t frames) {
+    position = 0;
+    total_frames = frames;
+    fade_in_frames = (uint64_t)rate * fade_in_ms / 1000;
+    fade_out_frames = frames ? (uint64_t)rate * fade_out_ms / 1000 : 0;
+    stop_frames = (uint64_t)rate * stop_fade_ms / 1000;
+    stopping = 0;
+    stop_start = 0;
+    limited_samples = 0;
+}
+
+int dsp_stop_fading(void) {
+    if (stop_frames == 0)
+        return 0;
+    if (!stopping) {
+        stopping = 1;
+        stop_start = position;
+    }
+    return position < stop_start + stop_frames;
+}
+
+uint64_t dsp_limited_samples(void) {
+    return limited_samples;
+}
+
+// ----------------------------------------------------------------------------
+// Kernels: buf has n samples; gains is per sample (ramps) or NULL (constant)
+// ----------------------------------------------------------------------------
+
+static inline int32_t limit_sample(int32_t x, uint64_t *count) {
+    int32_t m = x >> 31;
+    int32_t ax = (x ^ m) - m;
+    if (ax <= DSP_LIMIT_THRESHOLD)
+        return x;
+    (*count)++;
+    int32_t d = ax - DSP_LIMIT_THRESHOLD;
+    if (d > DSP_LIMIT_KNEE) d = DSP_LIMIT_KNEE;
+    int32_t y = DSP_LIMIT_THRESHOLD + d - ((d * d) >> KNEE_SHIFT);
+    return (y ^ m) - m;
+}
+
+static void apply_scalar(int16_t *buf, size_t n, const int16_t *gains,
+                         int16_t gain, int limit, uint64_t *count) {
+    for (size_t i = 0; i < n; i++) {
+        int32_t g = gains ? gains[i] : gain;
+        int32_t x = ((int32_t)buf[i] * g + (1 << 12)) >> 13;
+        if (limit)
+            x = limit_sample(x, count);
+        buf[i] = x > 32767 ? 32767 : (x < -32768 ? -32768 : (int16_t)x);
+    }
+}
+
+#if defined(DSP_SSE2)
+
+static inline __m128i min_epi32(__m128i a, __m128i b) {
+    __m128i gt = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+}
+
+static inline __m128i limit4(__m128i x, __m128i *count) {
+    const __m128i thr = _mm_set1_epi32(DSP_LIMIT_THRESHOLD);
+    const __m128i knee = _mm_set1_epi32(DSP_LIMIT_KNEE);
+    __m128i m = _mm_srai_epi32(x, 31);
+    __m128i ax = _mm_sub_epi32(_mm_xor_si128(x, m), m);
+    __m128i over = _mm_cmpgt_epi32(ax, thr);
+    *count = _mm_sub_epi32(*count, over);
+
+    // d = clamp(|x| - thr, 0, knee); fits 16 bits, so madd(d, d) is d*d
+    __m128i d = _mm_and_si128(_mm_sub_epi32(ax, thr), over);
+    d = min_epi32(d, knee);
+    __m128i dd = _mm_srli_epi32(_mm_madd_epi16(d, d), KNEE_SHIFT);
+    __m128i y = _mm_sub_epi32(_mm_add_epi32(min_epi32(ax, thr), d), dd);
+    return _mm_sub_epi32(_mm_xor_si128(y, m), m);
+}
+
+static void apply_simd(int16_t *buf, size_t n, const int16_t *gains,
+                       int16_t gain, int limit, uint64_t *count) {
+    const __m128i gv = _mm_set1_epi16(gain);
+    const __m128i round = _mm_set1_epi32(1 << 12);
+    __m128i cnt = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(buf + i));
+        __m128i g = gains ? _mm_loadu_si128((const __m128i *)(gains + i)) : gv;
+        // Full 32-bit products from the low and high halves
+        __m128i lo = _mm_mullo_epi16(s, g), hi = _mm_mulhi_epi16(s, g);
+        __m128i p0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), 13);
+        __m128i p1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), 13);
+        if (limit) {
+            p0 = limit4(p0, &cnt);
+            p1 = limit4(p1, &cnt);
+        }
+        _mm_storeu_si128((__m128i *)(buf + i), _mm_packs_epi32(p0, p1));
+    }
+
+    int32_t lanes[4];
+    _mm_storeu_si128((__m128i *)lanes, cnt);
+    *count += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    apply_scalar(buf + i, n - i, gains ? gains + i : NULL, gain, limit, count);
+}
+
+#elif defined(DSP_NEON)
+
+static inline int32x4_t limit4(int32x4_t x, uint32x4_t *count) {
+    const int32x4_t thr = vdupq_n_s32(DSP_LIMIT_THRESHOLD);
+    int32x4_t m = vshrq_n_s32(x, 31);
+    int32x4_t ax = vabsq_s32(x);
+    *count = vsubq_u32(*count, vcgtq_s32(ax, thr));
+
+    int32x4_t d = vminq_s32(vmaxq_s32(vsubq_s32(ax, thr), vdupq_n_s32(0)),
+                            vdupq_n_s32(DSP_LIMIT_KNEE));
+    int32x4_t dd = vshrq_n_s32(vmulq_s32(d, d), KNEE_SHIFT);
+    int32x4_t y = vsubq_s32(vaddq_s32(vminq_s32(ax, thr), d), dd);
+    return vsubq_s32(veorq_s32(y, m), m);
+}
+
+static void apply_simd(int16_t *buf, size_t n, const int16_t *gains,
+                       int16_t gain, int limit, uint64_t *count) {
+    const int16x8_t gv = vdupq_n_s16(gain);
+    uint32x4_t cnt = vdupq_n_u32(0);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t s = vld1q_s16(buf + i);
+        int16x8_t g = gains ? vld1q_s16(gains + i) : gv;
+        int32x4_t p0 = vrshrq_n_s32(vmull_s16(vget_low_s16(s), vget_low_s16(g)), 13);
+        int32x4_t p1 = vrshrq_n_s32(vmull_s16(vget_high_s16(s), vget_high_s16(g)), 13);
+        if (limit) {
+            p0 = limit4(p0, &cnt);
+            p1 = limit4(p1, &cnt);
+        }
+        vst1q_s16(buf + i, vcombine_s16(vqmovn_s32(p0), vqmovn_s32(p1)));
+    }
+
+    *count += (uint64_t)vgetq_lane_u32(cnt, 0) + vgetq_lane_u32(cnt, 1) +
+              vgetq_lane_u32(cnt, 2) + vgetq_lane_u32(cnt, 3);
+    apply_scalar(buf + i, n - i, gains ? gains + i : NULL, gain, limit, count);
+}
+
+#else
+
+static void apply_simd(int16_t *buf, size_t n, const int16_t *gains,
+                       int16_t gain, int limit, uint64_t *count) {
+    apply_scalar(buf, n, gains, gain, limit, count);
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Envelope
+// ----------------------------------------------------------------------------
+
+static uint64_t ramp_q15(uint64_t remaining, uint64_t length) {
+    return remaining >= length ? ENV_UNITY : remaining * ENV_UNITY / length;
+}
+
+// Product of song fades and stop fade at frame f, Q15
+static int32_t envelope_q15(uint64_t f) {
+    uint64_t env = ENV_UNITY;
+    if (f < fade_in_frames)
+        env = ramp_q15(f, fade_in_frames);
+    if (fade_out_frames) {
+        uint64_t left = f < total_frames ? total_frames - f : 0;
+        uint64_t e = ramp_q15(left, fade_out_frames);
+        if (e < env) env = e;
+    }
+    if (stopping) {
+        uint64_t end = stop_start + stop_frames;
+        uint64_t e = ramp_q15(f < end ? end - f : 0, stop_frames);
+        if (e < env) env = e;
+    }
+    return (int32_t)env;
+}
+
+// Envelope is unity over [from, from + frames)
+static int envelope_flat(uint64_t from, size_t frames) {
+    if (from < fade_in_frames || stopping)
+        return 0;
+    if (fade_out_frames && from + frames + fade_out_frames > total_frames)
+        return 0;
+    return 1;
+}
+
+void dsp_process(int16_t *buf, size_t frames) {
+    void (*apply)(int16_t *, size_t, const int16_t *, int16_t, int, uint64_t *) =
+        force_scalar ? apply_scalar : apply_simd;
+
+    if (envelope_flat(position, frames)) {
+        if (gain_q13 != GAIN_UNITY || limiter_enabled)
+            apply(buf, frames * 2, NULL, gain_q13, limiter_enabled, &limited_samples);
+        position += frames;
+        return;
+    }
+
+    // Fade in progress: per-frame gains, sample accurate
+    while (frames > 0) {
+        size_t chunk = frames < GAIN_CHUNK ? frames : GAIN_CHUNK;
+        for (size_t i = 0; i < chunk; i++) {
+            int16_t g = (int16_t)((gain_q13 * envelope_q15(position + i) + (1 << 14)) >> 15);
+            ramp_gains[2 * i] = ramp_gains[2 * i + 1] = g;
+        }
+        apply(buf, chunk * 2, ramp_gains, 0, limiter_enabled, &limited_samples);
+        buf += chunk * 2;
+        frames -= chunk;
+        position += chunk;
+    }
+}
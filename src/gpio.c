@@ -1,6 +1,7 @@
 ﻿#include "gpio.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 #include <sys/mman.h>
 #include <unistd.h>
@@ -18,12 +19,70 @@ static int gpio_fd = -1;
 // The corresponding physical pins are, in order:
 // 11, 13, 27, 29, 31, 33, 35, 37.
 
-const unsigned int led_lines[8] = {17, 27, 0, 5, 6, 13, 19, 26};
+// --pins replaces this map at startup, with up to every pin of both banks.
+unsigned int led_lines[LED_MAX_CHANNELS] = {17, 27, 0, 5, 6, 13, 19, 26};
+int led_count = 8;
+
+int gpio_set_pin_map(const char *spec) {
+    unsigned int lines[LED_MAX_CHANNELS];
+    int count = 0;
+
+    while (*spec) {
+        char *end;
+        long pin = strtol(spec, &end, 10);
+        if (end == spec || pin < 0 || pin > GPIO_MAX_PIN) {
+            fprintf(stderr, "Invalid GPIO pin in map: %s\n", spec);
+            return -1;
+        }
+        if (count == LED_MAX_CHANNELS) {
+            fprintf(stderr, "Too many pins in map: %s\n", spec);
+            return -1;
+        }
+        lines[count++] = (unsigned int)pin;
+        if (*end == ',')
+            end++;
+        else if (*end != '\0') {
+            fprintf(stderr, "Invalid pin map separator: %s\n", end);
+            return -1;
+        }
+        spec = end;
+    }
+    return gpio_set_pin_lines(lines, count);
+}
+
+int gpio_set_pin_lines(const unsigned int *lines, int count) {
+    uint64_t seen = 0;
+
+    if (count <= 0 || count > LED_MAX_CHANNELS)
+        return -1;
+    for (int i = 0; i < count; ++i) {
+        if (lines[i] > GPIO_MAX_PIN) {
+            fprintf(stderr, "Invalid GPIO pin in map: %u\n", lines[i]);
+            return -1;
+        }
+        if (seen & (1ull << lines[i])) {
+            fprintf(stderr, "GPIO %u used twice in pin map\n", lines[i]);
+            return -1;
+        }
+        seen |= 1ull << lines[i];
+    }
+
+    memcpy(led_lines, lines, count * sizeof(lines[0]));
+    led_count = count;
+    return 0;
+}
+
+uint64_t gpio_pins_mask(const unsigned int *lines, int count) {
+    uint64_t mask = 0;
+    for (int i = 0; i < count; ++i)
+        mask |= (1ull << lines[i]);
+    return mask;
+}
 
 // --------------------------------------------------------------
 // Initialization and cleanup
 // --------------------------------------------------------------
-void gpio_init(void) {
+int gpio_init(void) {
     // Try /dev/gpiomem first (works without root, preferred on Raspberry Pi)
     gpio_fd = open("/dev/gpiomem", O_RDWR | O_SYNC);
     if (gpio_fd >= 0) {
@@ -33,7 +92,7 @@ void gpio_init(void) {
             gpio_fd, 0
         );
         if (gpio != MAP_FAILED) {
-            return;  // Success with /dev/gpiomem
+            return 0;  // Success with /dev/gpiomem
         }
         close(gpio_fd);
     }
@@ -42,7 +101,8 @@ void gpio_init(void) {
     gpio_fd = open("/dev/mem", O_RDWR | O_SYNC);
     if (gpio_fd < 0) {
         perror("open /dev/gpiomem and /dev/mem both failed");
-        exit(1);
+        gpio = NULL;
+        return -1;
     }
 
     gpio = (volatile uint32_t *)mmap(
@@ -52,8 +112,11 @@ void gpio_init(void) {
     if (gpio == MAP_FAILED) {
         perror("mmap");
         close(gpio_fd);
-        exit(1);
+        gpio_fd = -1;
+        gpio = NULL;
+        return -1;
     }
+    return 0;
 }
 
 void gpio_cleanup(void) {
@@ -80,10 +143,19 @@ void gpio_set_outputs(const unsigned int *lines, int count) {
 void gpio_all_off(const unsigned int *lines, int count) {
     if (!gpio || gpio == MAP_FAILED)
         return;
-    volatile uint32_t *GPCLR0 = gpio + 0x28 / 4;
-    uint32_t mask = 0;
-    for (int i = 0; i < count; ++i)
-        mask |= (1u << lines[i]);
-    *GPCLR0 = mask;
+    uint64_t mask = gpio_pins_mask(lines, count);
+    gpio[GPCLR0_REG] = (uint32_t)mask;
+    if (mask >> 32)
+        gpio[GPCLR1_REG] = (uint32_t)(mask >> 32);
     __sync_synchronize();  // Memory barrier to ensure write completes
 }
+
+void gpio_all_on(const unsigned int *lines, int count) {
+    if (!gpio || gpio == MAP_FAILED)
+        return;
+    uint64_t mask = gpio_pins_mask(lines, count);
+    gpio[GPSET0_REG] = (uint32_t)mask;
+    if (mask >> 32)
+        gpio[GPSET1_REG] = (uint32_t)(mask >> 32);
+    __sync_synchronize();
+}
@@ -0,0 +1,169 @@
+#include "latency.h"
+
+// Observation window for narrowing decisions
+#define WINDOW_SEC            2.0
+// Quiet windows in a row before we dare to narrow by one period
+#define NARROW_AFTER_WINDOWS  5
+// ALSA buffer is kept this many periods above the fill target
+#define BUFFER_HEADROOM       2
+#define MAX_TARGET_PERIODS    10
+
+static int adaptive_enabled = 0;
+
+static unsigned int target_periods = 0;
+static unsigned int buffer_periods = 0;
+static unsigned int pending_buffer = 0;  // Applied at next song start
+static unsigned int min_target = 1;
+static unsigned int period_us = 10000;
+
+// Current observation window
+static double window_start = 0;
+static long window_max_jitter = 0;
+static long window_min_delay = -1;
+static int window_dirty = 0;             // Widened during this window
+static int quiet_windows = 0;
+
+static LatencyDecision decisions[LATENCY_MAX_DECISIONS];
+static size_t decision_count = 0;
+
+static void log_decision(double t, unsigned int new_target, unsigned int new_buffer,
+                         const char *reason) {
+    if (decision_count < LATENCY_MAX_DECISIONS) {
+        decisions[decision_count++] = (LatencyDecision){
+            t, target_periods, new_target, buffer_periods, new_buffer, reason
+        };
+    }
+}
+
+static void record(double t, unsigned int new_target, unsigned int new_buffer,
+                   const char *reason) {
+    log_decision(t, new_target, new_buffer, reason);
+    target_periods = new_target;
+    buffer_periods = new_buffer;
+}
+
+static void reset_window(double t) {
+    window_start = t;
+    window_max_jitter = 0;
+    window_min_delay = -1;
+    window_dirty = 0;
+}
+
+// Slack between the fill target and the thread's minimum safe fill
+static long slack_us(void) {
+    return (long)(target_periods - min_target + 1) * period_us;
+}
+
+static void widen(double t, const char *reason) {
+    if (window_dirty)
+        return;  // One step per window, let the last one take effect
+    window_dirty = 1;
+    quiet_windows = 0;
+
+    if (target_periods + 1 > MAX_TARGET_PERIODS)
+        return;
+
+    // The live target can only grow inside the current ALSA buffer;
+    // a bigger buffer needs setup_alsa() and waits for the next song
+    if (target_periods + 1 >= buffer_periods) {
+        unsigned int want = target_periods + 1 + BUFFER_HEADROOM;
+        if (want > pending_buffer) {
+            pending_buffer = want;
+            // Logged only: the live buffer stays as it is until then
+            log_decision(t, target_periods, want, "buffer full, widen ALSA buffer next song");
+        }
+        return;
+    }
+
+    record(t, target_periods + 1, buffer_periods, reason);
+}
+
+void latency_set_adaptive(int enabled) {
+    adaptive_enabled = enabled;
+}
+
+int latency_adaptive_enabled(void) {
+    return adaptive_enabled;
+}
+
+void latency_song_start(unsigned int song_min_target, unsigned int song_period_us) {
+    decision_count = 0;
+    min_target = song_min_target ? song_min_target : 1;
+    period_us = song_period_us ? song_period_us : 10000;
+    quiet_windows = 0;
+    reset_window(0);
+
+    if (buffer_periods == 0) {
+        // First song: start from the low-latency end
+        record(0, min_target, min_target + BUFFER_HEADROOM,
+               "initial low-latency configuration");
+        pending_buffer = 0;
+        return;
+    }
+
+    unsigned int new_target = target_periods < min_target ? min_target : target_periods;
+    unsigned int new_buffer = pending_buffer ? pending_buffer : buffer_periods;
+    if (new_buffer < new_target + BUFFER_HEADROOM)
+        new_buffer = new_target + BUFFER_HEADROOM;
+    pending_buffer = 0;
+
+    if (new_target != target_periods || new_buffer != buffer_periods)
+        record(0, new_target, new_buffer, "between songs: apply learned latency");
+}
+
+void latency_song_end(void) {
+    // Shrink the buffer after a song that settled at a lower target
+    unsigned int fit = target_periods + BUFFER_HEADROOM;
+    if (!pending_buffer && fit < buffer_periods)
+        pending_buffer = fit;
+}
+
+unsigned int latency_target_periods(void) {
+    return target_periods;
+}
+
+unsigned int latency_buffer_periods(void) {
+    return buffer_periods;
+}
+
+void latency_observe(double t, long jitter_us, long delay_frames,
+                     size_t period_frames) {
+    if (jitter_us > window_max_jitter)
+        window_max_jitter = jitter_us;
+    if (window_min_delay < 0 || delay_frames < window_min_delay)
+        window_min_delay = delay_frames;
+
+    // Widen right away when the fill got within a period of running dry
+    // or a wakeup ate more than half the slack
+    if (delay_frames < (long)period_frames)
+        widen(t, "ALSA delay below one period");
+    else if (jitter_us > slack_us() / 2)
+        widen(t, "wake jitter above half the slack");
+
+    if (t - window_start < WINDOW_SEC)
+        return;
+
+    // Window closed: narrow only if one period less would still leave
+    // 4x margin over the worst jitter and the fill never dipped below 2
+    long slack_after = slack_us() - period_us;
+    int quiet = !window_dirty &&
+                window_max_jitter < slack_after / 4 &&
+                window_min_delay >= 2 * (long)period_frames;
+
+    quiet_windows = quiet ? quiet_windows + 1 : 0;
+    if (quiet_windows >= NARROW_AFTER_WINDOWS && target_periods > min_target) {
+        record(t, target_periods - 1, buffer_periods, "stable, narrow fill target");
+        quiet_windows = 0;
+    }
+
+    reset_window(t);
+}
+
+void latency_note_underrun(double t) {
+    widen(t, "underrun");
+}
+
+const LatencyDecision *latency_decisions(size_t *count) {
+    *count = decision_count;
+    return decisions;
+}
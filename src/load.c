@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <math.h>
 
 #include <sys/mman.h>
 #include <sys/stat.h>
@@ -33,6 +34,10 @@ typedef struct {
 
 Pattern patterns[MAX_PATTERNS];
 int pattern_count = 0;
+uint64_t pattern_total_us = 0;
+int pattern_channels = 0;
+uint8_t pattern_levels[MAX_PATTERNS][PATTERN_MAX_CHANNELS];
+int pattern_dimmed = 0;
 
 WavData load_wav_mmap(const char *filename)
 {
@@ -114,30 +119,312 @@ void free_wav_mmap(WavData *wav)
     memset(wav, 0, sizeof(*wav));
 }
 
+// ----------------------------------------------------------------------------
+// Pattern files
+//
+// Two cue syntaxes, freely mixed:
+//   TTTT BBBB.BBBB         legacy: duration in ms (fractions allowed)
+//   @mm:ss.mmm BBBB.BBBB   absolute: cue time from the start of the show,
+//   @TTTT BBBB.BBBB        as mm:ss.fff or in ms ("@" optional with ':')
+//   @mm:ss.mmm end         absolute end of the show (holds the last cue)
+//   @mm:ss.mmm             anchor: the next legacy cue starts here
+// A cue lasts until the next one. A legacy cue starts where the previous
+// legacy cue ended, or at the anchor or absolute cue before it; a cue that
+// starts at the same time as the one before replaces it, so a legacy block
+// is anchored with a bare "@mm:ss.mmm". Anything else (e.g. "# comment")
+// is ignored.
+// Either pattern may also be a list of brightness levels, "255,128,0,...",
+// one 0-255 value per channel (shown through the PWM thread).
+// ----------------------------------------------------------------------------
+
+typedef enum {
+    CUE_NONE,
+    CUE_DURATION,   // value = duration
+    CUE_ABSOLUTE,   // value = start time
+    CUE_END,        // value = end of show
+    CUE_ANCHOR,     // value = start of the next legacy cue
+} CueKind;
+
+// On/off digits ("1010.1100", dots skipped) or levels ("255,0,64").
+// Channel i is the i-th digit or value; bit i of the result is set when
+// its level is non-zero. Returns -1 if this is not a pattern.
+static int parse_pattern(const char *tok, uint64_t *bits, uint8_t *levels, int *channels) {
+    uint64_t p = 0;
+    int i = 0;
+
+    memset(levels, 0, PATTERN_MAX_CHANNELS);
+    if (strchr(tok, ',')) {
+        while (*tok && i < PATTERN_MAX_CHANNELS) {
+            char *end;
+            long v = strtol(tok, &end, 10);
+            if (end == tok || v < 0 || v > 255 || (*end != ',' && *end != '\0'))
+                return -1;
+            levels[i] = (uint8_t)v;
+            if (v) p |= 1ull << i;
+            ++i;
+            tok = *end ? end + 1 : end;
+        }
+    } else {
+        if (tok[0] != '0' && tok[0] != '1')
+            return -1;
+        for (int j = 0; i < PATTERN_MAX_CHANNELS && tok[j]; ++j) {
+            if (tok[j] == '.') continue;
+            if (tok[j] == '1') {
+                p |= 1ull << i;
+                levels[i] = 255;
+            }
+            ++i;
+        }
+    }
+    *bits = p;
+    *channels = i;
+    return 0;
+}
+
+// "mm:ss.fff", "h:mm:ss.fff" or plain milliseconds, into microseconds
+static int parse_timecode(const char *s, uint64_t *us) {
+    double fields[3];
+    int n = 0;
+    char *end;
+
+    for (;;) {
+        if (n == 3) return -1;
+        fields[n++] = strtod(s, &end);
+        if (end == s || fields[n - 1] < 0) return -1;
+        if (*end != ':') break;
+        s = end + 1;
+    }
+    if (*end != '\0') return -1;
+
+    double ms = fields[0];
+    if (n > 1) {
+        double sec = 0;
+        for (int i = 0; i < n; i++)
+            sec = sec * 60 + fields[i];
+        ms = sec * 1000.0;
+    }
+    *us = (uint64_t)llround(ms * 1000.0);
+    return 0;
+}
+
+static CueKind parse_cue_line(const char *line, uint64_t *value_us, uint64_t *pattern,
+                              uint8_t *levels, int *channels) {
+    char when[32], bits[PATTERN_LINE_MAX];
+    int fields = sscanf(line, "%31s %319s", when, bits);
+    if (fields < 1)
+        return CUE_NONE;
+
+    int absolute = when[0] == '@' || strchr(when, ':') != NULL;
+    if ((fields == 1 && !absolute) || parse_timecode(when + (when[0] == '@'), value_us) != 0)
+        return CUE_NONE;
+
+    if (fields == 1)
+        return CUE_ANCHOR;
+    if (absolute && strcmp(bits, "end") == 0)
+        return CUE_END;
+    if (parse_pattern(bits, pattern, levels, channels) != 0)
+        return CUE_NONE;
+    return absolute ? CUE_ABSOLUTE : CUE_DURATION;
+}
+
 void load_patterns(const char *filename) {
     FILE *f = fopen(filename, "r");
     if (!f) { perror("pattern open"); exit(1); }
 
-    char line[64];
+    char line[PATTERN_LINE_MAX];
+    int line_no = 0;
+    uint64_t cursor = 0;   // End of the cues so far
     pattern_count = 0;
+    pattern_channels = 0;
+    pattern_dimmed = 0;
 
+    // Durations are kept in microseconds, with no 10ms floor or rounding
     while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        uint64_t value, p;
+        int channels = 0;
+        uint8_t levels[PATTERN_MAX_CHANNELS];
+        CueKind kind = parse_cue_line(line, &value, &p, levels, &channels);
+        if (kind == CUE_NONE)
+            continue;
+
+        if (kind == CUE_END) {
+            if (value > cursor) cursor = value;
+            continue;
+        }
+        if (kind == CUE_ANCHOR) {
+            if (value < cursor)
+                fprintf(stderr, "%s:%d: anchor goes back in time, ignored\n", filename, line_no);
+            else
+                cursor = value;
+            continue;
+        }
         if (pattern_count >= MAX_PATTERNS) {
             fprintf(stderr, "Too many patterns!\n");
             break;
         }
-        int dur; char bits[10];
-        if (sscanf(line, "%d %9s", &dur, bits) == 2) {
-            if (dur < 10) dur = 10;  // minimum 10ms
-            dur = ((dur + 5) / 10) * 10;  // round to nearest 10ms
-            uint8_t p = 0;
-            for (int i = 0, j = 0; i < 8 && bits[j]; ++j) {
-                if (bits[j] == '.') continue;
-                p = (p << 1) | (bits[j] == '1' ? 1 : 0);
-                ++i;
+
+        uint64_t start = cursor;
+        if (kind == CUE_ABSOLUTE) {
+            if (value < cursor)
+                fprintf(stderr, "%s:%d: cue goes back in time, moved to %.3f s\n",
+                        filename, line_no, cursor / 1e6);
+            else
+                start = value;
+        }
+        // Two cues at once would be a zero-length record (a one-commit
+        // flicker): the later line wins
+        if (pattern_count > 0 && patterns[pattern_count - 1].start_us == start) {
+            fprintf(stderr, "%s:%d: replaces the cue at %.3f s\n", filename, line_no, start / 1e6);
+            pattern_count--;
+        }
+        memcpy(pattern_levels[pattern_count], levels, sizeof(levels));
+        patterns[pattern_count++] = (Pattern){start, 0, p};
+        if (channels > pattern_channels)
+            pattern_channels = channels;
+        for (int c = 0; c < channels && !pattern_dimmed; c++)
+            pattern_dimmed = levels[c] != 0 && levels[c] != 255;
+        cursor = kind == CUE_DURATION ? start + value : start;
+    }
+    fclose(f);
+
+    // Every cue lasts until the next one; the last until the end of the show
+    for (int i = 0; i < pattern_count; i++) {
+        uint64_t next = i + 1 < pattern_count ? patterns[i + 1].start_us : cursor;
+        patterns[i].duration_us = (uint32_t)(next - patterns[i].start_us);
+    }
+    pattern_total_us = cursor;
+}
+
+void format_timecode(char *out, size_t len, uint64_t us) {
+    unsigned long long sec = us / 1000000;
+    unsigned int frac = (unsigned int)(us % 1000000);
+    if (frac % 1000 == 0)
+        snprintf(out, len, "%02llu:%02llu.%03u", sec / 60, sec % 60, frac / 1000);
+    else
+        snprintf(out, len, "%02llu:%02llu.%06u", sec / 60, sec % 60, frac);
+}
+
+int convert_patterns_absolute(const char *filename) {
+    char backup[512], tmp[512], when[32];
+    if (snprintf(backup, sizeof(backup), "%s.legacy", filename) >= (int)sizeof(backup) ||
+        snprintf(tmp, sizeof(tmp), "%s.tmp.%d", filename, (int)getpid()) >= (int)sizeof(tmp))
+        return -1;
+
+    // A second run would replace the original with the converted file
+    if (access(backup, F_OK) == 0) {
+        fprintf(stderr, "%s: %s already exists (converted before?), not converting\n",
+                filename, backup);
+        return -1;
+    }
+
+    load_patterns(filename);
+
+    FILE *f = fopen(tmp, "w");
+    if (!f) { perror(tmp); return -1; }
+    fprintf(f, "# Absolute cues (@mm:ss.mmm), converted from %s\n", backup);
+    for (int i = 0; i < pattern_count; i++) {
+        // Same width as the source: on/off digits with a dot every 4
+        // channels, or levels when the cue dims anything
+        const uint8_t *levels = pattern_levels[i];
+        int dimmed = 0;
+        for (int c = 0; c < pattern_channels; c++)
+            dimmed |= levels[c] != 0 && levels[c] != 255;
+
+        char bits[PATTERN_LINE_MAX];
+        int n = 0;
+        for (int c = 0; c < pattern_channels; c++) {
+            if (dimmed)
+                n += snprintf(bits + n, sizeof(bits) - n, c ? ",%u" : "%u", levels[c]);
+            else {
+                if (c && c % 4 == 0) bits[n++] = '.';
+                bits[n++] = levels[c] ? '1' : '0';
             }
-            patterns[pattern_count++] = (Pattern){dur, p};
+        }
+        bits[n] = '\0';
+        format_timecode(when, sizeof(when), patterns[i].start_us);
+        fprintf(f, "@%s %s\n", when, bits);
+    }
+    format_timecode(when, sizeof(when), pattern_total_us);
+    fprintf(f, "@%s end\n", when);
+
+    // Keep the original next to it, then swap the new file in
+    if (fclose(f) != 0 || rename(filename, backup) != 0 || rename(tmp, filename) != 0) {
+        perror(filename);
+        unlink(tmp);
+        return -1;
+    }
+    printf("%s: %d cues converted, original kept as %s\n", filename, pattern_count, backup);
+    return 0;
+}
+
+// Duration as the old 10ms-tick player used it: whole ms, at least one
+// tick, rounded to the nearest tick
+static uint64_t legacy_rounded_us(uint64_t us) {
+    int ms = (int)(us / 1000);
+    if (ms < 10) ms = 10;
+    ms = ((ms + 5) / 10) * 10;
+    return (uint64_t)ms * 1000;
+}
+
+int report_pattern_drift(const char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (!f) { perror(filename); return -1; }
+
+    char line[PATTERN_LINE_MAX], when[32];
+    int line_no = 0, cues = 0, legacy = 0, late_cues = 0, worst_line = 0;
+    uint64_t exact = 0, rounded = 0, worst_at = 0;
+    int64_t worst = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        uint64_t value, p;
+        int channels;
+        uint8_t levels[PATTERN_MAX_CHANNELS];
+        CueKind kind = parse_cue_line(line, &value, &p, levels, &channels);
+        if (kind == CUE_NONE)
+            continue;
+        if (kind == CUE_END) {
+            if (value > exact) {
+                rounded += value - exact;
+                exact = value;
+            }
+            continue;
+        }
+
+        // Absolute cues and anchors resynchronize both schedules
+        if (kind == CUE_ABSOLUTE || kind == CUE_ANCHOR) {
+            if (value > exact) exact = value;
+            rounded = exact;
+        }
+        if (kind == CUE_ANCHOR)
+            continue;
+
+        int64_t drift = (int64_t)rounded - (int64_t)exact;
+        if (llabs(drift) > llabs(worst)) {
+            worst = drift;
+            worst_line = line_no;
+            worst_at = exact;
+        }
+        if (llabs(drift) >= 10000)
+            late_cues++;
+        cues++;
+
+        if (kind == CUE_DURATION) {
+            legacy++;
+            exact += value;
+            rounded += legacy_rounded_us(value);
         }
     }
     fclose(f);
+
+    printf("%s: %d cues (%d legacy), %.3f s\n", filename, cues, legacy, exact / 1e6);
+    printf("  Legacy rounding (whole ms, 10ms ticks):\n");
+    printf("  End of show:   %+.3f s\n", ((int64_t)rounded - (int64_t)exact) / 1e6);
+    if (worst_line) {
+        format_timecode(when, sizeof(when), worst_at);
+        printf("  Worst cue:     %+.3f s at line %d (%s)\n", worst / 1e6, worst_line, when);
+    }
+    printf("  Cues off by >= 10 ms: %d of %d\n", late_cues, cues);
+    return 0;
 }
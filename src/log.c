@@ -1,6 +1,7 @@
 ﻿#include "log.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 // Helper to compute statistics
@@ -57,8 +58,26 @@ void save_playback_report(const char *filename, const PlaybackStats *stats) {
     fprintf(f, "Audio format:      %s\n", stats->audio_format);
     fprintf(f, "Sample rate:       %u Hz\n", stats->sample_rate);
     fprintf(f, "Channels:          %u\n", stats->channels);
+    if (stats->device_rate)
+        fprintf(f, "Device rate:       %u Hz (resampler: %s)\n",
+                stats->device_rate, stats->resampler ? stats->resampler : "off");
+    if (stats->alsa_access)
+        fprintf(f, "ALSA access:       %s\n", stats->alsa_access);
     fprintf(f, "Pattern count:     %d\n", stats->pattern_count);
-    fprintf(f, "Duration:          %.2f sec\n\n", stats->playback_duration_sec);
+    fprintf(f, "Duration:          %.2f sec\n", stats->playback_duration_sec);
+    if (stats->time_to_first_sample_ms > 0)
+        fprintf(f, "First sample:      %.1f ms after start\n", stats->time_to_first_sample_ms);
+    if (stats->start_gated)
+        fprintf(f, "Gated start:       ready %.1f ms ahead, audio %+.1f us, first cue %+.1f us\n",
+                stats->start_ready_ms, stats->start_audio_us, stats->start_led_us);
+    if (stats->start_offset_us > 0)
+        fprintf(f, "Start offset:      %.3f s, seek %.2f ms, from cue %u\n",
+                stats->start_offset_us / 1e6, stats->seek_ms, stats->first_cue);
+    if (stats->audio_locked_peak_bytes > 0)
+        fprintf(f, "Audio locked peak: %.1f MB\n", stats->audio_locked_peak_bytes / 1048576.0);
+    if (stats->peak_rss_kb > 0)
+        fprintf(f, "Peak RSS:          %.1f MB\n", stats->peak_rss_kb / 1024.0);
+    fprintf(f, "\n");
 
     // Audio thread statistics
     if (stats->audio_samples > 0) {
@@ -72,13 +91,28 @@ void save_playback_report(const char *filename, const PlaybackStats *stats) {
         fprintf(f, "Processing time:   min=%ld us, max=%ld us, avg=%.1f us, p99=%ld us\n",
                 min, max, avg, p99);
 
+        if (stats->audio_dsp_ns) {
+            compute_stats(stats->audio_dsp_ns, stats->audio_samples, &min, &max, &avg, &p99);
+            fprintf(f, "  of which DSP:    min=%.2f us, max=%.2f us, avg=%.2f us "
+                    "(gain %+.1f dB, limiter %s, %llu samples limited)\n",
+                    min / 1000.0, max / 1000.0, avg / 1000.0, stats->dsp_gain_db,
+                    stats->dsp_limiter ? "on" : "off",
+                    (unsigned long long)stats->dsp_limited_samples);
+        }
+
         compute_stats(stats->audio_jitter_us, stats->audio_samples, &min, &max, &avg, &p99);
         fprintf(f, "Wake jitter:       min=%ld us, max=%ld us, avg=%.1f us, p99=%ld us\n",
                 min, max, avg, p99);
 
         compute_stats(stats->audio_wake_interval_us, stats->audio_samples, &min, &max, &avg, &p99);
-        fprintf(f, "Wake interval:     min=%ld us, max=%ld us, avg=%.1f us (target=30000 us)\n",
-                min, max, avg);
+        fprintf(f, "Wake interval:     min=%ld us, max=%ld us, avg=%.1f us (target=%ld us)\n",
+                min, max, avg, stats->audio_wake_target_us);
+
+        if (stats->audio_mode)
+            fprintf(f, "Audio mode:        %s\n", stats->audio_mode);
+        if (stats->playback_duration_sec > 0)
+            fprintf(f, "Wakeups:           %zu (%.1f/sec)\n", stats->audio_wakeups,
+                    stats->audio_wakeups / stats->playback_duration_sec);
 
         if (stats->alsa_delay_frames) {
             compute_stats(stats->alsa_delay_frames, stats->audio_samples, &min, &max, &avg, &p99);
@@ -95,6 +129,46 @@ void save_playback_report(const char *filename, const PlaybackStats *stats) {
         fprintf(f, "Underruns:         %d\n", stats->underrun_count);
         fprintf(f, "Buffer stalls:     %d\n\n", stats->buffer_stall_count);
 
+        if (stats->latency_adaptive) {
+            fprintf(f, "ADAPTIVE LATENCY (%zu decisions)\n", stats->latency_decision_count);
+            fprintf(f, "--------------------------------\n");
+            fprintf(f, "Final fill target: %u periods, ALSA buffer: %u periods\n",
+                    stats->latency_target_periods, stats->latency_buffer_periods);
+            for (size_t i = 0; i < stats->latency_decision_count; i++) {
+                const LatencyDecision *d = &stats->latency_decisions[i];
+                fprintf(f, "  t=%7.2fs target %u -> %u, buffer %u -> %u: %s\n",
+                        d->time_sec, d->old_target, d->new_target,
+                        d->old_buffer, d->new_buffer, d->reason);
+            }
+            fprintf(f, "\n");
+        }
+
+        const AvClockStats *av = stats->avclock;
+        if (av && av->observations > 0) {
+            fprintf(f, "AUDIO CLOCK (%llu samples)\n", (unsigned long long)av->observations);
+            fprintf(f, "-------------------------\n");
+            fprintf(f, "LED timeline:      %s\n", av->locked ? "locked to audio" : "free-running");
+            fprintf(f, "Drift:             %+.2f ppm vs CLOCK_MONOTONIC (loop rate %+.2f ppm)\n",
+                    av->drift_ppm, av->pll_ppm);
+            fprintf(f, "Clock residual:    rms=%.1f us, max=%.1f us, %u relocks\n",
+                    av->residual_rms_us, av->residual_max_us, av->relocks);
+            if (av->offsets > 0)
+                fprintf(f, "LED vs audio:      avg=%+.1f us, max=%.1f us (%llu cues)\n",
+                        av->offset_avg_us, av->offset_max_us, (unsigned long long)av->offsets);
+            if (stats->calibration) {
+                const CalResult *cal = stats->calibration;
+                fprintf(f, "Sync offset:       %+.3f ms calibrated for %s\n",
+                        stats->sync_offset_us / 1000.0, cal->device);
+                fprintf(f, "Calibration:       %s confidence, %d/%d clicks, spread %.3f ms, "
+                        "correlation %.2f\n", calibration_confidence(cal), cal->detected,
+                        cal->clicks, cal->spread_us / 1000.0, cal->correlation);
+            } else if (stats->sync_offset_source) {
+                fprintf(f, "Sync offset:       %+.3f ms (%s)\n",
+                        stats->sync_offset_us / 1000.0, stats->sync_offset_source);
+            }
+            fprintf(f, "\n");
+        }
+
         // Quality assessment
         fprintf(f, "AUDIO QUALITY ASSESSMENT\n");
         fprintf(f, "------------------------\n");
@@ -134,12 +208,46 @@ void save_playback_report(const char *filename, const PlaybackStats *stats) {
         long min, max, p99;
         double avg;
 
+        if (stats->playback_duration_sec > 0)
+            fprintf(f, "Wakeups:           %zu for %d cues (%.1f/sec)\n", stats->led_wakeups,
+                    stats->pattern_count, stats->led_wakeups / stats->playback_duration_sec);
+
+        fprintf(f, "Channels:          %d (%d GPIO bank%s, %d stores per cue)\n",
+                stats->led_channels, stats->gpio_banks, stats->gpio_banks > 1 ? "s" : "",
+                2 * stats->gpio_banks);
+        if (stats->output_backend) {
+            fprintf(f, "Output backend:    %s", stats->output_backend);
+            if (stats->output_commits)
+                fprintf(f, " (%llu commits timestamped)", (unsigned long long)stats->output_commits);
+            fprintf(f, "\n");
+            if (stats->output_failures)
+                fprintf(f, "Output failures:   %llu updates rejected (first: %s)\n",
+                        (unsigned long long)stats->output_failures, strerror(stats->output_errno));
+        }
+
         compute_stats(stats->gpio_write_ns, stats->gpio_samples, &min, &max, &avg, &p99);
         fprintf(f, "GPIO write time:   min=%.2f us, max=%.2f us, avg=%.2f us\n",
                 min / 1000.0, max / 1000.0, avg / 1000.0);
 
+        if (stats->led_spin_ns) {
+            long spin_min, spin_max, spin_p99;
+            double spin_avg;
+            compute_stats(stats->led_spin_ns, stats->gpio_samples,
+                          &spin_min, &spin_max, &spin_avg, &spin_p99);
+            fprintf(f, "Precision mode:    wake early, spin to the deadline\n");
+            fprintf(f, "Spin time:         avg=%.2f us, max=%.2f us, p99=%.2f us",
+                    spin_avg / 1000.0, spin_max / 1000.0, spin_p99 / 1000.0);
+            if (stats->playback_duration_sec > 0)
+                fprintf(f, " (%.3f%% CPU)", spin_avg * stats->gpio_samples / 1e7 /
+                                            stats->playback_duration_sec);
+            fprintf(f, "\n");
+            fprintf(f, "Early-wake margin: %.2f us at end, %zu late wakes (no spin)\n",
+                    stats->led_margin_ns / 1000.0, stats->led_late_wakes);
+        }
+
         compute_stats(stats->gpio_jitter_ns, stats->gpio_samples, &min, &max, &avg, &p99);
-        fprintf(f, "Wake jitter:       min=%.2f us, max=%.2f us, avg=%.2f us, p99=%.2f us\n",
+        fprintf(f, "%s min=%.2f us, max=%.2f us, avg=%.2f us, p99=%.2f us\n",
+                stats->led_spin_ns ? "Edge error:       " : "Wake jitter:      ",
                 min / 1000.0, max / 1000.0, avg / 1000.0, p99 / 1000.0);
 
         fprintf(f, "\nLED QUALITY ASSESSMENT\n");
@@ -154,6 +262,70 @@ void save_playback_report(const char *filename, const PlaybackStats *stats) {
         fprintf(f, "\n");
     }
 
+    // Brightness PWM
+    if (stats->pwm) {
+        const PwmStats *pwm = stats->pwm;
+        fprintf(f, "PWM THREAD STATISTICS (%llu periods)\n", (unsigned long long)pwm->periods);
+        fprintf(f, "-----------------------------------\n");
+        fprintf(f, "Frequency:         %.2f Hz (target %u Hz)\n", pwm->achieved_hz, pwm->target_hz);
+        if (pwm->cpu >= 0)
+            fprintf(f, "Pinned to CPU:     %d\n", pwm->cpu);
+        else
+            fprintf(f, "Pinned to CPU:     no\n");
+        fprintf(f, "Duty error:        avg=%.3f%%, max=%.3f%% (of full scale)\n",
+                pwm->duty_err_avg, pwm->duty_err_max);
+        fprintf(f, "Late slots:        %llu\n", (unsigned long long)pwm->late_slots);
+        fprintf(f, "\n");
+    }
+
+    // WS2812 pixel strip
+    if (stats->pixels) {
+        const PixelStats *px = stats->pixels;
+        double frame_us = px->encode_avg_us + px->write_avg_us;
+        fprintf(f, "PIXEL OUTPUT STATISTICS (%llu frames)\n", (unsigned long long)px->frames);
+        fprintf(f, "--------------------------------------\n");
+        fprintf(f, "Strip:             %u pixels, %zu bytes per frame\n", px->pixels, px->frame_bytes);
+        fprintf(f, "Encode:            avg=%.2f us, max=%.2f us\n", px->encode_avg_us, px->encode_max_us);
+        fprintf(f, "SPI write:         avg=%.2f us, max=%.2f us\n", px->write_avg_us, px->write_max_us);
+        if (frame_us > 0)
+            fprintf(f, "Max frame rate:    %.1f fps\n", 1e6 / frame_us);
+        fprintf(f, "Merged cues:       %llu\n", (unsigned long long)px->merged_cues);
+        fprintf(f, "Write errors:      %llu\n", (unsigned long long)px->write_errors);
+        fprintf(f, "\n");
+    }
+
+    // Multi-node sync (netsync.h)
+    if (stats->netsync) {
+        const NetSyncStats *ns = stats->netsync;
+        const NetSyncTimeline *tl = &ns->timeline;
+        fprintf(f, "MULTI-NODE SYNC (%s, song %u)\n",
+                ns->role == NETSYNC_LEADER ? "leader" : "follower", tl->song_seq);
+        fprintf(f, "-------------------------------\n");
+        if (ns->role == NETSYNC_FOLLOWER) {
+            fprintf(f, "Leader clock:      offset %+.3f ms, skew %+.3f ppm\n",
+                    ns->offset_us / 1000.0, ns->skew_ppm);
+            fprintf(f, "Exchanges:         %llu (%llu rejected, %llu restarts), best rtt %.1f us, "
+                    "residual %.1f us\n", (unsigned long long)ns->exchanges,
+                    (unsigned long long)ns->rejected, (unsigned long long)ns->restarts,
+                    ns->delay_us, ns->residual_us);
+        }
+        fprintf(f, "LEDs vs timeline:  avg=%+.1f us, max=%.1f us (%llu cues)\n",
+                tl->led_avg_us, tl->led_max_us, (unsigned long long)tl->cues);
+        fprintf(f, "Audio vs timeline: avg=%.1f us, max=%.1f us\n",
+                tl->audio_avg_us, tl->audio_max_us);
+        for (size_t i = 0; i < ns->node_count; i++) {
+            const NetSyncNode *n = &ns->nodes[i];
+            if (n->timeline.song_seq != tl->song_seq)
+                continue;
+            fprintf(f, "Node %-21s LEDs avg=%+.1f max=%.1f us, audio avg=%.1f max=%.1f us, "
+                    "%+.1f us vs leader (skew %+.2f ppm, rtt %.1f us)\n",
+                    n->addr, n->timeline.led_avg_us, n->timeline.led_max_us,
+                    n->timeline.audio_avg_us, n->timeline.audio_max_us,
+                    n->timeline.led_avg_us - tl->led_avg_us, n->skew_ppm, n->delay_us);
+        }
+        fprintf(f, "\n");
+    }
+
     // CSV data section
     fprintf(f, "================================================================================\n");
     fprintf(f, "RAW DATA (CSV format)\n");
@@ -162,15 +334,16 @@ void save_playback_report(const char *filename, const PlaybackStats *stats) {
     // Audio data
     if (stats->audio_samples > 0) {
         fprintf(f, "# Audio thread data\n");
-        fprintf(f, "audio_index,runtime_us,jitter_us,wake_interval_us,alsa_delay,ring_buffer\n");
+        fprintf(f, "audio_index,runtime_us,jitter_us,wake_interval_us,alsa_delay,ring_buffer,dsp_ns\n");
         for (size_t i = 0; i < stats->audio_samples; i++) {
-            fprintf(f, "%zu,%ld,%ld,%ld,%ld,%ld\n",
+            fprintf(f, "%zu,%ld,%ld,%ld,%ld,%ld,%ld\n",
                     i,
                     stats->audio_runtime_us[i],
                     stats->audio_jitter_us[i],
                     stats->audio_wake_interval_us[i],
                     stats->alsa_delay_frames ? stats->alsa_delay_frames[i] : 0,
-                    stats->audio_buffer_frames ? stats->audio_buffer_frames[i] : 0);
+                    stats->audio_buffer_frames ? stats->audio_buffer_frames[i] : 0,
+                    stats->audio_dsp_ns ? stats->audio_dsp_ns[i] : 0);
         }
         fprintf(f, "\n");
     }
@@ -178,12 +351,15 @@ void save_playback_report(const char *filename, const PlaybackStats *stats) {
     // GPIO data
     if (stats->gpio_samples > 0) {
         fprintf(f, "# LED thread data\n");
-        fprintf(f, "gpio_index,write_ns,jitter_ns\n");
+        fprintf(f, "gpio_index,write_ns,jitter_ns%s\n", stats->led_spin_ns ? ",spin_ns" : "");
         for (size_t i = 0; i < stats->gpio_samples; i++) {
-            fprintf(f, "%zu,%ld,%ld\n",
+            fprintf(f, "%zu,%ld,%ld",
                     i,
                     stats->gpio_write_ns[i],
                     stats->gpio_jitter_ns[i]);
+            if (stats->led_spin_ns)
+                fprintf(f, ",%ld", stats->led_spin_ns[i]);
+            fprintf(f, "\n");
         }
     }
 
@@ -20,14 +20,14 @@
  *                               | writes
  *                               v
  *                     +-------------------+
- *                     |    Ring Buffer    | (~3 sec at 48kHz stereo)
+ *                     |    Ring Buffer    | (lock-free, ~2.7 s @48kHz)
  *                     +---------+---------+
  *                               | reads
  *                               v
  * +-------------------+   +-------------------+
  * |    LED Thread     |   |   Audio Thread    | (SCHED_FIFO, prio 75)
  * | SCHED_FIFO prio80 |   |  - audio_read()   |
- * | - 10ms tick rate  |   |  - ALSA writei()  |
+ * | - cue deadlines   |   |  - ALSA writei()  |
  * | - GPIO mmap write |   |  - 30ms period    |
  * | - checks stop_req |   |  - checks stop_req|
  * +-------------------+   +-------------------+
@@ -36,7 +36,7 @@
  *     [GPIO pins]            [ALSA/audio]
  *
  * Threading Model:
- * - LED thread:     SCHED_FIFO priority 80 (highest), 10ms period
+ * - LED thread:     SCHED_FIFO priority 80 (highest), wakes per cue change
  * - Audio thread:   SCHED_FIFO priority 75, 30ms period
  * - Decoder thread: Normal priority (MP3 only), runs ahead filling buffer
  *
@@ -46,7 +46,7 @@
  * - Main thread waits for threads to join, then cleans up GPIO
  *
  * For WAV files: mmap + mlock for hard real-time (no disk I/O during playback)
- * For MP3 files: Ring buffer with ~3 sec pre-buffer for soft real-time
+ * For MP3 files: Lock-free ring buffer with 100ms pre-buffer for soft real-time
  *
  * Capabilities required (non-root execution):
  * - cap_sys_rawio:  GPIO memory mapping (/dev/gpiomem access)
@@ -55,7 +55,22 @@
 
 #include "player.h"
 #include "gpio.h"
+#include "output.h"
 #include "udp.h"
+#include "bench.h"
+#include "setup_alsa.h"
+#include "latency.h"
+#include "pcm_cache.h"
+#include "audio.h"
+#include "dsp.h"
+#include "show.h"
+#include "load.h"
+#include "pwm.h"
+#include "pixels.h"
+#include "recorder.h"
+#include "avclock.h"
+#include "calibrate.h"
+#include "netsync.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -64,10 +79,78 @@
 #include <syslog.h>
 #include <signal.h>
 #include <getopt.h>
+#include <math.h>
 #include <sys/mman.h>
 
 #define MAX_SONG_NAME 64
 
+// Long-only options (values outside the short-option range)
+enum {
+    OPT_PRECACHE = 256,
+    OPT_RESAMPLE,
+    OPT_FADE_IN,
+    OPT_FADE_OUT,
+    OPT_FADE_STOP,
+    OPT_COMPILE,
+    OPT_TO_ABSOLUTE,
+    OPT_DRIFT,
+    OPT_PINS,
+    OPT_PWM_HZ,
+    OPT_PWM_CPU,
+    OPT_PIXELS,
+    OPT_PIXEL_OUT,
+    OPT_PIXEL_COLOR,
+    OPT_OUTPUT,
+    OPT_PRECISE,
+    OPT_FREE_RUN,
+    OPT_CALIBRATE,
+    OPT_SYNC_OFFSET,
+    OPT_SYNC_LEADER,
+    OPT_SYNC_FOLLOW,
+    OPT_START_AT,
+    OPT_OFFSET,
+    OPT_RECORD,
+    OPT_RECORD_LEVELS,
+    OPT_ANALYZE,
+};
+
+static const struct option long_options[] = {
+    { "cache-dir", required_argument, NULL, 'c' },
+    { "precache",  no_argument,       NULL, OPT_PRECACHE },
+    { "preload",   required_argument, NULL, 'p' },
+    { "wav-window", required_argument, NULL, 'w' },
+    { "device-rate", required_argument, NULL, 'r' },
+    { "resample",  required_argument, NULL, OPT_RESAMPLE },
+    { "gain",      required_argument, NULL, 'g' },
+    { "limiter",   no_argument,       NULL, 'L' },
+    { "fade-in",   required_argument, NULL, OPT_FADE_IN },
+    { "fade-out",  required_argument, NULL, OPT_FADE_OUT },
+    { "fade-stop", required_argument, NULL, OPT_FADE_STOP },
+    { "compile",   required_argument, NULL, OPT_COMPILE },
+    { "to-absolute", required_argument, NULL, OPT_TO_ABSOLUTE },
+    { "drift",     required_argument, NULL, OPT_DRIFT },
+    { "pins",      required_argument, NULL, OPT_PINS },
+    { "pwm-hz",    required_argument, NULL, OPT_PWM_HZ },
+    { "pwm-cpu",   required_argument, NULL, OPT_PWM_CPU },
+    { "pixels",    required_argument, NULL, OPT_PIXELS },
+    { "pixel-out", required_argument, NULL, OPT_PIXEL_OUT },
+    { "pixel-color", required_argument, NULL, OPT_PIXEL_COLOR },
+    { "output",    required_argument, NULL, OPT_OUTPUT },
+    { "precise",   no_argument,       NULL, OPT_PRECISE },
+    { "free-run",  no_argument,       NULL, OPT_FREE_RUN },
+    { "calibrate", no_argument,       NULL, OPT_CALIBRATE },
+    { "sync-offset", required_argument, NULL, OPT_SYNC_OFFSET },
+    { "sync-leader", optional_argument, NULL, OPT_SYNC_LEADER },
+    { "sync-follow", required_argument, NULL, OPT_SYNC_FOLLOW },
+    { "start-at",  required_argument, NULL, OPT_START_AT },
+    { "offset",    required_argument, NULL, OPT_OFFSET },
+    { "record",    required_argument, NULL, OPT_RECORD },
+    { "record-levels", no_argument,   NULL, OPT_RECORD_LEVELS },
+    { "analyze",   required_argument, NULL, OPT_ANALYZE },
+    { "help",      no_argument,       NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+};
+
 
 volatile sig_atomic_t stop_requested = 0;
 
@@ -79,8 +162,9 @@ void signal_handler(int sig)
         case SIGTERM:
             // Set flag for threads to check - they will exit their loops
             stop_requested = 1;
+            player_signal_stop();
             // Turn off LEDs immediately on forced termination (signal-safe GPIO write)
-            gpio_all_off(led_lines, 8);
+            output_all_off();
             break;
 
         //case SIGCHLD:
@@ -96,27 +180,76 @@ void signal_handler(int sig)
 
 
 void print_usage(const char *prog) {
-    printf("Usage: %s [-v] [-o] [-m musicdir] [-s on|off] [songname]\n", prog);
+    printf("Usage: %s [-v] [-o] [-M] [-P] [-A] [-c cachedir] [--precache] [-p workers] [-w sec] [-r rate] [--resample fast|high] [-g dB] [-L] [--fade-in ms] [--fade-out ms] [--fade-stop ms] [--pins list] [--output mmap|sim[:file]|cdev[:chip]] [--precise] [--free-run] [--calibrate [capture]] [--sync-offset ms] [--sync-leader[=port]|--sync-follow host[:port]] [--start-at time] [--offset ms] [--record file|dir [--record-levels]] [--analyze rec [song.txt]] [--pwm-hz hz] [--pwm-cpu n] [--pixels n] [--pixel-out dev] [--pixel-color RRGGBB] [--compile|--to-absolute|--drift song.txt...] [-m musicdir] [-s on|off] [-b bench [arg]] [songname]\n", prog);
     printf("  -v              Verbose mode (print GPIO timing stats)\n");
     printf("  -o              Turn off LEDs on exit (default: keep last state)\n");
+    printf("  -M              ALSA mmap mode (copy audio straight into the DMA buffer)\n");
+    printf("  -P              Drive audio from ALSA period events (poll) instead of 30ms timer\n");
+    printf("  -A              Adaptive ALSA latency (start low, widen/narrow from jitter)\n");
+    printf("  -c cachedir     Cache decoded MP3s as PCM (cached songs play like WAV)\n");
+    printf("  --precache      Decode all MP3s in the music dir into the cache and exit\n");
+    printf("                  (cache defaults to <musicdir>.pcmcache/ without -c)\n");
+    printf("  -p workers      Decode MP3s fully before playback on N threads (0 = all CPUs)\n");
+    printf("  -w sec          Stream WAVs through a locked window of sec seconds\n");
+    printf("                  instead of mlocking the whole file\n");
+    printf("  -r rate         Run ALSA at this rate for every song (resampling), keep it open\n");
+    printf("  --resample fast|high  Resampler quality: linear or 32-tap sinc\n");
+    printf("                  (default: fast on RPI1, high otherwise)\n");
+    printf("  -g dB           Software gain (max +%.0f dB), independent of the mixer\n", DSP_MAX_GAIN_DB);
+    printf("  -L              Soft limiter above %.1f dBFS (use with positive gain)\n",
+           20.0 * log10(DSP_LIMIT_THRESHOLD / 32768.0));
+    printf("  --fade-in ms    Fade in at song start (default 0)\n");
+    printf("  --fade-out ms   Fade out at song end, when the length is known (default 0)\n");
+    printf("  --fade-stop ms  Fade out on SIGINT/SIGTERM instead of cutting (default %d)\n",
+           DSP_DEFAULT_STOP_FADE_MS);
+    printf("  --pins list     LED pin map, BCM numbers in channel order, up to %d pins\n",
+           LED_MAX_CHANNELS);
+    printf("                  across both GPIO banks (default: 17,27,0,5,6,13,19,26)\n");
+    printf("  --output mmap|sim[:file]|cdev[:chip]  LED output: GPIO registers (default),\n");
+    printf("                  a simulated register page (RAM or tmpfs file, commits\n");
+    printf("                  timestamped) or the GPIO character device (default %s)\n",
+           OUTPUT_GPIOCHIP_DEFAULT);
+    printf("  --precise       LED cues: wake early (adaptive margin) and spin to the exact\n");
+    printf("                  deadline; costs CPU, reports spin time and edge error\n");
+    printf("  --free-run      LED timeline on the system clock instead of the audio clock\n");
+    printf("                  (drift and LED-to-audio offset are still reported)\n");
+    printf("  --calibrate [capture]  Play a click track, record it back from the capture\n");
+    printf("                  device (default %s; snd-aloop or a mic) and save the\n",
+           CAL_CAPTURE_DEFAULT);
+    printf("                  output latency of this playback device in <musicdir>/%s\n", CAL_FILE);
+    printf("  --sync-offset ms  Delay LED cues by ms instead of the calibrated offset\n");
+    printf("  --sync-leader[=port]  Lead a multi-node show: answer time sync on UDP (default\n");
+    printf("                  port %d) and announce each song's start %d ms ahead\n",
+           NETSYNC_PORT, NETSYNC_START_LEAD_MS);
+    printf("  --sync-follow host[:port]  Follow a leader's clock: start songs with it and hold\n");
+    printf("                  audio and LEDs on its timeline\n");
+    printf("  --start-at time Start the song at a CLOCK_REALTIME instant (epoch seconds with\n");
+    printf("                  fraction, or +seconds): prepared and pre-rolled ahead of it\n");
+    printf("  --offset ms     Start the song this far in (audio seeked, LEDs at that cue);\n");
+    printf("                  an MP3's first seek scans it once, -c keeps its frame index\n");
+    printf("  --record file|dir  Record every LED commit (binary, dir: <song>.rec per song)\n");
+    printf("  --record-levels Also read the pin levels back after each commit\n");
+    printf("  --analyze rec [song.txt]  Diff a recording against its pattern file: lateness,\n");
+    printf("                  missed/duplicated cues, wrong pins, drift; exit 1 on failure\n");
+    printf("  --pwm-hz hz     PWM frequency for patterns with brightness levels (default %d)\n",
+           PWM_DEFAULT_HZ);
+    printf("  --pwm-cpu n     Core for the PWM thread (default: last core)\n");
+    printf("  --pixels n      Also drive a WS2812 strip of n pixels over SPI, one segment\n");
+    printf("                  per channel (max %d)\n", PIXELS_MAX);
+    printf("  --pixel-out dev spidev device or output file (default %s)\n", PIXELS_DEFAULT_DEVICE);
+    printf("  --pixel-color RRGGBB  Strip colour at full level (default FFFFFF)\n");
+    printf("  --compile song.txt...  Compile pattern files to song.show (precomputed GPIO\n");
+    printf("                  masks, mmapped at playback) and exit\n");
+    printf("  --to-absolute song.txt...  Rewrite pattern files as absolute @mm:ss.mmm cues\n");
+    printf("                  (original kept as song.txt.legacy) and exit\n");
+    printf("  --drift song.txt...  Report how far legacy duration rounding moved the cues\n");
     printf("  -m musicdir     Music directory (default: /home/linux/music/)\n");
     printf("  -s on|off       Turn all LEDs on or off and exit\n");
+    printf("  -b bench [arg]  Run an offline benchmark and exit (-b list)\n");
     printf("  songname        Play song directly (without .wav/.txt extension)\n");
     printf("  No args         Interactive menu mode\n");
 }
 
-// Turn all LEDs on
-static void gpio_all_on(const unsigned int *lines, int count) {
-    if (!gpio || gpio == MAP_FAILED)
-        return;
-    volatile uint32_t *GPSET0 = gpio + 0x1C / 4;
-    uint32_t mask = 0;
-    for (int i = 0; i < count; ++i)
-        mask |= (1u << lines[i]);
-    *GPSET0 = mask;
-    __sync_synchronize();
-}
-
 int main(int argc, char *argv[]) {
 
     openlog("sequencer", LOG_PID | LOG_CONS, LOG_USER);
@@ -124,8 +257,24 @@ int main(int argc, char *argv[]) {
     // Parse command line options
     int opt;
     char *switch_mode = NULL;  // "on" or "off"
+    char *bench_name = NULL;   // -b: run benchmark instead of playing
+    char *cache_dir = NULL;    // -c: decoded-PCM cache directory
+    char *tool_file = NULL;    // --compile/--to-absolute/--drift: process and exit
+    int (*pattern_tool)(const char *) = NULL;
+    char *record_path = NULL;  // --record
+    int record_levels = 0;
+    char *analyze_file = NULL; // --analyze: diff a recording and exit
+    int calibrate = 0;         // --calibrate: measure the output latency and exit
+    int sync_port = -1;        // --sync-leader
+    const char *sync_leader = NULL;    // --sync-follow
+    unsigned int pixel_count = 0;      // --pixels: WS2812 strip length
+    const char *pixel_out = NULL;
+    uint32_t pixel_color = 0xFFFFFF;
+    int precache = 0;          // --precache: fill the cache and exit
     int auto_off = 0;          // -o flag: turn off LEDs on exit
-    while ((opt = getopt(argc, argv, "vom:s:h")) != -1) {
+    unsigned int fade_in_ms = 0, fade_out_ms = 0;
+    unsigned int fade_stop_ms = DSP_DEFAULT_STOP_FADE_MS;
+    while ((opt = getopt_long(argc, argv, "voMPALc:p:w:r:g:m:s:b:h", long_options, NULL)) != -1) {
         switch (opt) {
             case 'v':
                 set_verbose_mode(1);
@@ -133,12 +282,143 @@ int main(int argc, char *argv[]) {
             case 'o':
                 auto_off = 1;
                 break;
+            case 'M':
+                alsa_request_mmap(1);
+                break;
+            case 'P':
+                set_audio_poll_mode(1);
+                break;
+            case 'A':
+                latency_set_adaptive(1);
+                break;
+            case 'c':
+                cache_dir = optarg;
+                break;
+            case 'p': {
+                int workers = atoi(optarg);
+                if (workers <= 0) {
+                    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+                    workers = cpus > 0 ? (int)cpus : 1;
+                }
+                audio_set_preload_workers(workers);
+                break;
+            }
+            case 'w':
+                audio_set_wav_window(atof(optarg));
+                break;
+            case 'r':
+                set_device_rate((unsigned int)atoi(optarg));
+                break;
+            case OPT_RESAMPLE: {
+                ResampleQuality quality;
+                if (resample_quality_from_name(optarg, &quality) != 0) {
+                    fprintf(stderr, "Invalid resampler quality: %s (use 'fast' or 'high')\n", optarg);
+                    return 1;
+                }
+                set_resample_quality(quality);
+                break;
+            }
+            case 'g':
+                dsp_set_gain_db(atof(optarg));
+                break;
+            case 'L':
+                dsp_set_limiter(1);
+                break;
+            case OPT_FADE_IN:
+                fade_in_ms = (unsigned int)atoi(optarg);
+                break;
+            case OPT_FADE_OUT:
+                fade_out_ms = (unsigned int)atoi(optarg);
+                break;
+            case OPT_FADE_STOP:
+                fade_stop_ms = (unsigned int)atoi(optarg);
+                break;
+            case OPT_PRECACHE:
+                precache = 1;
+                break;
+            case OPT_COMPILE:
+                pattern_tool = show_compile;
+                tool_file = optarg;
+                break;
+            case OPT_TO_ABSOLUTE:
+                pattern_tool = convert_patterns_absolute;
+                tool_file = optarg;
+                break;
+            case OPT_PINS:
+                if (gpio_set_pin_map(optarg) != 0)
+                    return 1;
+                break;
+            case OPT_OUTPUT:
+                if (output_select(optarg) != 0)
+                    return 1;
+                break;
+            case OPT_PRECISE:
+                set_led_precise(1);
+                break;
+            case OPT_FREE_RUN:
+                avclock_set_lock(0);
+                break;
+            case OPT_CALIBRATE:
+                calibrate = 1;
+                break;
+            case OPT_SYNC_OFFSET:
+                set_sync_offset_ms(atof(optarg));
+                break;
+            case OPT_START_AT:
+                if (set_start_at(optarg) != 0) {
+                    fprintf(stderr, "Invalid start time: %s (use epoch seconds or +seconds)\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_OFFSET:
+                if (set_start_offset_ms(atof(optarg)) != 0) {
+                    fprintf(stderr, "Invalid offset: %s (use milliseconds from the start)\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_SYNC_LEADER:
+                sync_port = optarg ? atoi(optarg) : NETSYNC_PORT;
+                break;
+            case OPT_SYNC_FOLLOW:
+                sync_leader = optarg;
+                break;
+            case OPT_RECORD:
+                record_path = optarg;
+                break;
+            case OPT_RECORD_LEVELS:
+                record_levels = 1;
+                break;
+            case OPT_ANALYZE:
+                analyze_file = optarg;
+                break;
+            case OPT_PWM_HZ:
+                pwm_set_frequency((unsigned int)atoi(optarg));
+                break;
+            case OPT_PWM_CPU:
+                pwm_set_cpu(atoi(optarg));
+                break;
+            case OPT_PIXELS:
+                pixel_count = (unsigned int)atoi(optarg);
+                break;
+            case OPT_PIXEL_OUT:
+                pixel_out = optarg;
+                break;
+            case OPT_PIXEL_COLOR:
+                pixel_color = (uint32_t)strtoul(optarg[0] == '#' ? optarg + 1 : optarg, NULL, 16) & 0xFFFFFF;
+                break;
+            case OPT_DRIFT:
+                pattern_tool = report_pattern_drift;
+                tool_file = optarg;
+                break;
             case 'm':
                 set_music_dir(optarg);
                 break;
             case 's':
                 switch_mode = optarg;
                 break;
+            case 'b':
+                bench_name = optarg;
+                break;
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -148,32 +428,105 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    if (sync_port >= 0 && sync_leader) {
+        fprintf(stderr, "--sync-leader and --sync-follow exclude each other\n");
+        return 1;
+    }
+
+    dsp_set_fades(fade_in_ms, fade_out_ms, fade_stop_ms);
+    pixels_configure(pixel_count, pixel_out, pixel_color);
+    recorder_configure(record_path, record_levels);
+
+    // Benchmarks need no GPIO, so they run before output_init()
+    if (bench_name != NULL) {
+        int rc = 0;
+        if (strcmp(bench_name, "list") == 0)
+            list_benchmarks();
+        else
+            rc = run_benchmark(bench_name, optind < argc ? argv[optind] : NULL);
+        closelog();
+        return rc;
+    }
+
+    // Recording analysis needs no GPIO; the pattern file defaults to the
+    // one named in the recording
+    if (analyze_file != NULL) {
+        int rc = recorder_analyze(analyze_file, optind < argc ? argv[optind] : NULL);
+        closelog();
+        return rc ? 1 : 0;
+    }
+
+    // Latency calibration needs ALSA only; extra argument is the capture device
+    if (calibrate) {
+        int rc = calibrate_run(optind < argc ? argv[optind] : NULL);
+        closelog();
+        return rc ? 1 : 0;
+    }
+
+    // Pattern file tools need no GPIO either; extra arguments are more files
+    if (pattern_tool != NULL) {
+        int failures = pattern_tool(tool_file) != 0;
+        for (int i = optind; i < argc; i++)
+            failures += pattern_tool(argv[i]) != 0;
+        closelog();
+        return failures ? 1 : 0;
+    }
+
+    if (precache && !cache_dir) {
+        static char default_cache[600];
+        snprintf(default_cache, sizeof(default_cache), "%s.pcmcache", get_music_dir());
+        cache_dir = default_cache;
+    }
+    if (cache_dir && pcm_cache_set_dir(cache_dir) != 0) {
+        fprintf(stderr, "Cannot use PCM cache dir %s, caching disabled\n", cache_dir);
+        if (precache)
+            return 1;
+    }
+
+    // Precache pass needs neither GPIO nor ALSA
+    if (precache) {
+        printf("Precaching MP3s from %s into %s\n", get_music_dir(), pcm_cache_get_dir());
+        int failures = pcm_cache_precache_dir(get_music_dir());
+        closelog();
+        return failures ? 1 : 0;
+    }
+
     // Pass auto_off setting to player module
     set_auto_off(auto_off);
 
-    printf("Initializing GPIO...\n");
-    gpio_init();
-    gpio_set_outputs(led_lines, 8);
+    printf("Initializing GPIO (%s output)...\n", output_name());
+    if (output_init(led_lines, led_count) != 0) {
+        fprintf(stderr, "Cannot open %s output (try --output sim off the Pi)\n", output_name());
+        closelog();
+        return 1;
+    }
 
     // Handle -s on/off switch mode
     if (switch_mode != NULL) {
         if (strcmp(switch_mode, "on") == 0) {
             printf("Turning all LEDs ON\n");
-            gpio_all_on(led_lines, 8);
+            output_all_on();
         } else if (strcmp(switch_mode, "off") == 0) {
             printf("Turning all LEDs OFF\n");
-            gpio_all_off(led_lines, 8);
+            output_all_off();
         } else {
             fprintf(stderr, "Invalid switch mode: %s (use 'on' or 'off')\n", switch_mode);
-            gpio_cleanup();
+            output_cleanup();
             return 1;
         }
-        gpio_cleanup();
+        output_cleanup();
         closelog();
         return 0;
     }
 
-    gpio_all_off(led_lines, 8);
+    output_all_off();
+
+    // Multi-node sync runs for the whole session, between songs too
+    if ((sync_port >= 0 && netsync_lead(sync_port) != 0) ||
+        (sync_leader && netsync_follow(sync_leader) != 0)) {
+        output_cleanup();
+        return 1;
+    }
 
     // add signal handlers
     if (signal(SIGTTOU, signal_handler) == SIG_ERR) { exit(EXIT_FAILURE); }
@@ -218,7 +571,12 @@ int main(int argc, char *argv[]) {
 
 		} else if (ch == 2) {
 		    char base[MAX_SONG_NAME];
-		    if (receive_udp_song(base, sizeof(base)) == 0) {
+		    int rc = receive_udp_song(base, sizeof(base));
+		    if (rc == 1) {
+			// Armed or seek: the sender picked the start, no prompt
+			printf("UDP start: '%s'\n", base);
+			play_song(base);
+		    } else if (rc == 0) {
 			printf("UDP provided song: '%s'\n", base);
 			printf("Play this song? (y/n): ");
 			fflush(stdout);
@@ -247,10 +605,12 @@ int main(int argc, char *argv[]) {
 
     // Only turn off LEDs if auto_off mode is enabled (-o flag)
     if (auto_off) {
-        gpio_all_off(led_lines, 8);
+        output_all_off();
     }
 
-    gpio_cleanup();
+    player_close_audio();
+    netsync_stop();
+    output_cleanup();
     printf("GPIO cleaned up. Goodbye.\n");
 
     closelog();
@@ -0,0 +1,862 @@
+#include "netsync.h"
+#include "player.h"
+#include "udp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <endian.h>
+#include <syslog.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+#define NETSYNC_MAGIC    0x4C53594EU   // "LSYN"
+#define NETSYNC_VERSION  2
+#define NETSYNC_PRIORITY 60            // Below audio (75) and LED (80)
+#define MODEL_SLOTS      4             // Seqlocked slots, as in avclock.c
+
+enum { MSG_REQUEST = 1, MSG_REPLY = 2 };
+
+// Wire format, big-endian, packed by hand
+typedef struct {
+    uint16_t type;
+    uint32_t seq;
+    int64_t t1, t2, t3;
+    // Leader: current song
+    uint32_t song_seq;
+    int64_t song_start_ns;
+    uint64_t song_length_us;
+    uint64_t song_offset_us;
+    char song[MAX_SONG_NAME];
+    // Follower: its estimate, the song it plays and its last timeline
+    uint32_t playing_seq;
+    int64_t offset_ns, delay_ns, residual_ns;
+    int64_t skew_ppb;
+    uint64_t exchanges, rejected;
+    uint32_t report_seq;
+    uint64_t cues;
+    int64_t led_avg_ns, led_max_ns, audio_avg_ns, audio_max_ns;
+} SyncMsg;
+
+#define SYNC_MSG_BYTES (4 + 2 + 2 + 4 + 3 * 8 + 4 + 3 * 8 + MAX_SONG_NAME + \
+                        4 + 4 * 8 + 2 * 8 + 4 + 8 + 4 * 8)
+
+typedef struct {
+    int64_t ref_ns;
+    int64_t offset_ns;
+    double skew;
+} NetModel;
+
+typedef struct {
+    atomic_uint seq;    // Odd while the sync thread rewrites the slot
+    NetModel m;
+} NetSlot;
+
+static NetSyncRole role = NETSYNC_OFF;
+static int sock = -1;
+static int wake_fd = -1;
+static int bound_port = 0;
+static atomic_int running = 0;
+static pthread_t sync_thread;
+static struct sockaddr_storage leader_addr;
+static socklen_t leader_addr_len;
+
+static NetSlot models[MODEL_SLOTS];
+static unsigned int model_next = 0;
+static _Atomic(NetSlot *) model = NULL;
+
+// Everything below is shared with the sync thread under this lock
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t changed = PTHREAD_COND_INITIALIZER;
+static NetSyncEstimator est;            // Follower
+static int fast_poll = 1;
+// Leader: announced song; follower: last announcement heard
+static uint32_t song_seq;
+static int64_t song_start_ns;
+static uint64_t song_length_us;
+static uint64_t song_offset_us;
+static char song_name[MAX_SONG_NAME];
+static uint32_t playing_seq;            // Follower: song it started
+static NetSyncTimeline own_timeline;
+static NetSyncNode nodes[NETSYNC_MAX_NODES];
+static size_t node_count;
+
+static int64_t mono_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------
+// Estimator
+// --------------------------------------------------------------
+void netsync_estimator_reset(NetSyncEstimator *e) {
+    uint64_t exchanges = e->exchanges, rejected = e->rejected, restarts = e->restarts;
+    memset(e, 0, sizeof(*e));
+    e->exchanges = exchanges;
+    e->rejected = rejected;
+    e->restarts = restarts;
+}
+
+int netsync_estimator_locked(const NetSyncEstimator *e) {
+    return e->valid && e->count >= NETSYNC_MIN_SAMPLES;
+}
+
+int64_t netsync_estimator_leader_ns(const NetSyncEstimator *e, int64_t local_ns) {
+    if (!e->valid)
+        return local_ns;
+    return local_ns + e->offset_ns + (int64_t)llround(e->skew * (double)(local_ns - e->ref_ns));
+}
+
+// Slowest round trip still trusted: the best one plus the slack, or half
+// the best one again on slow links
+static int64_t delay_limit(const NetSyncEstimator *e) {
+    int64_t slack = NETSYNC_SLACK_US * 1000LL;
+    if (e->min_delay_ns / 2 > slack)
+        slack = e->min_delay_ns / 2;
+    return e->min_delay_ns + slack;
+}
+
+// Line through the trusted exchanges; offset alone until there are enough
+static void estimator_fit(NetSyncEstimator *e) {
+    int64_t min_delay = INT64_MAX;
+    for (unsigned int i = 0; i < e->count; i++)
+        if (e->delay[i] < min_delay)
+            min_delay = e->delay[i];
+    e->min_delay_ns = min_delay;
+    int64_t limit = delay_limit(e);
+
+    // Newest sample as the reference keeps the doubles small
+    unsigned int newest = (e->next + NETSYNC_WINDOW - 1) % NETSYNC_WINDOW;
+    int64_t ref = e->t[newest], y0 = e->offset[newest];
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (unsigned int i = 0; i < e->count; i++) {
+        if (e->delay[i] > limit)
+            continue;
+        double x = (e->t[i] - ref) / 1e9;
+        double y = (double)(e->offset[i] - y0);
+        n++;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+
+    double skew = 0, intercept = sy / n;
+    double den = n * sxx - sx * sx;
+    if (e->count >= NETSYNC_MIN_SAMPLES && n >= 2 && den > 1e-9) {
+        skew = (n * sxy - sx * sy) / den / 1e9;
+        if (skew > NETSYNC_MAX_PPM / 1e6) skew = NETSYNC_MAX_PPM / 1e6;
+        if (skew < -NETSYNC_MAX_PPM / 1e6) skew = -NETSYNC_MAX_PPM / 1e6;
+        intercept = (sy - skew * 1e9 * sx) / n;
+    }
+
+    double sq = 0;
+    for (unsigned int i = 0; i < e->count; i++) {
+        if (e->delay[i] > limit)
+            continue;
+        double r = (double)(e->offset[i] - y0) - intercept - skew * (double)(e->t[i] - ref);
+        sq += r * r;
+    }
+
+    e->ref_ns = ref;
+    e->offset_ns = y0 + (int64_t)llround(intercept);
+    e->skew = skew;
+    e->residual_rms_ns = sqrt(sq / n);
+    e->valid = 1;
+}
+
+int netsync_estimator_add(NetSyncEstimator *e, const NetSyncExchange *x) {
+    int64_t delay = (x->t4 - x->t1) - (x->t3 - x->t2);
+    int64_t offset = ((x->t2 - x->t1) + (x->t3 - x->t4)) / 2;
+    int64_t mid = x->t1 + (x->t4 - x->t1) / 2;
+    e->exchanges++;
+
+    if (delay < 0) {
+        e->rejected++;
+        return 0;
+    }
+
+    // A fast exchange far off the line: the leader restarted or its clock
+    // stepped. A few in a row start the fit over.
+    if (netsync_estimator_locked(e) && delay <= delay_limit(e)) {
+        int64_t predicted = netsync_estimator_leader_ns(e, mid) - mid;
+        if (llabs(offset - predicted) > NETSYNC_STEP_US * 1000LL) {
+            if (++e->steps < NETSYNC_STEP_COUNT) {
+                e->rejected++;
+                return 0;
+            }
+            e->restarts++;
+            netsync_estimator_reset(e);
+        }
+    }
+    e->steps = 0;
+
+    e->t[e->next] = mid;
+    e->offset[e->next] = offset;
+    e->delay[e->next] = delay;
+    e->next = (e->next + 1) % NETSYNC_WINDOW;
+    if (e->count < NETSYNC_WINDOW)
+        e->count++;
+    estimator_fit(e);
+
+    int slow = delay > delay_limit(e);
+    if (slow)
+        e->rejected++;
+    return !slow;
+}
+
+// --------------------------------------------------------------
+// Clock mapping (LED and audio threads)
+// --------------------------------------------------------------
+// Fast polling republishes every 20 ms, so a reader preempted mid-copy
+// can find its slot reused: a torn copy is taken again from the newest
+// slot, as in avclock.c
+static void publish(void) {
+    NetSlot *slot = &models[model_next];
+    model_next = (model_next + 1) % MODEL_SLOTS;
+    unsigned int seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->m.ref_ns = est.ref_ns;
+    slot->m.offset_ns = est.offset_ns;
+    slot->m.skew = est.skew;
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&model, slot, memory_order_release);
+}
+
+// A whole copy of the current model; 0 before the first estimate
+static int current_model(NetModel *out) {
+    for (;;) {
+        NetSlot *slot = atomic_load_explicit(&model, memory_order_acquire);
+        if (!slot)
+            return 0;
+        unsigned int seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        NetModel m = slot->m;
+        atomic_thread_fence(memory_order_acquire);
+        if (!(seq & 1) && atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq) {
+            *out = m;
+            return 1;
+        }
+    }
+}
+
+int64_t netsync_leader_ns(int64_t local_ns) {
+    NetModel m;
+    if (!current_model(&m))
+        return local_ns;
+    return local_ns + m.offset_ns + (int64_t)llround(m.skew * (double)(local_ns - m.ref_ns));
+}
+
+int64_t netsync_local_ns(int64_t leader_ns) {
+    NetModel m;
+    if (!current_model(&m))
+        return leader_ns;
+    double d = (double)(leader_ns - m.ref_ns - m.offset_ns);
+    return m.ref_ns + (int64_t)llround(d / (1.0 + m.skew));
+}
+
+// Read one datagram and when it arrived: the kernel's receive stamp,
+// taken before any wake-up latency of the reading thread, moved from
+// CLOCK_REALTIME to CLOCK_MONOTONIC (now, if the kernel gave none)
+static ssize_t recv_stamped(int fd, uint8_t *buf, size_t len, struct sockaddr_storage *from,
+                            socklen_t *from_len, int64_t *arrival_ns) {
+    char control[CMSG_SPACE(sizeof(struct timespec))];
+    struct iovec iov = { .iov_base = buf, .iov_len = len };
+    struct msghdr msg = {
+        .msg_name = from,
+        .msg_namelen = from ? *from_len : 0,
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control,
+        .msg_controllen = sizeof(control),
+    };
+    ssize_t n = recvmsg(fd, &msg, 0);
+
+    struct timespec real, mono;
+    clock_gettime(CLOCK_REALTIME, &real);
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    *arrival_ns = (int64_t)mono.tv_sec * 1000000000LL + mono.tv_nsec;
+    if (from)
+        *from_len = msg.msg_namelen;
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); n > 0 && c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec stamp;
+            memcpy(&stamp, CMSG_DATA(c), sizeof(stamp));
+            *arrival_ns -= (real.tv_sec - stamp.tv_sec) * 1000000000LL +
+                           (real.tv_nsec - stamp.tv_nsec);
+        }
+    }
+    return n;
+}
+
+static void enable_rx_stamps(int fd) {
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one));
+}
+
+// --------------------------------------------------------------
+// Wire format
+// --------------------------------------------------------------
+static uint8_t *put16(uint8_t *p, uint16_t v) { v = htobe16(v); memcpy(p, &v, 2); return p + 2; }
+static uint8_t *put32(uint8_t *p, uint32_t v) { v = htobe32(v); memcpy(p, &v, 4); return p + 4; }
+static uint8_t *put64(uint8_t *p, int64_t v) { uint64_t u = htobe64((uint64_t)v); memcpy(p, &u, 8); return p + 8; }
+static const uint8_t *get16(const uint8_t *p, uint16_t *v) { memcpy(v, p, 2); *v = be16toh(*v); return p + 2; }
+static const uint8_t *get32(const uint8_t *p, uint32_t *v) { memcpy(v, p, 4); *v = be32toh(*v); return p + 4; }
+static const uint8_t *get64(const uint8_t *p, int64_t *v) {
+    uint64_t u;
+    memcpy(&u, p, 8);
+    *v = (int64_t)be64toh(u);
+    return p + 8;
+}
+
+static size_t msg_pack(const SyncMsg *m, uint8_t *buf) {
+    uint8_t *p = put32(buf, NETSYNC_MAGIC);
+    p = put16(p, NETSYNC_VERSION);
+    p = put16(p, m->type);
+    p = put32(p, m->seq);
+    p = put64(p, m->t1);
+    p = put64(p, m->t2);
+    p = put64(p, m->t3);
+    p = put32(p, m->song_seq);
+    p = put64(p, m->song_start_ns);
+    p = put64(p, (int64_t)m->song_length_us);
+    p = put64(p, (int64_t)m->song_offset_us);
+    memcpy(p, m->song, MAX_SONG_NAME);
+    p += MAX_SONG_NAME;
+    p = put32(p, m->playing_seq);
+    p = put64(p, m->offset_ns);
+    p = put64(p, m->delay_ns);
+    p = put64(p, m->residual_ns);
+    p = put64(p, m->skew_ppb);
+    p = put64(p, (int64_t)m->exchanges);
+    p = put64(p, (int64_t)m->rejected);
+    p = put32(p, m->report_seq);
+    p = put64(p, (int64_t)m->cues);
+    p = put64(p, m->led_avg_ns);
+    p = put64(p, m->led_max_ns);
+    p = put64(p, m->audio_avg_ns);
+    p = put64(p, m->audio_max_ns);
+    return (size_t)(p - buf);
+}
+
+static int msg_unpack(const uint8_t *buf, size_t len, SyncMsg *m) {
+    uint32_t magic;
+    uint16_t version;
+    int64_t v;
+    if (len != SYNC_MSG_BYTES)
+        return -1;
+    const uint8_t *p = get32(buf, &magic);
+    p = get16(p, &version);
+    if (magic != NETSYNC_MAGIC || version != NETSYNC_VERSION)
+        return -1;
+    p = get16(p, &m->type);
+    p = get32(p, &m->seq);
+    p = get64(p, &m->t1);
+    p = get64(p, &m->t2);
+    p = get64(p, &m->t3);
+    p = get32(p, &m->song_seq);
+    p = get64(p, &m->song_start_ns);
+    p = get64(p, &v); m->song_length_us = (uint64_t)v;
+    p = get64(p, &v); m->song_offset_us = (uint64_t)v;
+    memcpy(m->song, p, MAX_SONG_NAME);
+    m->song[MAX_SONG_NAME - 1] = '\0';
+    p += MAX_SONG_NAME;
+    p = get32(p, &m->playing_seq);
+    p = get64(p, &m->offset_ns);
+    p = get64(p, &m->delay_ns);
+    p = get64(p, &m->residual_ns);
+    p = get64(p, &m->skew_ppb);
+    p = get64(p, &v); m->exchanges = (uint64_t)v;
+    p = get64(p, &v); m->rejected = (uint64_t)v;
+    p = get32(p, &m->report_seq);
+    p = get64(p, &v); m->cues = (uint64_t)v;
+    p = get64(p, &m->led_avg_ns);
+    p = get64(p, &m->led_max_ns);
+    p = get64(p, &m->audio_avg_ns);
+    get64(p, &m->audio_max_ns);
+    return 0;
+}
+
+// --------------------------------------------------------------
+// Leader: answer exchanges, keep the node table
+// --------------------------------------------------------------
+static void note_node(const struct sockaddr_storage *from, const SyncMsg *m) {
+    char host[INET6_ADDRSTRLEN] = "?", addr[48];
+    int port = 0;
+    if (from->ss_family == AF_INET) {
+        const struct sockaddr_in *in = (const struct sockaddr_in *)from;
+        inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+        port = ntohs(in->sin_port);
+    } else if (from->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *)from;
+        inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+        port = ntohs(in6->sin6_port);
+    }
+    snprintf(addr, sizeof(addr), "%s:%d", host, port);
+
+    NetSyncNode *n = NULL;
+    for (size_t i = 0; i < node_count; i++)
+        if (strcmp(nodes[i].addr, addr) == 0)
+            n = &nodes[i];
+    if (!n) {
+        if (node_count == NETSYNC_MAX_NODES)
+            return;
+        n = &nodes[node_count++];
+        memset(n, 0, sizeof(*n));
+        snprintf(n->addr, sizeof(n->addr), "%s", addr);
+    }
+    n->offset_us = m->offset_ns / 1000.0;
+    n->skew_ppm = m->skew_ppb / 1000.0;
+    n->delay_us = m->delay_ns / 1000.0;
+    n->residual_us = m->residual_ns / 1000.0;
+    n->exchanges = m->exchanges;
+    n->rejected = m->rejected;
+    n->playing_seq = m->playing_seq;
+    if (m->report_seq != 0) {
+        n->timeline.song_seq = m->report_seq;
+        n->timeline.cues = m->cues;
+        n->timeline.led_avg_us = m->led_avg_ns / 1000.0;
+        n->timeline.led_max_us = m->led_max_ns / 1000.0;
+        n->timeline.audio_avg_us = m->audio_avg_ns / 1000.0;
+        n->timeline.audio_max_us = m->audio_max_ns / 1000.0;
+    }
+}
+
+static void *leader_thread_fn(void *arg) {
+    (void)arg;
+    uint8_t buf[SYNC_MSG_BYTES + 64];
+    struct pollfd pfds[2] = {
+        { .fd = sock, .events = POLLIN },
+        { .fd = wake_fd, .events = POLLIN },
+    };
+
+    while (atomic_load(&running)) {
+        if (poll(pfds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (pfds[1].revents & POLLIN)
+            continue;   // Stop kick; running says whether to go on
+        if (!(pfds[0].revents & POLLIN))
+            continue;
+
+        struct sockaddr_storage from;
+        socklen_t from_len = sizeof(from);
+        int64_t t2;
+        ssize_t n = recv_stamped(sock, buf, sizeof(buf), &from, &from_len, &t2);
+        SyncMsg m;
+        if (n <= 0 || msg_unpack(buf, (size_t)n, &m) != 0 || m.type != MSG_REQUEST)
+            continue;
+
+        pthread_mutex_lock(&lock);
+        note_node(&from, &m);
+        SyncMsg r = {0};
+        r.type = MSG_REPLY;
+        r.seq = m.seq;
+        r.t1 = m.t1;
+        r.t2 = t2;
+        r.song_seq = song_seq;
+        r.song_start_ns = song_start_ns;
+        r.song_length_us = song_length_us;
+        r.song_offset_us = song_offset_us;
+        memcpy(r.song, song_name, MAX_SONG_NAME);
+        pthread_cond_broadcast(&changed);
+        pthread_mutex_unlock(&lock);
+
+        r.t3 = mono_ns();
+        size_t len = msg_pack(&r, buf);
+        sendto(sock, buf, len, 0, (struct sockaddr *)&from, from_len);
+    }
+    return NULL;
+}
+
+// --------------------------------------------------------------
+// Follower: one exchange per poll interval
+// --------------------------------------------------------------
+static int64_t mono_clock(void *ctx, int64_t mono) {
+    (void)ctx;
+    return mono;
+}
+
+// Send q, wait for its reply; replies to older requests are dropped.
+// 0 with r and x filled, -1 on timeout.
+static int exchange(int fd, const struct sockaddr *to, socklen_t to_len, SyncMsg *q,
+                    SyncMsg *r, NetSyncClock clock, void *ctx, NetSyncExchange *x) {
+    uint8_t buf[SYNC_MSG_BYTES + 64];
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+    q->type = MSG_REQUEST;
+    q->t1 = clock(ctx, mono_ns());
+    size_t len = msg_pack(q, buf);
+    if (sendto(fd, buf, len, 0, to, to_len) < 0)
+        return -1;
+
+    int64_t give_up = mono_ns() + NETSYNC_TIMEOUT_MS * 1000000LL;
+    for (;;) {
+        int64_t now = mono_ns();
+        if (now >= give_up)
+            return -1;
+        if (poll(&pfd, 1, (int)((give_up - now) / 1000000) + 1) <= 0)
+            continue;
+        int64_t arrival;
+        ssize_t n = recv_stamped(fd, buf, sizeof(buf), NULL, NULL, &arrival);
+        int64_t t4 = clock(ctx, arrival);
+        if (n <= 0 || msg_unpack(buf, (size_t)n, r) != 0 ||
+            r->type != MSG_REPLY || r->seq != q->seq)
+            continue;
+        *x = (NetSyncExchange){ q->t1, r->t2, r->t3, t4 };
+        return 0;
+    }
+}
+
+int netsync_exchange(int fd, NetSyncClock clock, void *ctx, NetSyncExchange *x) {
+    static _Atomic uint32_t seq = 0;
+    SyncMsg q = {0}, r;
+    q.seq = atomic_fetch_add(&seq, 1) + 1;
+    enable_rx_stamps(fd);
+    return exchange(fd, NULL, 0, &q, &r, clock ? clock : mono_clock, ctx, x);
+}
+
+static void *follower_thread_fn(void *arg) {
+    (void)arg;
+    uint32_t seq = 0;
+    struct pollfd wake = { .fd = wake_fd, .events = POLLIN };
+
+    while (atomic_load(&running)) {
+        SyncMsg q = {0};
+        q.type = MSG_REQUEST;
+        q.seq = ++seq;
+        pthread_mutex_lock(&lock);
+        q.playing_seq = playing_seq;
+        q.offset_ns = est.offset_ns;
+        q.skew_ppb = (int64_t)llround(est.skew * 1e9);
+        q.delay_ns = est.min_delay_ns;
+        q.residual_ns = (int64_t)llround(est.residual_rms_ns);
+        q.exchanges = est.exchanges;
+        q.rejected = est.rejected;
+        q.report_seq = own_timeline.song_seq;
+        q.cues = own_timeline.cues;
+        q.led_avg_ns = (int64_t)llround(own_timeline.led_avg_us * 1000.0);
+        q.led_max_ns = (int64_t)llround(own_timeline.led_max_us * 1000.0);
+        q.audio_avg_ns = (int64_t)llround(own_timeline.audio_avg_us * 1000.0);
+        q.audio_max_ns = (int64_t)llround(own_timeline.audio_max_us * 1000.0);
+        int interval = fast_poll || !netsync_estimator_locked(&est) ?
+            NETSYNC_FAST_POLL_MS : NETSYNC_POLL_MS;
+        pthread_mutex_unlock(&lock);
+
+        SyncMsg r;
+        NetSyncExchange x;
+        if (exchange(sock, (struct sockaddr *)&leader_addr, leader_addr_len,
+                     &q, &r, mono_clock, NULL, &x) == 0) {
+            pthread_mutex_lock(&lock);
+            netsync_estimator_add(&est, &x);
+            publish();
+            song_seq = r.song_seq;
+            song_start_ns = r.song_start_ns;
+            song_length_us = r.song_length_us;
+            song_offset_us = r.song_offset_us;
+            memcpy(song_name, r.song, MAX_SONG_NAME);
+            pthread_cond_broadcast(&changed);
+            pthread_mutex_unlock(&lock);
+        }
+
+        // Sleep out the interval; netsync_song_end() kicks an early report
+        if (poll(&wake, 1, interval) > 0) {
+            uint64_t kicks;
+            ssize_t ignored = read(wake_fd, &kicks, sizeof(kicks));
+            (void)ignored;
+        }
+    }
+    return NULL;
+}
+
+// --------------------------------------------------------------
+// Setup
+// --------------------------------------------------------------
+static int start_thread(void *(*fn)(void *)) {
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        perror("eventfd");
+        return -1;
+    }
+
+    atomic_store(&running, 1);
+    pthread_attr_t attr;
+    struct sched_param param = { .sched_priority = NETSYNC_PRIORITY };
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    pthread_attr_setschedparam(&attr, &param);
+    if (pthread_create(&sync_thread, &attr, fn, NULL) != 0 &&
+        pthread_create(&sync_thread, NULL, fn, NULL) != 0) {
+        fprintf(stderr, "Cannot start the sync thread\n");
+        atomic_store(&running, 0);
+        close(wake_fd);
+        wake_fd = -1;
+        return -1;
+    }
+    pthread_attr_destroy(&attr);
+    return 0;
+}
+
+int netsync_lead(int port) {
+    sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) { perror("socket"); return -1; }
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = INADDR_ANY;
+    socklen_t len = sizeof(addr);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        getsockname(sock, (struct sockaddr *)&addr, &len) < 0) {
+        perror("bind");
+        close(sock);
+        sock = -1;
+        return -1;
+    }
+    bound_port = ntohs(addr.sin_port);
+    enable_rx_stamps(sock);
+
+    role = NETSYNC_LEADER;
+    if (start_thread(leader_thread_fn) != 0) {
+        close(sock);
+        sock = -1;
+        role = NETSYNC_OFF;
+        return -1;
+    }
+    printf("Sync leader on UDP port %d\n", bound_port);
+    return 0;
+}
+
+int netsync_follow(const char *leader) {
+    char host[256], port[16];
+    snprintf(port, sizeof(port), "%d", NETSYNC_PORT);
+    snprintf(host, sizeof(host), "%s", leader);
+    char *colon = strrchr(host, ':');
+    if (colon && strchr(host, ':') == colon) {   // One colon: host:port, not IPv6
+        *colon = '\0';
+        snprintf(port, sizeof(port), "%s", colon + 1);
+    }
+
+    struct addrinfo hints = {0}, *res;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    int rc = getaddrinfo(host, port, &hints, &res);
+    if (rc != 0) {
+        fprintf(stderr, "Sync leader %s: %s\n", leader, gai_strerror(rc));
+        return -1;
+    }
+    sock = socket(res->ai_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        perror("socket");
+        freeaddrinfo(res);
+        return -1;
+    }
+    memcpy(&leader_addr, res->ai_addr, res->ai_addrlen);
+    leader_addr_len = res->ai_addrlen;
+    enable_rx_stamps(sock);
+    freeaddrinfo(res);
+
+    netsync_estimator_reset(&est);
+    fast_poll = 1;
+    role = NETSYNC_FOLLOWER;
+    if (start_thread(follower_thread_fn) != 0) {
+        close(sock);
+        sock = -1;
+        role = NETSYNC_OFF;
+        return -1;
+    }
+    printf("Following sync leader %s:%s\n", host, port);
+    return 0;
+}
+
+void netsync_stop(void) {
+    if (role == NETSYNC_OFF)
+        return;
+    atomic_store(&running, 0);
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd, &one, sizeof(one));
+    (void)ignored;
+    pthread_join(sync_thread, NULL);
+    close(wake_fd);
+    close(sock);
+    wake_fd = sock = -1;
+    atomic_store(&model, NULL);
+    role = NETSYNC_OFF;
+}
+
+NetSyncRole netsync_role(void) {
+    return role;
+}
+
+int netsync_port(void) {
+    return bound_port;
+}
+
+// --------------------------------------------------------------
+// Songs
+// --------------------------------------------------------------
+static int wait_changed(int64_t until_ns) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    // Short slices: the condvar runs on CLOCK_REALTIME, and stop has no signal
+    int64_t left = until_ns - mono_ns();
+    if (left <= 0)
+        return -1;
+    if (left > 50000000)
+        left = 50000000;
+    now.tv_nsec += left;
+    if (now.tv_nsec >= 1000000000L) {
+        now.tv_sec++;
+        now.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&changed, &lock, &now);
+    return 0;
+}
+
+int netsync_song_start(const char *song, uint64_t length_us, uint64_t *offset_us,
+                       int64_t *start_ns) {
+    if (role == NETSYNC_OFF)
+        return -1;
+
+    pthread_mutex_lock(&lock);
+    memset(&own_timeline, 0, sizeof(own_timeline));
+    if (role == NETSYNC_LEADER) {
+        song_seq++;
+        int64_t soonest = mono_ns() + NETSYNC_START_LEAD_MS * 1000000LL;
+        song_start_ns = *start_ns > soonest ? *start_ns : soonest;
+        song_length_us = length_us;
+        song_offset_us = *offset_us;
+        snprintf(song_name, sizeof(song_name), "%s", song);
+        *start_ns = song_start_ns;
+        own_timeline.song_seq = song_seq;
+        pthread_mutex_unlock(&lock);
+        return 0;
+    }
+
+    // Follower: the leader's announcement of this song, not yet over and
+    // not the one we just played, once the offset is filtered and the skew
+    // fitted (one raw exchange carries its whole path asymmetry)
+    int rc = -1;
+    int64_t give_up = mono_ns() + NETSYNC_WAIT_MS * 1000000LL;
+    fast_poll = 1;
+    while (!stop_requested) {
+        if (netsync_estimator_locked(&est) && song_seq != 0 && song_seq != playing_seq &&
+            strcmp(song_name, song) == 0 &&
+            song_offset_us < song_length_us &&
+            netsync_leader_ns(mono_ns()) < song_start_ns +
+                (int64_t)(song_length_us - song_offset_us) * 1000) {
+            playing_seq = song_seq;
+            own_timeline.song_seq = song_seq;
+            *offset_us = song_offset_us;
+            *start_ns = song_start_ns;
+            rc = 0;
+            break;
+        }
+        if (wait_changed(give_up) != 0)
+            break;
+    }
+    fast_poll = 0;
+    pthread_mutex_unlock(&lock);
+    return rc;
+}
+
+static void print_nodes(void) {
+    const NetSyncTimeline *lead = &own_timeline;
+    printf("Sync nodes (song %u):\n", lead->song_seq);
+    printf("  %-24s %12s %10s %9s %20s %16s %10s\n", "node", "offset ms", "skew ppm",
+           "rtt us", "LED avg/max us", "audio avg/max us", "vs leader");
+    printf("  %-24s %12s %10s %9s %+9.1f /%9.1f %7.1f /%7.1f %10s\n", "leader", "-", "-", "-",
+           lead->led_avg_us, lead->led_max_us, lead->audio_avg_us, lead->audio_max_us, "-");
+
+    double worst = 0;
+    for (size_t i = 0; i < node_count; i++) {
+        const NetSyncNode *n = &nodes[i];
+        if (n->playing_seq != lead->song_seq)
+            continue;
+        if (n->timeline.song_seq != lead->song_seq) {
+            printf("  %-24s %+12.3f %+10.2f %9.1f %20s\n", n->addr, n->offset_us / 1000.0,
+                   n->skew_ppm, n->delay_us, "no report");
+            continue;
+        }
+        double skew = n->timeline.led_avg_us - lead->led_avg_us;
+        if (fabs(skew) > worst)
+            worst = fabs(skew);
+        printf("  %-24s %+12.3f %+10.2f %9.1f %+9.1f /%9.1f %7.1f /%7.1f %+10.1f\n",
+               n->addr, n->offset_us / 1000.0, n->skew_ppm, n->delay_us,
+               n->timeline.led_avg_us, n->timeline.led_max_us,
+               n->timeline.audio_avg_us, n->timeline.audio_max_us, skew);
+    }
+    printf("Inter-node skew: %.1f us (largest LED average vs the leader)\n", worst);
+}
+
+void netsync_song_end(const NetSyncTimeline *own) {
+    if (role == NETSYNC_OFF)
+        return;
+
+    pthread_mutex_lock(&lock);
+    uint32_t seq = own_timeline.song_seq;
+    own_timeline = *own;
+    own_timeline.song_seq = seq;
+
+    if (role == NETSYNC_FOLLOWER) {
+        NetSyncEstimator e = est;
+        pthread_mutex_unlock(&lock);
+        uint64_t one = 1;
+        ssize_t ignored = write(wake_fd, &one, sizeof(one));
+        (void)ignored;
+        printf("Sync: offset %+.3f ms, skew %+.2f ppm, rtt %.1f us, residual %.1f us (%llu/%llu exchanges used)\n",
+               e.offset_ns / 1e6, e.skew * 1e6, e.min_delay_ns / 1000.0,
+               e.residual_rms_ns / 1000.0,
+               (unsigned long long)(e.exchanges - e.rejected),
+               (unsigned long long)e.exchanges);
+        return;
+    }
+
+    // Leader: every follower that started this song reports once it ends
+    int64_t give_up = mono_ns() + NETSYNC_REPORT_WAIT_MS * 1000000LL;
+    for (;;) {
+        int missing = 0;
+        for (size_t i = 0; i < node_count; i++)
+            if (nodes[i].playing_seq == seq && nodes[i].timeline.song_seq != seq)
+                missing++;
+        if (!missing || wait_changed(give_up) != 0)
+            break;
+    }
+    print_nodes();
+    pthread_mutex_unlock(&lock);
+}
+
+void netsync_get_stats(NetSyncStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->role = role;
+    pthread_mutex_lock(&lock);
+    stats->timeline = own_timeline;
+    if (role == NETSYNC_FOLLOWER) {
+        stats->locked = netsync_estimator_locked(&est);
+        stats->offset_us = est.offset_ns / 1000.0;
+        stats->skew_ppm = est.skew * 1e6;
+        stats->delay_us = est.min_delay_ns / 1000.0;
+        stats->residual_us = est.residual_rms_ns / 1000.0;
+        stats->exchanges = est.exchanges;
+        stats->rejected = est.rejected;
+        stats->restarts = est.restarts;
+    } else if (role == NETSYNC_LEADER) {
+        stats->locked = 1;
+        memcpy(stats->nodes, nodes, node_count * sizeof(nodes[0]));
+        stats->node_count = node_count;
+    }
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,346 @@
+#include "output.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/gpio.h>
+
+#define SIM_PAGE_SIZE 4096
+
+int output_bank1 = 0;
+
+static const char *output_arg = NULL;   // Backend argument after "name:"
+static int output_open = 0;
+
+// Lock-free atomics: the signal handler's all-off counts too
+static atomic_ullong failures = 0;
+static atomic_int failure_errno = 0;
+
+static void note_failure(int err) {
+    int none = 0;
+    atomic_fetch_add_explicit(&failures, 1, memory_order_relaxed);
+    atomic_compare_exchange_strong(&failure_errno, &none, err);
+}
+
+// --------------------------------------------------------------
+// mmap: the BCM registers (gpio.c)
+// --------------------------------------------------------------
+// mmap and sim share the register layout
+static void regs_read_levels(uint32_t level[2]) {
+    level[0] = gpio[GPLEV0_REG];
+    level[1] = gpio[GPLEV1_REG];
+}
+
+static int mmap_init(const char *arg, const unsigned int *lines, int count) {
+    if (gpio_init() != 0)
+        return -1;
+    gpio_set_outputs(lines, count);
+    return 0;
+}
+
+const OutputBackend output_mmap = {
+    .name = "mmap",
+    .mmio = 1,
+    .init = mmap_init,
+    .commit_frame = NULL,   // Inlined by output_commit()
+    .all_off = gpio_all_off,
+    .cleanup = gpio_cleanup,
+    .read_levels = regs_read_levels,
+};
+
+// --------------------------------------------------------------
+// sim: register-layout page in RAM, commits timestamped
+// --------------------------------------------------------------
+static volatile uint32_t *sim_page = NULL;
+static OutputCommit *sim_log = NULL;
+static size_t sim_logged = 0;
+static uint64_t sim_total = 0;
+
+static int sim_init(const char *arg, const unsigned int *lines, int count) {
+    void *page;
+    if (arg && *arg) {
+        // tmpfs file: another process can mmap it and watch GPLEV
+        int fd = open(arg, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0 || ftruncate(fd, SIM_PAGE_SIZE) != 0) {
+            perror(arg);
+            if (fd >= 0)
+                close(fd);
+            return -1;
+        }
+        page = mmap(NULL, SIM_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+    } else {
+        page = mmap(NULL, SIM_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (page == MAP_FAILED) {
+        perror("mmap simulated GPIO");
+        return -1;
+    }
+
+    // Locked like the real mapping: commits never fault
+    sim_log = calloc(OUTPUT_SIM_LOG_MAX, sizeof(OutputCommit));
+    if (!sim_log) {
+        munmap(page, SIM_PAGE_SIZE);
+        return -1;
+    }
+    mlock(sim_log, OUTPUT_SIM_LOG_MAX * sizeof(OutputCommit));
+    mlock(page, SIM_PAGE_SIZE);
+
+    sim_page = page;
+    gpio = sim_page;   // Pin setup and readback use the same layout
+    gpio_set_outputs(lines, count);
+    output_sim_reset();
+    return 0;
+}
+
+static int sim_commit_frame(const uint32_t set[2], const uint32_t clr[2]) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    sim_page[GPSET0_REG] = set[0];
+    sim_page[GPSET1_REG] = set[1];
+    sim_page[GPCLR0_REG] = clr[0];
+    sim_page[GPCLR1_REG] = clr[1];
+    uint32_t lev0 = (sim_page[GPLEV0_REG] | set[0]) & ~clr[0];
+    uint32_t lev1 = (sim_page[GPLEV1_REG] | set[1]) & ~clr[1];
+    sim_page[GPLEV0_REG] = lev0;
+    sim_page[GPLEV1_REG] = lev1;
+
+    if (sim_logged < OUTPUT_SIM_LOG_MAX) {
+        OutputCommit *c = &sim_log[sim_logged++];
+        c->t_ns = (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+        c->set[0] = set[0];
+        c->set[1] = set[1];
+        c->clr[0] = clr[0];
+        c->clr[1] = clr[1];
+        c->level[0] = lev0;
+        c->level[1] = lev1;
+    }
+    sim_total++;
+    return 0;
+}
+
+// Also the signal handler's path, which may interrupt a commit on the
+// LED thread: registers only, the log stays the LED thread's
+static void sim_all_off(const unsigned int *lines, int count) {
+    uint64_t mask = gpio_pins_mask(lines, count);
+    sim_page[GPSET0_REG] = 0;
+    sim_page[GPSET1_REG] = 0;
+    sim_page[GPCLR0_REG] = (uint32_t)mask;
+    sim_page[GPCLR1_REG] = (uint32_t)(mask >> 32);
+    sim_page[GPLEV0_REG] &= ~(uint32_t)mask;
+    sim_page[GPLEV1_REG] &= ~(uint32_t)(mask >> 32);
+}
+
+static void sim_cleanup(void) {
+    munmap((void *)sim_page, SIM_PAGE_SIZE);
+    free(sim_log);
+    sim_page = NULL;
+    sim_log = NULL;
+    gpio = NULL;
+}
+
+const OutputBackend output_sim = {
+    .name = "sim",
+    .mmio = 0,
+    .init = sim_init,
+    .commit_frame = sim_commit_frame,
+    .all_off = sim_all_off,
+    .cleanup = sim_cleanup,
+    .read_levels = regs_read_levels,
+};
+
+void output_sim_reset(void) {
+    sim_logged = 0;
+    sim_total = 0;
+}
+
+size_t output_sim_log(const OutputCommit **log, uint64_t *total) {
+    if (log)
+        *log = sim_log;
+    if (total)
+        *total = sim_total;
+    return sim_log ? sim_logged : 0;
+}
+
+// --------------------------------------------------------------
+// cdev: GPIO character device, v2 uAPI
+// --------------------------------------------------------------
+static int cdev_fd = -1;          // Line request holding every channel
+static int cdev_count = 0;
+static unsigned int cdev_pins[LED_MAX_CHANNELS];   // Request index -> BCM pin
+
+static int cdev_init(const char *arg, const unsigned int *lines, int count) {
+    const char *chip = (arg && *arg) ? arg : OUTPUT_GPIOCHIP_DEFAULT;
+    int fd = open(chip, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        perror(chip);
+        return -1;
+    }
+
+    // Line offsets are BCM numbers on the Pi's GPIO chip
+    struct gpio_v2_line_request req;
+    memset(&req, 0, sizeof(req));
+    for (int i = 0; i < count; i++)
+        req.offsets[i] = lines[i];
+    req.num_lines = (uint32_t)count;
+    req.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+    snprintf(req.consumer, sizeof(req.consumer), "sequencer");
+
+    int rc = ioctl(fd, GPIO_V2_GET_LINE_IOCTL, &req);
+    close(fd);
+    if (rc < 0) {
+        perror("GPIO_V2_GET_LINE_IOCTL");
+        return -1;
+    }
+    cdev_fd = req.fd;
+    cdev_count = count;
+    memcpy(cdev_pins, lines, count * sizeof(lines[0]));
+    return 0;
+}
+
+// BCM set/clear words -> request bits; one ioctl updates every line
+static int cdev_commit_frame(const uint32_t set[2], const uint32_t clr[2]) {
+    uint64_t set64 = (uint64_t)set[1] << 32 | set[0];
+    uint64_t touch = set64 | ((uint64_t)clr[1] << 32 | clr[0]);
+    struct gpio_v2_line_values v = { 0, 0 };
+    for (int i = 0; i < cdev_count; i++) {
+        v.bits |= ((set64 >> cdev_pins[i]) & 1) << i;
+        v.mask |= ((touch >> cdev_pins[i]) & 1) << i;
+    }
+    if (v.mask && ioctl(cdev_fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &v) < 0) {
+        note_failure(errno);
+        return -1;
+    }
+    return 0;
+}
+
+// No stdio here (signal handler): output_cleanup() reports a failure
+static void cdev_all_off(const unsigned int *lines, int count) {
+    struct gpio_v2_line_values v = { 0, 0 };
+    v.mask = cdev_count < 64 ? (1ull << cdev_count) - 1 : ~0ull;
+    int saved = errno;
+    if (ioctl(cdev_fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &v) < 0)
+        note_failure(errno);
+    errno = saved;
+}
+
+static void cdev_read_levels(uint32_t level[2]) {
+    struct gpio_v2_line_values v = { 0, 0 };
+    v.mask = cdev_count < 64 ? (1ull << cdev_count) - 1 : ~0ull;
+    uint64_t pins = 0;
+    if (ioctl(cdev_fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &v) == 0) {
+        for (int i = 0; i < cdev_count; i++)
+            pins |= ((v.bits >> i) & 1) << cdev_pins[i];
+    }
+    level[0] = (uint32_t)pins;
+    level[1] = (uint32_t)(pins >> 32);
+}
+
+static void cdev_cleanup(void) {
+    // Closing the request releases the lines (they keep their level)
+    close(cdev_fd);
+    cdev_fd = -1;
+    cdev_count = 0;
+}
+
+const OutputBackend output_cdev = {
+    .name = "cdev",
+    .mmio = 0,
+    .init = cdev_init,
+    .commit_frame = cdev_commit_frame,
+    .all_off = cdev_all_off,
+    .cleanup = cdev_cleanup,
+    .read_levels = cdev_read_levels,
+};
+
+// --------------------------------------------------------------
+// Selection
+// --------------------------------------------------------------
+static const OutputBackend *const backends[] = { &output_mmap, &output_sim, &output_cdev };
+
+const OutputBackend *output = &output_mmap;
+
+int output_select(const char *spec) {
+    const char *colon = strchr(spec, ':');
+    size_t len = colon ? (size_t)(colon - spec) : strlen(spec);
+
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        if (strlen(backends[i]->name) == len && strncmp(backends[i]->name, spec, len) == 0) {
+            output = backends[i];
+            output_arg = colon ? colon + 1 : NULL;
+            return 0;
+        }
+    }
+    fprintf(stderr, "Unknown output backend: %s (use mmap, sim[:file] or cdev[:chip])\n", spec);
+    return -1;
+}
+
+const char *output_name(void) {
+    return output->name;
+}
+
+int output_init(const unsigned int *lines, int count) {
+    output_bank1 = (gpio_pins_mask(lines, count) >> 32) != 0;
+    if (output->init(output_arg, lines, count) != 0)
+        return -1;
+    output_open = 1;
+    return 0;
+}
+
+void output_cleanup(void) {
+    if (!output_open)
+        return;
+    int err;
+    uint64_t failed = output_failures(&err);
+    if (failed)
+        fprintf(stderr, "%s output: %llu updates failed (first: %s)\n", output->name,
+                (unsigned long long)failed, strerror(err));
+    output->cleanup();
+    output_open = 0;
+}
+
+int output_ready(void) {
+    return output_open;
+}
+
+uint64_t output_failures(int *first_errno) {
+    if (first_errno)
+        *first_errno = atomic_load(&failure_errno);
+    return atomic_load(&failures);
+}
+
+void output_failures_reset(void) {
+    atomic_store(&failures, 0);
+    atomic_store(&failure_errno, 0);
+}
+
+void output_read_levels(uint32_t level[2]) {
+    if (output_open) {
+        output->read_levels(level);
+    } else {
+        level[0] = level[1] = 0;
+    }
+}
+
+void output_all_off(void) {
+    if (output_open)
+        output->all_off(led_lines, led_count);
+}
+
+void output_all_on(void) {
+    if (!output_open)
+        return;
+    uint64_t mask = gpio_pins_mask(led_lines, led_count);
+    const uint32_t set[2] = { (uint32_t)mask, (uint32_t)(mask >> 32) };
+    const uint32_t clr[2] = { 0, 0 };
+    output_commit(set, clr);
+}
@@ -0,0 +1,242 @@
+#include "pcm_cache.h"
+#include "audio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define CACHE_PATH_MAX 512
+
+struct PcmCacheWriter {
+    FILE *f;
+    char tmp_path[CACHE_PATH_MAX];
+    char final_path[CACHE_PATH_MAX];
+    uint32_t sample_rate;
+    uint16_t channels;
+    uint64_t data_bytes;
+};
+
+#pragma pack(push, 1)
+typedef struct {
+    char     riff_id[4];
+    uint32_t riff_size;
+    char     wave_id[4];
+    char     fmt_id[4];
+    uint32_t fmt_size;
+    uint16_t audio_format;
+    uint16_t num_channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+    char     data_id[4];
+    uint32_t data_size;
+} CacheWavHeader;
+#pragma pack(pop)
+
+static char cache_dir[CACHE_PATH_MAX] = "";
+
+int pcm_cache_set_dir(const char *dir) {
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        perror("mkdir PCM cache");
+        return -1;
+    }
+
+    int n = snprintf(cache_dir, sizeof(cache_dir), "%s%s", dir,
+                     dir[0] && dir[strlen(dir) - 1] == '/' ? "" : "/");
+    if (n < 0 || (size_t)n >= sizeof(cache_dir)) {
+        cache_dir[0] = '\0';
+        return -1;
+    }
+    return 0;
+}
+
+const char *pcm_cache_get_dir(void) {
+    return cache_dir[0] ? cache_dir : NULL;
+}
+
+// FNV-1a, 64-bit
+static uint64_t fnv1a(uint64_t h, const void *data, size_t len) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static int cache_path(const char *mp3_path, const char *ext_out, char *out, size_t len) {
+    if (!cache_dir[0])
+        return -1;
+
+    struct stat st;
+    if (stat(mp3_path, &st) != 0)
+        return -1;
+
+    uint64_t size = (uint64_t)st.st_size;
+    int64_t mtime = (int64_t)st.st_mtime;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    h = fnv1a(h, mp3_path, strlen(mp3_path));
+    h = fnv1a(h, &size, sizeof(size));
+    h = fnv1a(h, &mtime, sizeof(mtime));
+
+    // Keep the song name readable: "<base>-<hash>.wav"
+    const char *base = strrchr(mp3_path, '/');
+    base = base ? base + 1 : mp3_path;
+    const char *ext = strrchr(base, '.');
+    int base_len = ext ? (int)(ext - base) : (int)strlen(base);
+
+    int n = snprintf(out, len, "%s%.*s-%016llx%s", cache_dir, base_len, base,
+                     (unsigned long long)h, ext_out);
+    return (n < 0 || (size_t)n >= len) ? -1 : 0;
+}
+
+int pcm_cache_lookup(const char *mp3_path, char *out, size_t len) {
+    if (cache_path(mp3_path, ".wav", out, len) != 0)
+        return -1;
+    return access(out, R_OK) == 0 ? 0 : -1;
+}
+
+int pcm_cache_index_path(const char *mp3_path, char *out, size_t len) {
+    return cache_path(mp3_path, ".idx", out, len);
+}
+
+static void fill_header(CacheWavHeader *h, uint32_t rate, uint16_t channels,
+                        uint32_t data_bytes) {
+    memcpy(h->riff_id, "RIFF", 4);
+    h->riff_size = 36 + data_bytes;
+    memcpy(h->wave_id, "WAVE", 4);
+    memcpy(h->fmt_id, "fmt ", 4);
+    h->fmt_size = 16;
+    h->audio_format = 1;
+    h->num_channels = channels;
+    h->sample_rate = rate;
+    h->byte_rate = rate * channels * 2;
+    h->block_align = channels * 2;
+    h->bits_per_sample = 16;
+    memcpy(h->data_id, "data", 4);
+    h->data_size = data_bytes;
+}
+
+PcmCacheWriter *pcm_cache_begin(const char *mp3_path, uint32_t sample_rate,
+                                uint16_t channels) {
+    PcmCacheWriter *w = calloc(1, sizeof(PcmCacheWriter));
+    if (!w)
+        return NULL;
+
+    if (cache_path(mp3_path, ".wav", w->final_path, sizeof(w->final_path)) != 0) {
+        free(w);
+        return NULL;
+    }
+    int n = snprintf(w->tmp_path, sizeof(w->tmp_path), "%s.tmp.%d",
+                     w->final_path, (int)getpid());
+    if (n < 0 || (size_t)n >= sizeof(w->tmp_path)) {
+        free(w);
+        return NULL;
+    }
+
+    w->f = fopen(w->tmp_path, "wb");
+    if (!w->f) {
+        perror("PCM cache fopen");
+        free(w);
+        return NULL;
+    }
+
+    w->sample_rate = sample_rate;
+    w->channels = channels;
+
+    // Placeholder header, sizes are patched in on commit
+    CacheWavHeader h;
+    fill_header(&h, sample_rate, channels, 0);
+    if (fwrite(&h, sizeof(h), 1, w->f) != 1) {
+        pcm_cache_abort(w);
+        return NULL;
+    }
+    return w;
+}
+
+int pcm_cache_write(PcmCacheWriter *w, const int16_t *samples, size_t count) {
+    if (fwrite(samples, sizeof(int16_t), count, w->f) != count)
+        return -1;
+    w->data_bytes += count * sizeof(int16_t);
+    return 0;
+}
+
+int pcm_cache_commit(PcmCacheWriter *w) {
+    if (w->data_bytes > UINT32_MAX - 36) {
+        fprintf(stderr, "PCM cache: decoded audio exceeds WAV size limit\n");
+        pcm_cache_abort(w);
+        return -1;
+    }
+
+    CacheWavHeader h;
+    fill_header(&h, w->sample_rate, w->channels, (uint32_t)w->data_bytes);
+    if (fseek(w->f, 0, SEEK_SET) != 0 ||
+        fwrite(&h, sizeof(h), 1, w->f) != 1 ||
+        fclose(w->f) != 0) {
+        w->f = NULL;
+        pcm_cache_abort(w);
+        return -1;
+    }
+    w->f = NULL;
+
+    // Atomic publish: readers see either no entry or a complete one
+    if (rename(w->tmp_path, w->final_path) != 0) {
+        perror("PCM cache rename");
+        pcm_cache_abort(w);
+        return -1;
+    }
+
+    free(w);
+    return 0;
+}
+
+void pcm_cache_abort(PcmCacheWriter *w) {
+    if (!w)
+        return;
+    if (w->f)
+        fclose(w->f);
+    unlink(w->tmp_path);
+    free(w);
+}
+
+int pcm_cache_precache_dir(const char *music_dir) {
+    DIR *d = opendir(music_dir);
+    if (!d) {
+        perror("opendir music dir");
+        return 1;
+    }
+
+    int failures = 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        const char *ext = strrchr(e->d_name, '.');
+        if (!ext || strcasecmp(ext, ".mp3") != 0)
+            continue;
+
+        char mp3_path[CACHE_PATH_MAX], cached[CACHE_PATH_MAX];
+        int n = snprintf(mp3_path, sizeof(mp3_path), "%s%s", music_dir, e->d_name);
+        if (n < 0 || (size_t)n >= sizeof(mp3_path))
+            continue;
+
+        if (pcm_cache_lookup(mp3_path, cached, sizeof(cached)) == 0) {
+            printf("cached:   %s\n", e->d_name);
+            continue;
+        }
+
+        printf("decoding: %s\n", e->d_name);
+        fflush(stdout);
+        if (audio_precache(mp3_path) != 0) {
+            fprintf(stderr, "Failed to cache %s\n", mp3_path);
+            failures++;
+        }
+    }
+
+    closedir(d);
+    return failures;
+}
@@ -0,0 +1,433 @@
+#include "pixels.h"
+#include "gpio.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <linux/spi/spidev.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PIXELS_NEON 1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define PIXELS_SSSE3 1
+#endif
+
+#define PIXELS_PRIORITY 70
+
+// --------------------------------------------------------------
+// Encoder
+// --------------------------------------------------------------
+
+// One nibble -> 12 SPI bits. A byte is enc12[hi] << 12 | enc12[lo], sent
+// MSB first as 3 bytes: T0[hi], T1[hi] | T2[lo], T3[lo].
+static const uint16_t enc12[16] = {
+    0x924, 0x926, 0x934, 0x936, 0x9a4, 0x9a6, 0x9b4, 0x9b6,
+    0xd24, 0xd26, 0xd34, 0xd36, 0xda4, 0xda6, 0xdb4, 0xdb6,
+};
+
+#if defined(PIXELS_NEON) || defined(PIXELS_SSSE3)
+static const uint8_t enc_t0[16] = {
+    0x92, 0x92, 0x93, 0x93, 0x9a, 0x9a, 0x9b, 0x9b,
+    0xd2, 0xd2, 0xd3, 0xd3, 0xda, 0xda, 0xdb, 0xdb,
+};
+static const uint8_t enc_t1[16] = {
+    0x40, 0x60, 0x40, 0x60, 0x40, 0x60, 0x40, 0x60,
+    0x40, 0x60, 0x40, 0x60, 0x40, 0x60, 0x40, 0x60,
+};
+static const uint8_t enc_t2[16] = {
+    0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09,
+    0x0d, 0x0d, 0x0d, 0x0d, 0x0d, 0x0d, 0x0d, 0x0d,
+};
+static const uint8_t enc_t3[16] = {
+    0x24, 0x26, 0x34, 0x36, 0xa4, 0xa6, 0xb4, 0xb6,
+    0x24, 0x26, 0x34, 0x36, 0xa4, 0xa6, 0xb4, 0xb6,
+};
+#endif
+
+static int force_scalar = 0;
+
+size_t ws2812_frame_bytes(size_t pixels) {
+    return pixels * WS2812_BYTES_PER_PIXEL + WS2812_RESET_BYTES;
+}
+
+static void encode_scalar(uint8_t *dst, const uint8_t *src, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uint32_t bits = (uint32_t)enc12[src[i] >> 4] << 12 | enc12[src[i] & 15];
+        dst[0] = bits >> 16;
+        dst[1] = bits >> 8;
+        dst[2] = bits;
+        dst += 3;
+    }
+}
+
+#if defined(PIXELS_NEON)
+
+static void encode_simd(uint8_t *dst, const uint8_t *src, size_t len) {
+    const uint8x8x2_t t0 = { { vld1_u8(enc_t0), vld1_u8(enc_t0 + 8) } };
+    const uint8x8x2_t t1 = { { vld1_u8(enc_t1), vld1_u8(enc_t1 + 8) } };
+    const uint8x8x2_t t2 = { { vld1_u8(enc_t2), vld1_u8(enc_t2 + 8) } };
+    const uint8x8x2_t t3 = { { vld1_u8(enc_t3), vld1_u8(enc_t3 + 8) } };
+    size_t i = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        uint8x8_t v = vld1_u8(src + i);
+        uint8x8_t hi = vshr_n_u8(v, 4);
+        uint8x8_t lo = vand_u8(v, vdup_n_u8(0x0f));
+        uint8x8x3_t out;
+        out.val[0] = vtbl2_u8(t0, hi);
+        out.val[1] = vorr_u8(vtbl2_u8(t1, hi), vtbl2_u8(t2, lo));
+        out.val[2] = vtbl2_u8(t3, lo);
+        vst3_u8(dst + 3 * i, out);   // Interleaves the three byte streams
+    }
+    encode_scalar(dst + 3 * i, src + i, len - i);
+}
+
+#elif defined(PIXELS_SSSE3)
+
+// Spread three 16-byte streams over 48 output bytes: out[3i + k] = b_k[i]
+static const int8_t interleave[3][3][16] = {
+    { {  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1,  5 },
+      { -1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1 },
+      { -1, -1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1 } },
+    { { -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10, -1 },
+      {  5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10 },
+      { -1,  5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1 } },
+    { { -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1 },
+      { -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1 },
+      { 10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15 } },
+};
+
+static void encode_simd(uint8_t *dst, const uint8_t *src, size_t len) {
+    const __m128i t0 = _mm_loadu_si128((const __m128i *)enc_t0);
+    const __m128i t1 = _mm_loadu_si128((const __m128i *)enc_t1);
+    const __m128i t2 = _mm_loadu_si128((const __m128i *)enc_t2);
+    const __m128i t3 = _mm_loadu_si128((const __m128i *)enc_t3);
+    const __m128i nib = _mm_set1_epi8(0x0f);
+    __m128i m[3][3];
+    for (int c = 0; c < 3; c++)
+        for (int k = 0; k < 3; k++)
+            m[c][k] = _mm_loadu_si128((const __m128i *)interleave[c][k]);
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nib);
+        __m128i lo = _mm_and_si128(v, nib);
+        __m128i b0 = _mm_shuffle_epi8(t0, hi);
+        __m128i b1 = _mm_or_si128(_mm_shuffle_epi8(t1, hi), _mm_shuffle_epi8(t2, lo));
+        __m128i b2 = _mm_shuffle_epi8(t3, lo);
+        for (int c = 0; c < 3; c++) {
+            __m128i out = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(b0, m[c][0]),
+                                                    _mm_shuffle_epi8(b1, m[c][1])),
+                                       _mm_shuffle_epi8(b2, m[c][2]));
+            _mm_storeu_si128((__m128i *)(dst + 3 * i + 16 * c), out);
+        }
+    }
+    encode_scalar(dst + 3 * i, src + i, len - i);
+}
+
+#else
+
+static void encode_simd(uint8_t *dst, const uint8_t *src, size_t len) {
+    encode_scalar(dst, src, len);
+}
+
+#endif
+
+void ws2812_encode(uint8_t *dst, const uint8_t *grb, size_t len) {
+    if (force_scalar)
+        encode_scalar(dst, grb, len);
+    else
+        encode_simd(dst, grb, len);
+}
+
+const char *ws2812_backend(void) {
+#if defined(PIXELS_NEON)
+    return "NEON";
+#elif defined(PIXELS_SSSE3)
+    return "SSSE3";
+#else
+    return "scalar";
+#endif
+}
+
+void ws2812_force_scalar(int enabled) {
+    force_scalar = enabled;
+}
+
+// --------------------------------------------------------------
+// Sinks
+// --------------------------------------------------------------
+struct PixelSink {
+    int fd;
+    int spi;
+};
+
+PixelSink *pixel_sink_open(const char *path) {
+    struct stat st;
+    int spi = stat(path, &st) == 0 && S_ISCHR(st.st_mode);
+    int fd = spi ? open(path, O_RDWR | O_CLOEXEC)
+                 : open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+
+    if (spi) {
+        uint8_t mode = SPI_MODE_0, bits = 8;
+        uint32_t speed = WS2812_SPI_HZ;
+        if (ioctl(fd, SPI_IOC_WR_MODE, &mode) < 0 ||
+            ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0 ||
+            ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0) {
+            perror("spidev setup");
+            close(fd);
+            return NULL;
+        }
+    }
+
+    PixelSink *sink = calloc(1, sizeof(PixelSink));
+    if (!sink) {
+        close(fd);
+        return NULL;
+    }
+    sink->fd = fd;
+    sink->spi = spi;
+    return sink;
+}
+
+int pixel_sink_is_spi(const PixelSink *sink) {
+    return sink->spi;
+}
+
+int pixel_sink_write(PixelSink *sink, const uint8_t *tx, uint8_t *rx, size_t len) {
+    if (sink->spi) {
+        struct spi_ioc_transfer tr;
+        memset(&tr, 0, sizeof(tr));
+        tr.tx_buf = (uintptr_t)tx;
+        tr.rx_buf = (uintptr_t)rx;
+        tr.len = (uint32_t)len;
+        tr.speed_hz = WS2812_SPI_HZ;
+        tr.bits_per_word = 8;
+        return ioctl(sink->fd, SPI_IOC_MESSAGE(1), &tr) == (int)len ? 0 : -1;
+    }
+
+    while (len > 0) {
+        ssize_t n = write(sink->fd, tx, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        tx += n;
+        len -= n;
+    }
+    return 0;
+}
+
+void pixel_sink_close(PixelSink *sink) {
+    if (!sink)
+        return;
+    close(sink->fd);
+    free(sink);
+}
+
+// --------------------------------------------------------------
+// Show output thread
+// --------------------------------------------------------------
+static unsigned int pixel_count = 0;
+static const char *pixel_device = PIXELS_DEFAULT_DEVICE;
+static uint8_t color_rgb[3] = { 255, 255, 255 };
+
+static const Show *pixel_show;
+static PixelSink *sink;
+static uint8_t *grb_buf, *spi_buf;
+static pthread_t pixel_thread;
+static int running = 0;
+static int wake_fd = -1;
+static atomic_uint pending = 0;        // Cue index + 1, 0 = nothing new
+static atomic_int stopping = 0;
+static atomic_ulong cues_published = 0;
+
+static PixelStats stats;
+static double encode_sum_us, write_sum_us;
+
+void pixels_configure(unsigned int count, const char *device, uint32_t rgb) {
+    pixel_count = count > PIXELS_MAX ? PIXELS_MAX : count;
+    if (device)
+        pixel_device = device;
+    color_rgb[0] = rgb >> 16;
+    color_rgb[1] = rgb >> 8;
+    color_rgb[2] = rgb;
+}
+
+int pixels_enabled(void) {
+    return pixel_count > 0;
+}
+
+// Channel level for record i: PWM slot bits for dimmed shows, else on/off
+static uint8_t cue_level(const Show *show, uint32_t i, int channel) {
+    unsigned int pin = led_lines[channel];
+    int bank = pin >> 5, bit = pin & 31;
+    if (show->frames) {
+        uint8_t level = 0;
+        for (int b = 0; b < PWM_BITS; b++)
+            level |= ((show->frames[i].slot[b].set[bank] >> bit) & 1) << b;
+        return level;
+    }
+    return (show->cues[i].gpset_mask[bank] >> bit) & 1 ? 255 : 0;
+}
+
+// One segment per channel, in the configured colour (WS2812 order: GRB)
+static void build_frame(uint32_t index) {
+    int channels = led_count;
+    uint8_t levels[LED_MAX_CHANNELS];
+    for (int c = 0; c < channels; c++)
+        levels[c] = cue_level(pixel_show, index, c);
+
+    for (unsigned int p = 0; p < pixel_count; p++) {
+        unsigned int level = levels[(uint64_t)p * channels / pixel_count];
+        uint8_t *px = grb_buf + 3 * p;
+        px[0] = (color_rgb[1] * level + 127) / 255;
+        px[1] = (color_rgb[0] * level + 127) / 255;
+        px[2] = (color_rgb[2] * level + 127) / 255;
+    }
+}
+
+static double elapsed_us(struct timespec a, struct timespec b) {
+    return (b.tv_sec - a.tv_sec) * 1e6 + (b.tv_nsec - a.tv_nsec) / 1e3;
+}
+
+static void *pixel_thread_fn(void *arg) {
+    uint64_t sent_cues = 0;
+
+    while (!atomic_load(&stopping)) {
+        uint64_t kicks;
+        if (read(wake_fd, &kicks, sizeof(kicks)) < 0 && errno == EINTR)
+            continue;
+
+        unsigned int next = atomic_exchange(&pending, 0);
+        if (next == 0)
+            continue;
+
+        struct timespec t0, t1, t2;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        build_frame(next - 1);
+        ws2812_encode(spi_buf, grb_buf, (size_t)pixel_count * 3);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        if (pixel_sink_write(sink, spi_buf, NULL, stats.frame_bytes) != 0)
+            stats.write_errors++;
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+
+        double enc = elapsed_us(t0, t1), wr = elapsed_us(t1, t2);
+        encode_sum_us += enc;
+        write_sum_us += wr;
+        if (enc > stats.encode_max_us) stats.encode_max_us = enc;
+        if (wr > stats.write_max_us) stats.write_max_us = wr;
+        stats.frames++;
+
+        // Cues published since the last frame, minus the one just sent. A
+        // cue published after the exchange above is already counted here
+        // and sent next time, when nothing new shows up.
+        uint64_t published = atomic_load(&cues_published);
+        if (published > sent_cues) {
+            stats.merged_cues += published - sent_cues - 1;
+            sent_cues = published;
+        }
+    }
+    return NULL;
+}
+
+int pixels_start(const Show *show) {
+    if (!pixels_enabled() || running)
+        return -1;
+
+    memset(&stats, 0, sizeof(stats));
+    encode_sum_us = write_sum_us = 0;
+    stats.pixels = pixel_count;
+    stats.frame_bytes = ws2812_frame_bytes(pixel_count);
+
+    grb_buf = malloc((size_t)pixel_count * 3);
+    spi_buf = calloc(1, stats.frame_bytes);   // Reset gap stays zero
+    if (wake_fd < 0)
+        wake_fd = eventfd(0, EFD_CLOEXEC);
+    sink = (grb_buf && spi_buf && wake_fd >= 0) ? pixel_sink_open(pixel_device) : NULL;
+    if (!sink) {
+        free(grb_buf);
+        free(spi_buf);
+        grb_buf = spi_buf = NULL;
+        return -1;
+    }
+
+    pixel_show = show;
+    atomic_store(&pending, 0);
+    atomic_store(&stopping, 0);
+    atomic_store(&cues_published, 0);
+
+    struct sched_param param = {.sched_priority = PIXELS_PRIORITY};
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    pthread_attr_setschedparam(&attr, &param);
+
+    int rc = pthread_create(&pixel_thread, &attr, pixel_thread_fn, NULL);
+    if (rc != 0) {
+        pthread_attr_init(&attr);
+        rc = pthread_create(&pixel_thread, &attr, pixel_thread_fn, NULL);
+    }
+    if (rc != 0) {
+        pixel_sink_close(sink);
+        sink = NULL;
+        return -1;
+    }
+    running = 1;
+    return 0;
+}
+
+void pixels_cue(uint32_t index) {
+    if (!running)
+        return;
+    // Counted before it can be taken, so a frame never sees more cues
+    // sent than published
+    atomic_fetch_add(&cues_published, 1);
+    atomic_store(&pending, index + 1);
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void pixels_stop(void) {
+    if (!running)
+        return;
+    atomic_store(&stopping, 1);
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd, &one, sizeof(one));
+    (void)ignored;
+    pthread_join(pixel_thread, NULL);
+    running = 0;
+
+    pixel_sink_close(sink);
+    sink = NULL;
+    free(grb_buf);
+    free(spi_buf);
+    grb_buf = spi_buf = NULL;
+}
+
+void pixels_get_stats(PixelStats *out) {
+    *out = stats;
+    if (stats.frames) {
+        out->encode_avg_us = encode_sum_us / stats.frames;
+        out->write_avg_us = write_sum_us / stats.frames;
+    }
+}
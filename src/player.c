@@ -1,9 +1,20 @@
 ﻿#include "player.h"
 #include "gpio.h"
+#include "output.h"
 #include "setup_alsa.h"
 #include "load.h"
+#include "show.h"
+#include "pwm.h"
+#include "pixels.h"
+#include "recorder.h"
+#include "avclock.h"
+#include "calibrate.h"
+#include "netsync.h"
 #include "audio.h"
 #include "log.h"
+#include "latency.h"
+#include "resample.h"
+#include "dsp.h"
 
 #include <pthread.h>
 #include <sched.h>
@@ -13,21 +24,37 @@
 #include <string.h>
 #include <stdint.h>
 #include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <math.h>
+#include <ctype.h>
 
 #include <syslog.h>
 #include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/resource.h>
 
 // AUDIO_PERIOD_FRAMES: calculated at runtime based on sample rate
 // Target: 10ms worth of frames (e.g., 441 @ 44100Hz, 480 @ 48000Hz)
 #define AUDIO_PERIOD_MS 10
 #define AUDIO_THREAD_PERIOD_MS 30
-#define LED_THREAD_PERIOD_MS 10
 #define MAX_RUNS 60000
 
 #define PREFILL_PERIODS      4
 #define MIN_BUFFER_PERIODS   1
 #define MAX_BUFFER_PERIODS   5
 
+// Poll mode: ALSA wakes us every period, so a much shorter buffer suffices
+#define POLL_BUFFER_PERIODS  4
+#define POLL_TIMEOUT_MS      1000
+#define STALL_BACKOFF_MS     2
+
+// Gated start: the audio thread sleeps in slices (stop stays responsive)
+// and spins the last stretch to the instant
+#define START_SLICE_MS       50
+#define START_SPIN_US        200
+
 // Runtime-calculated period size based on sample rate
 static size_t audio_period_frames = 441;  // Default for 44100Hz
 
@@ -39,7 +66,8 @@ static char music_base_dir[MAX_PATH] = DEFAULT_MUSIC_DIR;
 // --------------------------------------------------------------
 // Globals for real-time statistics
 // --------------------------------------------------------------
-static uint32_t gpio_shadow = 0;
+// LED show for the current song (compiled .show or parsed .txt)
+static Show show;
 
 // Audio thread stats
 static long audio_runtime_us[MAX_RUNS];
@@ -47,9 +75,12 @@ static long audio_jitter_us[MAX_RUNS];
 static long audio_wake_interval_us[MAX_RUNS];
 static long audio_buffer_frames[MAX_RUNS];
 static long alsa_delay_frames[MAX_RUNS];
+static long audio_dsp_ns[MAX_RUNS];
 static size_t audio_sample_index = 0;
 static int underrun_count = 0;
 static int buffer_stall_count = 0;
+static size_t audio_wakeup_count = 0;
+static long cycle_dsp_ns = 0;   // DSP stage time within the current cycle
 
 // GPIO timing stats (nanoseconds)
 static long gpio_write_ns[MAX_RUNS];
@@ -59,6 +90,8 @@ static size_t gpio_timing_index = 0;
 // Playback timing
 static struct timespec playback_start_time;
 static struct timespec playback_end_time;
+static struct timespec first_sample_time;   // First frames handed to ALSA
+static uint64_t audio_frames_written = 0;   // Song frames handed to ALSA (device rate)
 
 // Verbose mode flag (set via -v command line arg)
 static int verbose_mode = 0;
@@ -67,8 +100,89 @@ static int verbose_mode = 0;
 // Default is 0 (keep last LED state on exit)
 static int auto_off_mode = 0;
 
+// Poll mode flag (set via -P command line arg): drive the audio thread
+// from ALSA period events instead of the fixed 30ms timer
+static int audio_poll_mode = 0;
+
+// eventfd used to kick the poll-mode audio thread out of poll() on stop
+static int stop_event_fd = -1;
+
+// Same for the LED thread, which may sleep for a whole cue
+static int led_stop_fd = -1;
+static size_t led_wakeup_count = 0;
+
+// Precision mode (--precise): the LED thread wakes led_margin_ns before
+// each cue and spins to the deadline. The margin follows the observed
+// sleep overshoot.
+#define LED_MARGIN_INIT_NS   200000L
+#define LED_MARGIN_MIN_NS     20000L
+#define LED_MARGIN_MAX_NS   2000000L
+static int led_precise = 0;
+static long led_margin_ns = LED_MARGIN_INIT_NS;
+static long led_overshoot_peak_ns = 0;
+static long led_spin_ns[MAX_RUNS];
+static size_t led_late_wakes = 0;          // Woke after the deadline, no spin
+static int led_audio_locked = 0;           // Cue deadlines read through the audio clock
+
+// Output latency after the ALSA pointer (--calibrate or --sync-offset)
+static int sync_offset_manual = 0;
+static long sync_offset_manual_us = 0;
+static long sync_offset_us = 0;            // Added to every cue of this song
+static const char *sync_offset_source = "none";
+static CalResult sync_cal;                 // Valid when sync_offset_source is "calibrated"
+
+// Multi-node (netsync.h): the song runs on the leader's clock from
+// shared_start_ns. The audio thread keeps it there by skipping or
+// repeating song frames; both threads measure how close they stay.
+static int shared_timeline = 0;
+static int64_t shared_start_ns;
+static int64_t audio_trim_frames = 0;      // > 0 skip that many, < 0 repeat one
+static int64_t audio_slip_frames = 0;      // Net song frames skipped so far
+static NetSyncTimeline timeline;
+static uint64_t timeline_audio_count = 0;
+
+// Gated start (--start-at, UDP arm, a multi-node start): the song is
+// prepared and the device pre-rolled ahead of the instant, the RT threads
+// park on start_barrier and the audio thread starts the DMA at it. The
+// instant is the shared timeline's start.
+static int start_gated = 0;
+static struct timespec start_gate;          // CLOCK_MONOTONIC, as heard
+static pthread_barrier_t start_barrier;     // Sized to the threads started
+static pthread_mutex_t threads_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t threads_cond = PTHREAD_COND_INITIALIZER;
+static int threads_known = 0;               // start_barrier and clock set up
+static int audio_start_held = 0;            // Pre-rolled, not started yet
+static double start_ready_ms;               // Threads parked this far ahead
+static double start_audio_us, start_led_us; // First errors against it
+
+// --start-at / UDP arm: the next song's start (CLOCK_REALTIME)
+static int start_at_pending = 0;
+static struct timespec start_at;
+
+// --offset / UDP seek: the next song starts at this song time. All song
+// times stay absolute: the audio clock counts the frames seeked over, the
+// LED thread starts at the pattern in effect there.
+static int start_offset_pending = 0;
+static uint64_t start_offset_us;
+static uint64_t song_offset_us = 0;         // This song
+static int64_t audio_seek_frames = 0;       // Song frames before the first written (device rate)
+static double seek_ms;                      // audio_seek() and the cue search
+static uint32_t led_first_cue;              // First record committed
+
 static AudioStream *audio_stream = NULL;
 
+// Fixed ALSA rate (-r): songs at other rates go through the resampler and
+// the device stays open between songs. 0 = open ALSA at each song's rate.
+static unsigned int fixed_device_rate = 0;
+#ifdef RPI1
+static ResampleQuality resample_quality = RESAMPLE_FAST;
+#else
+static ResampleQuality resample_quality = RESAMPLE_HIGH;
+#endif
+static Resampler *resampler = NULL;
+static int resampler_drained = 0;           // Filter tail flushed too
+static unsigned int audio_device_rate = 44100;
+
 // --------------------------------------------------------------
 // Utility functions
 // --------------------------------------------------------------
@@ -82,13 +196,85 @@ static long time_diff_ns(struct timespec start, struct timespec end) {
            (end.tv_nsec - start.tv_nsec);
 }
 
+static struct timespec timespec_add_us(struct timespec t, uint64_t us) {
+    t.tv_sec += us / 1000000;
+    t.tv_nsec += (long)(us % 1000000) * 1000;
+    if (t.tv_nsec >= 1000000000) {
+        t.tv_sec++;
+        t.tv_nsec -= 1000000000;
+    }
+    return t;
+}
+
+static struct timespec timespec_sub_us(struct timespec t, uint64_t us) {
+    t.tv_sec -= us / 1000000;
+    t.tv_nsec -= (long)(us % 1000000) * 1000;
+    if (t.tv_nsec < 0) {
+        t.tv_sec--;
+        t.tv_nsec += 1000000000;
+    }
+    return t;
+}
+
+static struct timespec timespec_shift_ns(struct timespec t, long ns) {
+    t.tv_sec += ns / 1000000000L;
+    t.tv_nsec += ns % 1000000000L;
+    if (t.tv_nsec >= 1000000000L) {
+        t.tv_sec++;
+        t.tv_nsec -= 1000000000L;
+    } else if (t.tv_nsec < 0) {
+        t.tv_sec--;
+        t.tv_nsec += 1000000000L;
+    }
+    return t;
+}
+
+// a < b, for spans too long for time_diff_ns() on 32-bit longs
+static int timespec_before(struct timespec a, struct timespec b) {
+    return a.tv_sec < b.tv_sec || (a.tv_sec == b.tv_sec && a.tv_nsec < b.tv_nsec);
+}
+
+static int64_t timespec_to_ns(struct timespec t) {
+    return (int64_t)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// Seconds since playback_start_time (for latency controller decisions)
+static double playback_time_sec(struct timespec now) {
+    return time_diff_us(playback_start_time, now) / 1e6;
+}
+
 void reset_runtime_state(void) {
     audio_sample_index = 0;
     underrun_count = 0;
     buffer_stall_count = 0;
-    gpio_shadow = 0;
+    audio_wakeup_count = 0;
+    cycle_dsp_ns = 0;
+    first_sample_time = (struct timespec){0};
+    audio_frames_written = 0;
     gpio_timing_index = 0;
-    gpio_all_off(led_lines, 8);
+    led_wakeup_count = 0;
+    led_late_wakes = 0;
+    led_audio_locked = 0;
+    sync_offset_us = 0;
+    sync_offset_source = "none";
+    shared_timeline = 0;
+    audio_trim_frames = 0;
+    audio_slip_frames = 0;
+    memset(&timeline, 0, sizeof(timeline));
+    timeline_audio_count = 0;
+    start_gated = 0;
+    audio_start_held = 0;
+    start_ready_ms = 0;
+    start_audio_us = 0;
+    start_led_us = 0;
+    song_offset_us = 0;
+    audio_seek_frames = 0;
+    resampler_drained = 0;
+    seek_ms = 0;
+    led_first_cue = 0;
+    output_failures_reset();
+    output_all_off();
+    output_sim_reset();
 }
 
 static void print_stats(int has_audio, double duration_sec) {
@@ -96,6 +282,18 @@ static void print_stats(int has_audio, double duration_sec) {
 
     printf("\n=== Playback Stats ===\n");
     printf("Duration: %.2f sec\n", duration_sec);
+    if (start_gated) {
+        printf("Start:         %s %.1f ms %s", start_ready_ms >= 0 ? "ready" : "prepared",
+               fabs(start_ready_ms), start_ready_ms >= 0 ? "ahead" : "late");
+        if (has_audio && timeline_audio_count > 0)
+            printf(", audio %+.1f us", start_audio_us);
+        if (timeline.cues > 0)
+            printf(", first cue %+.1f us", start_led_us);
+        printf(" off the instant\n");
+    }
+    if (song_offset_us > 0)
+        printf("Offset:        %.3f s, seek %.2f ms, LED from cue %u of %u\n",
+               song_offset_us / 1e6, seek_ms, led_first_cue, show.count);
 
     if (has_audio && audio_sample_index > 0) {
         // Audio jitter stats
@@ -112,6 +310,41 @@ static void print_stats(int has_audio, double duration_sec) {
                min_j, max_j, (double)sum_j / audio_sample_index);
         printf("Ring buffer:   min=%ld max=%ld frames\n", min_buf, max_buf);
         printf("Underruns: %d, Buffer stalls: %d\n", underrun_count, buffer_stall_count);
+        if (first_sample_time.tv_sec != 0)
+            printf("Time to first sample: %.1f ms\n",
+                   time_diff_us(playback_start_time, first_sample_time) / 1000.0);
+        long max_dsp = 0, sum_dsp = 0;
+        for (size_t i = 0; i < audio_sample_index; i++) {
+            sum_dsp += audio_dsp_ns[i];
+            if (audio_dsp_ns[i] > max_dsp) max_dsp = audio_dsp_ns[i];
+        }
+        printf("DSP stage:     avg=%.2f max=%.2f us per cycle, %llu samples limited\n",
+               sum_dsp / 1000.0 / audio_sample_index, max_dsp / 1000.0,
+               (unsigned long long)dsp_limited_samples());
+        if (duration_sec > 0)
+            printf("Audio wakeups: %zu (%.1f/sec, %s mode)\n", audio_wakeup_count,
+                   audio_wakeup_count / duration_sec, audio_poll_mode ? "poll" : "timer");
+
+        AvClockStats av;
+        avclock_get_stats(&av, led_audio_locked);
+        if (av.observations > 0) {
+            printf("Audio clock:   drift %+.1f ppm (loop %+.1f), residual rms=%.1f max=%.1f us, %u relocks\n",
+                   av.drift_ppm, av.pll_ppm, av.residual_rms_us, av.residual_max_us, av.relocks);
+            if (av.offsets > 0)
+                printf("LED vs audio:  avg=%+.1f max=%.1f us over %llu cues (%s)\n",
+                       av.offset_avg_us, av.offset_max_us, (unsigned long long)av.offsets,
+                       av.locked ? "locked" : "free-running");
+        }
+        if (strcmp(sync_offset_source, "calibrated") == 0)
+            printf("Sync offset:   %+.3f ms (calibrated, %s confidence: %d/%d clicks, spread %.3f ms)\n",
+                   sync_offset_us / 1000.0, calibration_confidence(&sync_cal),
+                   sync_cal.detected, sync_cal.clicks, sync_cal.spread_us / 1000.0);
+        else if (strcmp(sync_offset_source, "manual") == 0)
+            printf("Sync offset:   %+.3f ms (manual)\n", sync_offset_us / 1000.0);
+        if (shared_timeline && timeline_audio_count > 0)
+            printf("Shared audio:  avg=%.1f max=%.1f us off the timeline, %+lld frames slipped\n",
+                   timeline.audio_avg_us / timeline_audio_count, timeline.audio_max_us,
+                   (long long)audio_slip_frames);
     }
 
     if (gpio_timing_index > 0) {
@@ -127,10 +360,44 @@ static void print_stats(int has_audio, double duration_sec) {
             if (gpio_jitter_ns[i] > max_jitter) max_jitter = gpio_jitter_ns[i];
         }
 
-        printf("LED thread:    jitter min=%.1f max=%.1f avg=%.1f us\n",
+        printf("LED thread:    %zu wakeups for %u cues (%s), %d channels in %d bank%s\n",
+               led_wakeup_count, show.source_cues, show.compiled ? "compiled" : "text",
+               led_count, show.banks, show.banks > 1 ? "s" : "");
+        printf("LED thread:    %s min=%.1f max=%.1f avg=%.1f us\n",
+               led_precise ? "edge error" : "jitter",
                min_jitter / 1000.0, max_jitter / 1000.0, sum_jitter / 1000.0 / (double)gpio_timing_index);
-        printf("GPIO write:    min=%.2f max=%.2f avg=%.2f us\n",
-               min_write / 1000.0, max_write / 1000.0, sum_write / 1000.0 / (double)gpio_timing_index);
+        if (shared_timeline && timeline.cues > 0)
+            printf("Shared LEDs:   avg=%+.1f max=%.1f us off the timeline over %llu cues\n",
+                   timeline.led_avg_us / timeline.cues, timeline.led_max_us,
+                   (unsigned long long)timeline.cues);
+        printf("GPIO write:    min=%.2f max=%.2f avg=%.2f us (%s output)\n",
+               min_write / 1000.0, max_write / 1000.0, sum_write / 1000.0 / (double)gpio_timing_index,
+               output_name());
+        int output_err;
+        uint64_t output_failed = output_failures(&output_err);
+        if (output_failed)
+            printf("Output:        %llu updates failed (first: %s)\n",
+                   (unsigned long long)output_failed, strerror(output_err));
+
+        if (led_precise) {
+            long max_spin = 0, sum_spin = 0;
+            for (size_t i = 0; i < gpio_timing_index; i++) {
+                sum_spin += led_spin_ns[i];
+                if (led_spin_ns[i] > max_spin) max_spin = led_spin_ns[i];
+            }
+            printf("LED spin:      avg=%.1f max=%.1f us, %.3f%% CPU, margin %.1f us at end, %zu late wakes\n",
+                   sum_spin / 1000.0 / (double)gpio_timing_index, max_spin / 1000.0,
+                   duration_sec > 0 ? sum_spin / 1e7 / duration_sec : 0,
+                   led_margin_ns / 1000.0, led_late_wakes);
+        }
+    }
+
+    const OutputCommit *log;
+    uint64_t commits;
+    size_t logged = output_sim_log(&log, &commits);
+    if (logged > 0) {
+        printf("Sim output:    %llu commits, %.3f s from first to last\n",
+               (unsigned long long)commits, (log[logged - 1].t_ns - log[0].t_ns) / 1e9);
     }
 }
 
@@ -159,6 +426,87 @@ int get_auto_off(void) {
     return auto_off_mode;
 }
 
+void set_audio_poll_mode(int enabled) {
+    audio_poll_mode = enabled;
+}
+
+void set_led_precise(int enabled) {
+    led_precise = enabled;
+}
+
+void set_sync_offset_ms(double ms) {
+    sync_offset_manual = 1;
+    sync_offset_manual_us = lround(ms * 1000.0);
+}
+
+int set_start_at(const char *when) {
+    struct timespec at;
+    char *end;
+    if (when[0] == '+') {
+        double sec = strtod(when + 1, &end);
+        if (end == when + 1 || *end != '\0' || !(sec >= 0))
+            return -1;
+        double whole = floor(sec);
+        clock_gettime(CLOCK_REALTIME, &at);
+        at.tv_sec += (time_t)whole;
+        at = timespec_shift_ns(at, (long)llround((sec - whole) * 1e9));
+    } else {
+        long long sec = strtoll(when, &end, 10);
+        if (end == when || sec <= 0)
+            return -1;
+        at.tv_sec = (time_t)sec;
+        at.tv_nsec = 0;
+        if (*end == '.') {
+            // Fraction digit by digit: a double would round to ~0.2 us
+            long scale = 100000000L;
+            for (end++; isdigit((unsigned char)*end); end++, scale /= 10)
+                at.tv_nsec += (*end - '0') * scale;
+        }
+        if (*end != '\0')
+            return -1;
+    }
+    start_at = at;
+    start_at_pending = 1;
+    return 0;
+}
+
+int set_start_offset_ms(double ms) {
+    if (!(ms >= 0))
+        return -1;
+    start_offset_us = (uint64_t)llround(ms * 1000.0);
+    start_offset_pending = 1;
+    return 0;
+}
+
+void set_device_rate(unsigned int rate) {
+    fixed_device_rate = rate;
+}
+
+void set_resample_quality(ResampleQuality quality) {
+    resample_quality = quality;
+}
+
+void player_close_audio(void) {
+    alsa_close();
+}
+
+// Async-signal-safe: only write() on an already open eventfd
+void player_signal_stop(void) {
+    uint64_t one = 1;
+    if (stop_event_fd >= 0) {
+        ssize_t ignored = write(stop_event_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+    if (led_stop_fd >= 0) {
+        ssize_t ignored = write(led_stop_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+const char *get_music_dir(void) {
+    return music_base_dir;
+}
+
 void set_music_dir(const char *dir) {
     strncpy(music_base_dir, dir, MAX_PATH - 1);
     music_base_dir[MAX_PATH - 1] = '\0';
@@ -170,16 +518,208 @@ void set_music_dir(const char *dir) {
     }
 }
 
+// --------------------------------------------------------------
+// Period output
+// --------------------------------------------------------------
+
+static int read_stream_source(void *ctx, int16_t *buffer, size_t frames) {
+    return audio_read(ctx, buffer, frames);
+}
+
+// audio_read() at the device rate: through the resampler when the song's
+// rate differs from the fixed device rate, then the DSP stage in place
+static int stream_read_dsp(int16_t *dst, size_t frames) {
+    int n = resampler ?
+        resampler_read(resampler, dst, frames, read_stream_source, audio_stream) :
+        audio_read(audio_stream, dst, frames);
+    if (n < 0 && resampler)
+        resampler_drained = 1;
+
+    if (n > 0) {
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        dsp_process(dst, (size_t)n);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        cycle_dsp_ns += time_diff_ns(t0, t1);
+    }
+    return n;
+}
+
+// With a timeline trim pending, skip song frames (through the DSP stage,
+// so fades stay in place) or repeat the last frame of this read once
+static int stream_read(int16_t *dst, size_t frames) {
+    while (audio_trim_frames > 0) {
+        int skipped = stream_read_dsp(dst, audio_trim_frames < (int64_t)frames ?
+                                           (size_t)audio_trim_frames : frames);
+        if (skipped <= 0)
+            return skipped;
+        audio_trim_frames -= skipped;
+        audio_slip_frames += skipped;
+        avclock_slip(skipped);
+    }
+
+    int repeat = audio_trim_frames < 0 && frames > 1;
+    int n = stream_read_dsp(dst, frames - repeat);
+    if (n > 0 && repeat) {
+        unsigned int ch = audio_stream->channels;
+        memcpy(dst + (size_t)n * ch, dst + (size_t)(n - 1) * ch, ch * sizeof(int16_t));
+        n++;
+        audio_trim_frames = 0;
+        audio_slip_frames--;
+        avclock_slip(-1);
+    }
+    return n;
+}
+
+// Audio threads leave on stop_requested once the stop fade-out is silent
+static int audio_stop_now(void) {
+    return stop_requested && !dsp_stop_fading();
+}
+
+// audio_available() in device-rate frames
+static size_t stream_available(void) {
+    size_t avail = audio_available(audio_stream);
+    return resampler ? resampler_output_frames(resampler, avail) : avail;
+}
+
+// Nothing left to play: the source is read to its end and, through the
+// resampler, the frames it still holds plus its filter tail are out too
+static int stream_finished(void) {
+    return resampler ? resampler_drained : audio_finished(audio_stream);
+}
+
+// Less than a period queued while the decoder is still producing: wait for
+// it. A WAV file (all there) or a finished decoder hands out its short tail,
+// which timeline slips leave off a period boundary.
+static int stream_waiting(void) {
+    if (stream_finished() || stream_available() >= audio_period_frames)
+        return 0;
+    return audio_stream->format != AUDIO_FORMAT_WAV && !audio_stream->finished;
+}
+
+// mmap access: audio_read() decodes/copies straight into the DMA area,
+// so each sample is copied exactly once and no writei() syscall is made.
+static snd_pcm_sframes_t write_period_mmap(size_t frames)
+{
+    snd_pcm_sframes_t avail = snd_pcm_avail_update(pcm);
+    if (avail < 0)
+        return avail;
+    if ((size_t)avail < frames)
+        frames = avail;
+
+    size_t total = 0;
+    while (total < frames) {
+        const snd_pcm_channel_area_t *areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t chunk = frames - total;
+
+        int err = snd_pcm_mmap_begin(pcm, &areas, &offset, &chunk);
+        if (err < 0)
+            return err;
+
+        // Interleaved: all channels share areas[0]; first/step are in bits
+        int16_t *dst = (int16_t *)((uint8_t *)areas[0].addr +
+                                   (areas[0].first + offset * areas[0].step) / 8);
+
+        int frames_read = stream_read(dst, chunk);
+        if (frames_read <= 0) {
+            snd_pcm_mmap_commit(pcm, offset, 0);
+            break;
+        }
+
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(pcm, offset, frames_read);
+        if (committed < 0)
+            return committed;
+
+        total += committed;
+        if ((snd_pcm_uframes_t)frames_read < chunk)
+            break;  // Stream ran dry mid-period
+    }
+
+    // mmap commits do not auto-start the stream like writei() does
+    if (total > 0 && !audio_start_held && snd_pcm_state(pcm) == SND_PCM_STATE_PREPARED)
+        snd_pcm_start(pcm);
+
+    return (snd_pcm_sframes_t)total;
+}
+
+// Write one audio period. Returns frames written, 0 when the stream had
+// nothing to give, or a negative ALSA error (underrun).
+static snd_pcm_sframes_t write_period(int16_t *buffer)
+{
+    snd_pcm_sframes_t written;
+
+    if (alsa_mmap_active) {
+        written = write_period_mmap(audio_period_frames);
+    } else {
+        int frames_read = stream_read(buffer, audio_period_frames);
+        if (frames_read <= 0)
+            return 0;
+        written = snd_pcm_writei(pcm, buffer, frames_read);
+    }
+
+    if (written > 0) {
+        if (first_sample_time.tv_sec == 0)
+            clock_gettime(CLOCK_MONOTONIC, &first_sample_time);
+        audio_frames_written += written;
+    }
+
+    return written;
+}
+
+// Feed the audio clock: song frames written minus those still queued is
+// what the listener hears now (hw timestamp when the driver has one)
+static void audio_clock_sample(void)
+{
+    struct timespec when;
+    int64_t played;
+    if (alsa_stream_position(pcm, alsa_buffer_frames, audio_frames_written,
+                             &when, &played) == 0)
+        avclock_observe(when, played + audio_seek_frames + audio_slip_frames);
+}
+
+// Multi-node: compare the song as heard (output latency included) with the
+// shared timeline. Far behind (a late start) skips ahead at once, a small
+// error slips one frame per read until it is back inside NETSYNC_SLIP_US.
+static void audio_timeline_trim(void)
+{
+    if (!shared_timeline || !avclock_locked())
+        return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t now_ns = timespec_to_ns(now);
+    double shared_us = (netsync_leader_ns(now_ns) - shared_start_ns) / 1000.0;
+    if (shared_us < 0)
+        return;
+    double heard_us = avclock_position_us(now) - sync_offset_us;
+    double err_us = heard_us - shared_us;   // + = ahead of the timeline
+
+    if (err_us < -NETSYNC_SKIP_US)
+        audio_trim_frames = llround(-err_us * audio_device_rate / 1e6);
+    else if (err_us < -NETSYNC_SLIP_US)
+        audio_trim_frames = 1;
+    else if (err_us > NETSYNC_SLIP_US)
+        audio_trim_frames = -1;
+    else
+        audio_trim_frames = 0;
+
+    if (timeline_audio_count == 0)
+        start_audio_us = err_us;
+    timeline.audio_avg_us += fabs(err_us);
+    if (fabs(err_us) > timeline.audio_max_us)
+        timeline.audio_max_us = fabs(err_us);
+    timeline_audio_count++;
+}
+
 /*** Re-prefill after underrun (streaming version) ***/
 static void do_reprefill_streaming(int16_t *buffer)
 {
     for (int r = 0; r < PREFILL_PERIODS; ++r) {
-        int frames_read = audio_read(audio_stream, buffer, audio_period_frames);
-        if (frames_read <= 0)
+        snd_pcm_sframes_t w = write_period(buffer);
+        if (w == 0)
             break;
 
-        snd_pcm_sframes_t w = snd_pcm_writei(pcm, buffer, frames_read);
-
         if (w < 0) {
             snd_pcm_prepare(pcm);
             r--;    // retry this prefill period
@@ -189,17 +729,99 @@ static void do_reprefill_streaming(int16_t *buffer)
 }
 
 
+static void handle_underrun(snd_pcm_sframes_t err, int16_t *buffer)
+{
+    if (latency_adaptive_enabled()) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        latency_note_underrun(playback_time_sec(now));
+    }
+
+    underrun_count++;
+    if (underrun_count <= 10 || underrun_count % 50 == 0)
+        syslog(LOG_WARNING, "Underrun #%d: %s",
+                underrun_count, snd_strerror(err));
+    snd_pcm_prepare(pcm);
+
+    do_reprefill_streaming(buffer);
+}
+
+static void record_audio_sample(long runtime_us, long wake_us, long jitter,
+                                size_t ring_avail, snd_pcm_sframes_t delay)
+{
+    // Stats stop at MAX_RUNS samples, playback does not
+    if (audio_sample_index >= MAX_RUNS) {
+        cycle_dsp_ns = 0;
+        return;
+    }
+
+    audio_runtime_us[audio_sample_index] = runtime_us;
+    audio_wake_interval_us[audio_sample_index] = wake_us;
+    audio_jitter_us[audio_sample_index] = jitter;
+    audio_buffer_frames[audio_sample_index] = (long)ring_avail;
+    alsa_delay_frames[audio_sample_index] = (long)delay;
+    audio_dsp_ns[audio_sample_index] = cycle_dsp_ns;
+    cycle_dsp_ns = 0;
+
+    if (verbose_mode && audio_sample_index % 100 == 0) {
+        syslog(LOG_INFO, "[Cycle %zu] ALSA=%ld Ring=%zu jitter=%ld us",
+                audio_sample_index, delay, ring_avail, jitter);
+    }
+
+    audio_sample_index++;
+}
+
+// The RT threads hold here until play_song knows which of them are
+// running: a thread that failed to start must not be waited for at the
+// barrier, nor its clock followed.
+static void wait_threads_known(void) {
+    pthread_mutex_lock(&threads_lock);
+    while (!threads_known)
+        pthread_cond_wait(&threads_cond, &threads_lock);
+    pthread_mutex_unlock(&threads_lock);
+}
+
+// Gated start: park with the LED thread, then start the pre-rolled stream
+// when its first frame has to leave the device (the output latency before
+// it is heard). The wake latency is spun out, not carried into the start.
+static void audio_gate_start(void) {
+    if (!start_gated)
+        return;
+    wait_threads_known();
+    pthread_barrier_wait(&start_barrier);
+
+    struct timespec at = timespec_shift_ns(start_gate, -sync_offset_us * 1000L);
+    struct timespec spin_from = timespec_shift_ns(at, -START_SPIN_US * 1000L);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    while (!stop_requested && timespec_before(now, spin_from)) {
+        struct timespec next = timespec_add_us(now, START_SLICE_MS * 1000ULL);
+        if (timespec_before(spin_from, next))
+            next = spin_from;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    }
+    while (!stop_requested && timespec_before(now, at))
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (audio_start_held) {
+        snd_pcm_start(pcm);
+        alsa_hold_start(pcm, 0);
+        audio_start_held = 0;
+        audio_clock_sample();
+    }
+}
+
 // --------------------------------------------------------------
-// Audio thread (streaming version)
+// Audio thread (streaming version, fixed 30ms timer)
 // --------------------------------------------------------------
 static void *audio_thread_fn(void *arg) {
+    audio_gate_start();
+
     struct timespec next_time;
     clock_gettime(CLOCK_MONOTONIC, &next_time);
     struct timespec prev_wake_time = {0};
 
-    const snd_pcm_sframes_t max_delay_frames =
-        MAX_BUFFER_PERIODS * audio_period_frames;
-
     // Local buffer for reading from stream
     int16_t *local_buffer = malloc(audio_period_frames * 2 * sizeof(int16_t));
     if (!local_buffer) {
@@ -207,15 +829,16 @@ static void *audio_thread_fn(void *arg) {
         return NULL;
     }
 
-    while (!audio_finished(audio_stream) && audio_sample_index < MAX_RUNS && !stop_requested) {
+    while (!stream_finished() && !audio_stop_now()) {
 
         clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_time, NULL);
 
         // Check again after waking - signal may have arrived during sleep
-        if (stop_requested) break;
+        if (audio_stop_now()) break;
 
         struct timespec start_time, end_time;
         clock_gettime(CLOCK_MONOTONIC, &start_time);
+        audio_wakeup_count++;
 
         long wake_us = 0;
         if (prev_wake_time.tv_sec != 0)
@@ -228,6 +851,12 @@ static void *audio_thread_fn(void *arg) {
         if (snd_pcm_delay(pcm, &delay) < 0)
             delay = 0;
 
+        // Fill target: fixed, or whatever the latency controller settled on
+        const snd_pcm_sframes_t max_delay_frames =
+            (latency_adaptive_enabled() ? latency_target_periods()
+                                        : MAX_BUFFER_PERIODS) * audio_period_frames;
+        snd_pcm_sframes_t delay_at_wake = delay;
+
         // Record ring buffer fill level
         size_t ring_avail = audio_available(audio_stream);
 
@@ -238,10 +867,9 @@ static void *audio_thread_fn(void *arg) {
             }
 
             // Check if enough data available
-            size_t avail = audio_available(audio_stream);
-            if (avail < audio_period_frames) {
-                if (audio_finished(audio_stream))
-                    break;
+            if (stream_finished())
+                break;
+            if (stream_waiting()) {
                 buffer_stall_count++;
                 continue;  // Wait for decoder to catch up
             }
@@ -249,22 +877,14 @@ static void *audio_thread_fn(void *arg) {
             struct timespec call_start, call_end;
             clock_gettime(CLOCK_MONOTONIC, &call_start);
 
-            // Read from stream
-            int frames_read = audio_read(audio_stream, local_buffer, audio_period_frames);
-            if (frames_read <= 0) {
+            // Read from stream and hand to ALSA
+            snd_pcm_sframes_t written = write_period(local_buffer);
+            if (written == 0) {
                 break;
             }
 
-            snd_pcm_sframes_t written = snd_pcm_writei(pcm, local_buffer, frames_read);
             if (written < 0) {
-                underrun_count++;
-                if (underrun_count <= 10 || underrun_count % 50 == 0)
-                    syslog(LOG_WARNING, "Underrun #%d: %s",
-                            underrun_count, snd_strerror(written));
-                snd_pcm_prepare(pcm);
-
-                do_reprefill_streaming(local_buffer);
-
+                handle_underrun(written, local_buffer);
                 break;
             }
 
@@ -281,19 +901,13 @@ static void *audio_thread_fn(void *arg) {
             syslog(LOG_ERR, "Deadline miss at cycle %zu by %ld us\n",
                     audio_sample_index, -jitter);
 
-        // Record all metrics
-        audio_runtime_us[audio_sample_index] = total_runtime_us;
-        audio_wake_interval_us[audio_sample_index] = wake_us;
-        audio_jitter_us[audio_sample_index] = jitter;
-        audio_buffer_frames[audio_sample_index] = (long)ring_avail;
-        alsa_delay_frames[audio_sample_index] = (long)delay;
+        if (latency_adaptive_enabled())
+            latency_observe(playback_time_sec(start_time), jitter,
+                            delay_at_wake, audio_period_frames);
 
-        if (verbose_mode && audio_sample_index % 100 == 0) {
-            syslog(LOG_INFO, "[Cycle %zu] ALSA=%ld Ring=%zu jitter=%ld us",
-                    audio_sample_index, delay, ring_avail, jitter);
-        }
-
-        audio_sample_index++;
+        record_audio_sample(total_runtime_us, wake_us, jitter, ring_avail, delay);
+        audio_clock_sample();
+        audio_timeline_trim();
 
         // Advance next_time by one audio period
         next_time.tv_nsec += AUDIO_THREAD_PERIOD_MS * 1000000;
@@ -308,91 +922,350 @@ static void *audio_thread_fn(void *arg) {
 }
 
 // --------------------------------------------------------------
-// LED thread
+// Audio thread (poll mode, driven by ALSA period events)
 // --------------------------------------------------------------
-static void *led_thread_fn(void *arg) {
+// Sleeps in poll() on the PCM descriptors plus the stop eventfd, so it
+// wakes exactly when the hardware has consumed a period. Jitter is
+// reported as how far past the period boundary we woke (extra frames
+// already free in the ALSA buffer), in microseconds.
+static void *audio_thread_poll_fn(void *arg) {
+    audio_gate_start();
+
+    int nfds = snd_pcm_poll_descriptors_count(pcm);
+    if (nfds <= 0) {
+        syslog(LOG_ERR, "snd_pcm_poll_descriptors_count failed");
+        return NULL;
+    }
 
-    int current_index = 0, tick_count = 0, ticks_for_current = 0;
-    struct timespec start, next_time;
-    clock_gettime(CLOCK_MONOTONIC, &start);
-    next_time = start;
+    struct pollfd *pfds = calloc(nfds + 1, sizeof(struct pollfd));
+    int16_t *local_buffer = malloc(audio_period_frames * 2 * sizeof(int16_t));
+    if (!pfds || !local_buffer) {
+        syslog(LOG_ERR, "Failed to allocate audio buffer");
+        free(pfds);
+        free(local_buffer);
+        return NULL;
+    }
 
-    int tick = 0;
-    while (current_index < pattern_count && !stop_requested) {
-        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_time, NULL);
+    snd_pcm_poll_descriptors(pcm, pfds, nfds);
+    pfds[nfds].fd = stop_event_fd;
+    pfds[nfds].events = POLLIN;
 
-        // Check again after waking - signal may have arrived during sleep
-        if (stop_requested) break;
+    struct timespec prev_wake_time = {0};
+
+    while (!stream_finished() && !audio_stop_now()) {
 
-        struct timespec tick_start, write_start, write_end;
-        clock_gettime(CLOCK_MONOTONIC, &tick_start);
+        int rc = poll(pfds, nfds + 1, POLL_TIMEOUT_MS);
+        if (pfds[nfds].revents & POLLIN) {
+            // Consume the stop kick so poll() keeps pacing the fade-out
+            uint64_t kicks;
+            ssize_t ignored = read(stop_event_fd, &kicks, sizeof(kicks));
+            (void)ignored;
+        }
+        if (audio_stop_now()) break;
+        if (rc < 0 && errno != EINTR) {
+            syslog(LOG_ERR, "poll: %s", strerror(errno));
+            break;
+        }
+        if (rc <= 0) continue;
+
+        struct timespec start_time, call_start, call_end;
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+        audio_wakeup_count++;
+
+        long wake_us = 0;
+        if (prev_wake_time.tv_sec != 0)
+            wake_us = time_diff_us(prev_wake_time, start_time);
+        prev_wake_time = start_time;
 
-        // Record wake jitter (difference between scheduled and actual wake time)
-        long jitter_ns = time_diff_ns(next_time, tick_start);
+        unsigned short revents = 0;
+        snd_pcm_poll_descriptors_revents(pcm, pfds, nfds, &revents);
 
-        if (tick_count == 0) {
-            int values[8];
-            for (int j = 0; j < 8; ++j)
-                values[j] = (patterns[current_index].pattern >> (7 - j)) & 1;
+        if (revents & POLLERR) {
+            handle_underrun(-EPIPE, local_buffer);
+            continue;
+        }
+        if (!(revents & POLLOUT)) continue;
+
+        snd_pcm_sframes_t hw_avail = snd_pcm_avail_update(pcm);
+        if (hw_avail < 0) {
+            handle_underrun(hw_avail, local_buffer);
+            continue;
+        }
+
+        long jitter = 0;
+        if ((size_t)hw_avail > audio_period_frames)
+            jitter = (long)((hw_avail - audio_period_frames) * 1000000LL /
+                            audio_device_rate);
+
+        size_t ring_avail = audio_available(audio_stream);
+        int stalled = 0;
+
+        if (latency_adaptive_enabled()) {
+            snd_pcm_sframes_t delay_at_wake = 0;
+            if (snd_pcm_delay(pcm, &delay_at_wake) < 0)
+                delay_at_wake = 0;
+            latency_observe(playback_time_sec(start_time), jitter,
+                            delay_at_wake, audio_period_frames);
+        }
 
-            uint32_t set_mask = 0, clr_mask = 0;
-            for (int j = 0; j < 8; ++j) {
-                int pin = led_lines[j];
-                if (values[j]) set_mask |= (1u << pin);
-                else clr_mask |= (1u << pin);
+        // Top up exactly what the hardware has freed, one period at a time
+        clock_gettime(CLOCK_MONOTONIC, &call_start);
+        while ((size_t)hw_avail >= audio_period_frames) {
+            if (stream_waiting()) {
+                buffer_stall_count++;
+                stalled = 1;
+                break;
             }
 
-            clock_gettime(CLOCK_MONOTONIC, &write_start);
+            snd_pcm_sframes_t written = write_period(local_buffer);
+            if (written == 0)
+                break;
+            if (written < 0) {
+                handle_underrun(written, local_buffer);
+                break;
+            }
+            hw_avail -= written;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &call_end);
+
+        snd_pcm_sframes_t delay = 0;
+        if (snd_pcm_delay(pcm, &delay) < 0)
+            delay = 0;
+
+        record_audio_sample(time_diff_us(call_start, call_end), wake_us,
+                            jitter, ring_avail, delay);
+        audio_clock_sample();
+        audio_timeline_trim();
+
+        // The PCM stays writable while we wait for the decoder; back off
+        // instead of spinning through poll()
+        if (stalled) {
+            struct timespec backoff = { .tv_sec = 0,
+                                        .tv_nsec = STALL_BACKOFF_MS * 1000000L };
+            clock_nanosleep(CLOCK_MONOTONIC, 0, &backoff, NULL);
+        }
+    }
+
+    free(pfds);
+    free(local_buffer);
+    return NULL;
+}
+
+// --------------------------------------------------------------
+// LED thread (event-driven: one wakeup per pattern change)
+// --------------------------------------------------------------
+// Sleep until an absolute CLOCK_MONOTONIC deadline. The timerfd keeps the
+// deadline absolute while poll() also watches the stop eventfd, so long
+// cues do not delay shutdown. Returns 0 if stop was requested.
+static int led_sleep_until(int timer_fd, struct timespec deadline) {
+    if (timer_fd < 0) {
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+        return !stop_requested;
+    }
 
-            uint32_t desired_state = gpio_shadow;
-            desired_state &= ~clr_mask;
-            desired_state |= set_mask;
+    struct itimerspec its = { .it_value = deadline };
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+
+    struct pollfd pfds[2] = {
+        { .fd = timer_fd, .events = POLLIN },
+        { .fd = led_stop_fd, .events = POLLIN },
+    };
+    while (!stop_requested) {
+        int rc = poll(pfds, led_stop_fd >= 0 ? 2 : 1, -1);
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        if (pfds[0].revents & POLLIN) {
+            uint64_t expirations;
+            ssize_t ignored = read(timer_fd, &expirations, sizeof(expirations));
+            (void)ignored;
+            return !stop_requested;
+        }
+        if (pfds[1].revents & POLLIN)
+            break;
+    }
+    return 0;
+}
 
-            uint32_t led_mask = 0;
-            for (int j = 0; j < 8; ++j)
-                led_mask |= (1u << led_lines[j]);
+// Margin = decaying peak of the sleep overshoot plus a quarter, so one
+// slow wake widens it at once and it narrows again over ~16 cues
+static void led_adapt_margin(long overshoot_ns) {
+    if (overshoot_ns < 0)
+        overshoot_ns = 0;
+    led_overshoot_peak_ns -= led_overshoot_peak_ns / 16;
+    if (overshoot_ns > led_overshoot_peak_ns)
+        led_overshoot_peak_ns = overshoot_ns;
+
+    long margin = led_overshoot_peak_ns + led_overshoot_peak_ns / 4 + LED_MARGIN_MIN_NS;
+    led_margin_ns = margin > LED_MARGIN_MAX_NS ? LED_MARGIN_MAX_NS : margin;
+}
 
-            uint32_t bits_to_clear =
-                (gpio_shadow & ~desired_state) & led_mask;
-            uint32_t bits_to_set =
-                (~gpio_shadow & desired_state) & led_mask;
+// Deadline of a song time: read through the audio clock, or counted from
+// the thread's own start (song_offset_us), then moved by the output
+// latency. Without the audio clock a multi-node song reads it off the
+// leader's timeline, which already is the time it is heard. Song times
+// before the offset are due at the start.
+static struct timespec led_deadline(struct timespec start, uint64_t song_us) {
+    if (song_us < song_offset_us)
+        song_us = song_offset_us;
+    if (shared_timeline && !led_audio_locked) {
+        int64_t t = netsync_local_ns(shared_start_ns + (int64_t)song_us * 1000);
+        return (struct timespec){ .tv_sec = t / 1000000000LL, .tv_nsec = t % 1000000000LL };
+    }
+    struct timespec t = led_audio_locked ? avclock_deadline(song_us)
+                                         : timespec_add_us(start, song_us - song_offset_us);
+    return timespec_shift_ns(t, sync_offset_us * 1000L);
+}
 
-            volatile uint32_t *GPSET0 = gpio + 0x1C / 4;
-            volatile uint32_t *GPCLR0 = gpio + 0x28 / 4;
+// Multi-node: commit (as heard) against the cue's place on the timeline
+static void led_timeline_note(uint64_t song_us, struct timespec heard) {
+    if (!shared_timeline)
+        return;
+    int64_t t = timespec_to_ns(heard);
+    double err_us = (netsync_leader_ns(t) - shared_start_ns) / 1000.0 - (double)song_us;
+    if (timeline.cues == 0)
+        start_led_us = err_us;
+    timeline.led_avg_us += err_us;
+    if (fabs(err_us) > timeline.led_max_us)
+        timeline.led_max_us = fabs(err_us);
+    timeline.cues++;
+}
 
-            *GPSET0 = bits_to_set;
-            __sync_synchronize();
-            *GPCLR0 = bits_to_clear;
+// Wait for the audio thread's first clock sample (the song position that
+// accounts for the output latency). Returns 0 on stop or timeout.
+static int led_wait_audio_clock(int timer_fd) {
+    struct timespec now, give_up;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    give_up = timespec_add_us(now, AVCLOCK_LOCK_TIMEOUT_MS * 1000ULL);
+    while (!avclock_locked()) {
+        if (stop_requested || time_diff_ns(give_up, now) >= 0)
+            return 0;
+        if (!led_sleep_until(timer_fd, timespec_add_us(now, 1000)))
+            return 0;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    }
+    return 1;
+}
 
-            gpio_shadow = desired_state;
+// Busy-wait to the deadline; returns the time spent spinning
+static long led_spin_until(struct timespec deadline) {
+    struct timespec now, begin;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    now = begin;
+    while (time_diff_ns(deadline, now) < 0)
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    return time_diff_ns(begin, now);
+}
 
-            clock_gettime(CLOCK_MONOTONIC, &write_end);
+static void *led_thread_fn(void *arg) {
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer_fd < 0)
+        syslog(LOG_WARNING, "timerfd_create failed, LED stop may wait for the current cue");
+
+    led_margin_ns = LED_MARGIN_INIT_NS;
+    led_overshoot_peak_ns = 0;
+
+    wait_threads_known();
+    if (start_gated)
+        pthread_barrier_wait(&start_barrier);
+
+    // Every cue's deadline is start + its cumulative offset: no drift from
+    // wake latency or rounding, whatever the cue count. Locked to the audio
+    // clock, start is when the listener hears the first frame and each
+    // deadline follows the sound card's rate (avclock.h). On a shared
+    // timeline the first cues go by it until the audio clock has locked.
+    led_audio_locked = 0;
+    if (avclock_active() && avclock_lock_enabled() && !shared_timeline) {
+        led_audio_locked = led_wait_audio_clock(timer_fd);
+        if (!led_audio_locked && !stop_requested)
+            syslog(LOG_WARNING, "No audio clock after %d ms, LED timeline free-running",
+                   AVCLOCK_LOCK_TIMEOUT_MS);
+    }
 
-            // Store timing data (nanoseconds)
-            if (gpio_timing_index < MAX_RUNS) {
-                gpio_write_ns[gpio_timing_index] = time_diff_ns(write_start, write_end);
-                gpio_jitter_ns[gpio_timing_index] = jitter_ns;
-                gpio_timing_index++;
-            }
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    recorder_timeline_start(timespec_sub_us(led_deadline(start, song_offset_us), song_offset_us),
+                            led_first_cue);
+
+    // Mid-song (led_first_cue from show_find()): the change in effect at
+    // the offset is committed at the start, unless a cue falls on it
+    uint32_t first = led_first_cue;
+    if (first > 0 && (first == show.count || show.cues[first].abs_time_us > song_offset_us))
+        first--;
+
+    // One record per pattern change, masks precomputed (show.c)
+    for (uint32_t i = first; i < show.count; i++) {
+        const ShowCue *cue = &show.cues[i];
+        uint64_t at_us = cue->abs_time_us < song_offset_us ? song_offset_us : cue->abs_time_us;
+        if (shared_timeline && !led_audio_locked && avclock_active() &&
+            avclock_lock_enabled() && avclock_locked())
+            led_audio_locked = 1;
+        struct timespec deadline = led_deadline(start, at_us);
+        struct timespec wake_at = led_precise ? timespec_shift_ns(deadline, -led_margin_ns) : deadline;
+        if (!led_sleep_until(timer_fd, wake_at))
+            break;
 
-            int duration = patterns[current_index].duration_ms;
-            if (duration < 10) duration = 10;  // minimum 10ms (1 tick)
-            duration = ((duration + 5) / 10) * 10;  // round to nearest 10ms
-            ticks_for_current = duration / LED_THREAD_PERIOD_MS;
-            tick_count = ticks_for_current;
+        long spun = 0;
+        if (led_precise) {
+            // Pull the frame into cache, then spin out the margin
+            struct timespec woke;
+            clock_gettime(CLOCK_MONOTONIC, &woke);
+            __builtin_prefetch(cue);
+            if (show.frames)
+                __builtin_prefetch(&show.frames[i]);
+            led_adapt_margin(time_diff_ns(wake_at, woke));
+            if (time_diff_ns(deadline, woke) >= 0)
+                led_late_wakes++;
+            else
+                spun = led_spin_until(deadline);
         }
 
-        tick_count--;
-        if (tick_count == 0) current_index++;
-        tick++;
+        struct timespec wake, write_end;
+        int commit_failed = 0;
+        clock_gettime(CLOCK_MONOTONIC, &wake);
+        led_wakeup_count++;
 
-        next_time.tv_nsec += LED_THREAD_PERIOD_MS * 1000000;
-        while (next_time.tv_nsec >= 1000000000) {
-            next_time.tv_sec++;
-            next_time.tv_nsec -= 1000000000;
+        if (show.frames) {
+            // Dimmed show: the PWM thread owns the outputs
+            pwm_set_frame(&show.frames[i]);
+        } else {
+            // mmap: two stores per bank whatever the channel count, bank 1
+            // only when the pin map reaches GPIO 32 and up (output.h)
+            commit_failed = output_commit(cue->gpset_mask, cue->gpclr_mask) != 0;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &write_end);
+
+        // Against the sound as heard: the output latency taken out for the
+        // audio clock; the shared timeline already is the time things are heard
+        avclock_note_commit(at_us, timespec_shift_ns(wake, -sync_offset_us * 1000L));
+        led_timeline_note(at_us, wake);
+
+        // Outside the timed write: level readback may be a syscall (cdev).
+        // A catch-up commit has no cue time to be measured against.
+        if (i >= led_first_cue)
+            recorder_commit(i, wake, cue->gpset_mask, commit_failed);
+
+        // Pixel strip follows on its own thread (after the timing sample,
+        // the handoff is not part of the GPIO write)
+        pixels_cue(i);
+
+        // Store timing data (nanoseconds); jitter is lateness vs the deadline
+        if (gpio_timing_index < MAX_RUNS) {
+            gpio_write_ns[gpio_timing_index] = time_diff_ns(wake, write_end);
+            gpio_jitter_ns[gpio_timing_index] = time_diff_ns(deadline, wake);
+            led_spin_ns[gpio_timing_index] = spun;
+            gpio_timing_index++;
         }
     }
 
+    // Hold the last pattern for its duration, as before
+    if (!stop_requested && show.count > 0)
+        led_sleep_until(timer_fd, led_deadline(start, show.total_us));
+
+    if (timer_fd >= 0)
+        close(timer_fd);
     return NULL;
 }
 
@@ -417,6 +1290,41 @@ static int find_audio_file(char *out_path, size_t out_len, const char *base_name
     return -1;  // Not found
 }
 
+// Gated start: queue the song's first periods (what the audio thread keeps
+// queued anyway) in the stopped device, so the instant only has to start
+// the DMA. A device kept open (-r) drops the last song's tail.
+static void audio_preroll(void) {
+    snd_pcm_drop(pcm);
+    snd_pcm_prepare(pcm);
+    if (alsa_hold_start(pcm, 1) < 0) {
+        fprintf(stderr, "Cannot hold the ALSA start, audio starts with the thread\n");
+        return;
+    }
+    audio_start_held = 1;
+
+    size_t periods = audio_poll_mode ? alsa_buffer_frames / audio_period_frames :
+                     latency_adaptive_enabled() ? latency_target_periods() : MAX_BUFFER_PERIODS;
+    if (periods > alsa_buffer_frames / audio_period_frames)
+        periods = alsa_buffer_frames / audio_period_frames;
+
+    int16_t *buffer = malloc(audio_period_frames * 2 * sizeof(int16_t));
+    for (size_t i = 0; buffer && i < periods; i++) {
+        if (write_period(buffer) <= 0)
+            break;
+    }
+    free(buffer);
+}
+
+// The song goes on without audio: close the stream and the device, whose
+// pre-roll (if any) is dropped rather than drained out
+static void drop_audio(void) {
+    audio_close(audio_stream);
+    audio_stream = NULL;
+    if (pcm)
+        snd_pcm_drop(pcm);
+    alsa_close();
+}
+
 // --------------------------------------------------------------
 // Playback
 // --------------------------------------------------------------
@@ -424,6 +1332,14 @@ void play_song(const char *base_name) {
     char audio_file[MAX_PATH], pattern_file[MAX_PATH];
     int has_audio = 0;
 
+    // An armed start or offset belongs to this song, even one that fails
+    // to load: taken here, before any return, it cannot carry over to the next
+    int armed = start_at_pending;
+    struct timespec armed_at = start_at;
+    start_at_pending = 0;
+    uint64_t offset_us = start_offset_pending ? start_offset_us : 0;
+    start_offset_pending = 0;
+
     // Check for audio file (optional)
     if (find_audio_file(audio_file, sizeof(audio_file), base_name) == 0) {
         has_audio = 1;
@@ -450,9 +1366,19 @@ void play_song(const char *base_name) {
     printf("Pattern file: %s\n", pattern_file);
 
     reset_runtime_state();
-    load_patterns(pattern_file);
+    if (show_load(pattern_file, &show) != 0) {
+        fprintf(stderr, "Failed to load pattern file: %s\n", pattern_file);
+        return;
+    }
+
+    printf("Loaded %u patterns, %u changes (%.3f s, %s)\n", show.source_cues, show.count,
+           show.total_us / 1e6, show.compiled ? "compiled" : "text");
+    if (!show.compiled && pattern_channels != led_count)
+        printf("Note: pattern file has %d channels, pin map has %d\n",
+               pattern_channels, led_count);
 
-    printf("Loaded %d patterns\n", pattern_count);
+    if (led_stop_fd < 0)
+        led_stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
 
     // Record start time (always needed for stats)
     clock_gettime(CLOCK_MONOTONIC, &playback_start_time);
@@ -467,28 +1393,87 @@ void play_song(const char *base_name) {
             has_audio = 0;
         } else {
             printf("Format: %s, %u Hz, %u channels\n",
-                   audio_stream->format == AUDIO_FORMAT_MP3 ? "MP3" : "WAV",
+                   audio_format_name(audio_stream),
                    audio_stream->sample_rate,
                    audio_stream->channels);
 
-            // Calculate period size based on sample rate (10ms worth of frames)
-            audio_period_frames = (audio_stream->sample_rate * AUDIO_PERIOD_MS) / 1000;
+            // Device rate: fixed (-r), resampling songs at other rates,
+            // or the song's own rate
+            audio_device_rate = audio_stream->sample_rate;
+            if (fixed_device_rate && fixed_device_rate != audio_stream->sample_rate) {
+                resampler = resampler_create(audio_stream->sample_rate,
+                                             fixed_device_rate, resample_quality);
+                if (resampler) {
+                    audio_device_rate = fixed_device_rate;
+                    printf("Resampling %u -> %u Hz (%s, %u taps)\n",
+                           audio_stream->sample_rate, fixed_device_rate,
+                           resample_quality_name(resample_quality),
+                           resampler_taps(resampler));
+                } else {
+                    fprintf(stderr, "Cannot resample to %u Hz, reopening ALSA at %u Hz\n",
+                            fixed_device_rate, audio_stream->sample_rate);
+                }
+            }
+
+            // Calculate period size based on device rate (10ms worth of frames)
+            audio_period_frames = (audio_device_rate * AUDIO_PERIOD_MS) / 1000;
             printf("Audio period: %zu frames (%d ms)\n", audio_period_frames, AUDIO_PERIOD_MS);
 
-            setup_alsa(audio_stream->sample_rate, audio_stream->channels);
+            if (audio_poll_mode) {
+                if (stop_event_fd < 0)
+                    stop_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+                if (stop_event_fd < 0) {
+                    perror("eventfd (falling back to timer mode)");
+                    audio_poll_mode = 0;
+                }
+            }
+            if (latency_adaptive_enabled()) {
+                // Timer mode wakes every 30ms, so it must keep more than
+                // one wake interval queued; poll mode refills every period
+                unsigned int min_target = audio_poll_mode ? 1 :
+                    AUDIO_THREAD_PERIOD_MS / AUDIO_PERIOD_MS + 1;
+                latency_song_start(min_target, AUDIO_PERIOD_MS * 1000);
+                alsa_set_buffer_periods(latency_buffer_periods());
+                printf("Adaptive latency: fill target %u periods, ALSA buffer %u periods\n",
+                       latency_target_periods(), latency_buffer_periods());
+            } else {
+                alsa_set_buffer_periods(audio_poll_mode ? POLL_BUFFER_PERIODS
+                                                        : ALSA_DEFAULT_BUFFER_PERIODS);
+            }
+
+            if (fixed_device_rate && audio_device_rate == fixed_device_rate) {
+                alsa_setup_persistent(audio_device_rate, audio_stream->channels);
+                // The last song's tail delays this one's first frame by
+                // up to a buffer. Locked, the LED timeline follows the
+                // audio clock past it; free-running, it starts with the
+                // audio thread and would lead the sound: drop the tail.
+                if (!avclock_lock_enabled()) {
+                    snd_pcm_drop(pcm);
+                    snd_pcm_prepare(pcm);
+                }
+            } else {
+                alsa_close();  // Device possibly still open at the fixed rate
+                setup_alsa(audio_device_rate, audio_stream->channels);
+            }
+
+            // Latency after the ALSA pointer, which the audio clock cannot see
+            if (sync_offset_manual) {
+                sync_offset_us = sync_offset_manual_us;
+                sync_offset_source = "manual";
+            } else if (calibration_lookup(alsa_device_name(), &sync_cal) == 0) {
+                sync_offset_us = sync_cal.offset_us;
+                sync_offset_source = "calibrated";
+            }
+            if (strcmp(sync_offset_source, "none") != 0)
+                printf("Sync offset: %+.1f ms (%s, %s)\n", sync_offset_us / 1000.0,
+                       sync_offset_source, alsa_device_name());
+            if (alsa_mmap_active)
+                printf("ALSA access: mmap (zero-copy)\n");
 
 	    // initialize mixer on default card, "PCM" control
 	    if (init_mixer("default", "PCM") == 0) {
 		set_hw_volume(100);    // 100% system volume
 	    }
-
-            // Start decoder thread (for MP3) or prepare stream
-            if (audio_start(audio_stream) < 0) {
-                fprintf(stderr, "Failed to start audio stream, continuing with LED only\n");
-                audio_close(audio_stream);
-                audio_stream = NULL;
-                has_audio = 0;
-            }
         }
     } else {
         printf("No audio file found, playing LED pattern only\n");
@@ -496,6 +1481,129 @@ void play_song(const char *base_name) {
 
     pthread_t audio_thread, led_thread;
 
+    // Brightness levels: the PWM thread modulates, the LED thread feeds it
+    int pwm_active = 0;
+    if (show.frames) {
+        pwm_active = pwm_start() == 0;
+        if (pwm_active)
+            printf("PWM: %u Hz, %d levels\n", pwm_frequency(), PWM_MAX_LEVEL + 1);
+        else {
+            fprintf(stderr, "Failed to start PWM thread, brightness shown as on/off\n");
+            show.frames = NULL;
+        }
+    }
+
+    // WS2812 strip: encoded and sent off the LED thread
+    int pixels_active = 0;
+    if (pixels_enabled()) {
+        pixels_active = pixels_start(&show) == 0;
+        if (pixels_active)
+            printf("Pixels: WS2812 via %s encoder\n", ws2812_backend());
+        else
+            fprintf(stderr, "Failed to start pixel output, strip disabled for this song\n");
+    }
+
+    int recording = recorder_enabled() && recorder_start(base_name, pattern_file, &show) == 0;
+
+    // Gated start: an armed instant (--start-at, UDP arm) or the one the
+    // multi-node leader announced, converted to CLOCK_MONOTONIC now. It
+    // becomes the song's shared timeline, which netsync_leader_ns() maps
+    // to itself without sync. A step of the system clock after arming is
+    // not followed.
+    int64_t armed_ns = 0;
+    song_offset_us = offset_us;
+    if (armed) {
+        struct timespec mono, real;
+        clock_gettime(CLOCK_MONOTONIC, &mono);
+        clock_gettime(CLOCK_REALTIME, &real);
+        armed_ns = timespec_to_ns(mono) + (timespec_to_ns(armed_at) - timespec_to_ns(real));
+
+        char when[32];
+        struct tm tm;
+        localtime_r(&armed_at.tv_sec, &tm);
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+        printf("Armed for %s.%06ld\n", when, armed_at.tv_nsec / 1000);
+    }
+    int64_t start_ns = armed_ns;
+    if (netsync_role() != NETSYNC_OFF) {
+        // The leader announces an armed start; followers take the leader's
+        if (netsync_song_start(base_name, show.total_us, &song_offset_us, &start_ns) == 0)
+            shared_timeline = 1;
+        else if (!stop_requested)
+            fprintf(stderr, "No start from the sync leader, playing on the local clock\n");
+    } else if (armed_ns) {
+        shared_timeline = 1;
+    }
+
+    // A node that comes in late seeks to where the timeline is (the audio
+    // clock trims what the preparation took)
+    if (shared_timeline) {
+        // The timeline is song time 0, the offset before the instant
+        shared_start_ns = start_ns - (int64_t)song_offset_us * 1000;
+        int64_t at_ns = netsync_local_ns(start_ns);
+        start_gate = (struct timespec){ .tv_sec = at_ns / 1000000000LL,
+                                        .tv_nsec = at_ns % 1000000000LL };
+        start_gated = 1;
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t late_us = (timespec_to_ns(now) - at_ns) / 1000;
+        if (late_us > 0) {
+            printf("Started %.1f ms late, joining the timeline\n", late_us / 1000.0);
+            song_offset_us += late_us;
+        }
+    }
+
+    // Mid-song: position the audio before its decoder starts and find the
+    // first cue, both without reading what comes before
+    if (song_offset_us > 0) {
+        char when[32];
+        format_timecode(when, sizeof(when), song_offset_us);
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        int seeked = 1;
+        if (has_audio) {
+            size_t frame = (size_t)(song_offset_us * audio_stream->sample_rate / 1000000);
+            seeked = audio_seek(audio_stream, frame) == 0;
+            audio_seek_frames = (int64_t)((uint64_t)frame * audio_device_rate /
+                                          audio_stream->sample_rate);
+        }
+        led_first_cue = show_find(&show, song_offset_us);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        seek_ms = time_diff_ns(t0, t1) / 1e6;
+        printf("Starting at %s (seek %.2f ms)\n", when, seek_ms);
+
+        // Nothing left to hear (or no way there): the LEDs go on alone
+        if (has_audio && (!seeked || audio_finished(audio_stream))) {
+            if (!seeked)
+                fprintf(stderr, "Cannot seek the audio to %s, continuing with LED only\n", when);
+            drop_audio();
+            has_audio = 0;
+        }
+        if (!has_audio && song_offset_us >= show.total_us)
+            fprintf(stderr, "Offset %s is past the end of '%s'\n", when, base_name);
+    }
+
+    if (has_audio) {
+        // Remaining length at the device rate drives the end fade
+        uint64_t device_frames = (uint64_t)audio_stream->total_frames *
+                                 audio_device_rate / audio_stream->sample_rate;
+        dsp_song_start(audio_device_rate, device_frames > (uint64_t)audio_seek_frames ?
+                                          device_frames - audio_seek_frames : 0);
+
+        // Start decoder thread (for MP3) or prepare stream
+        if (audio_start(audio_stream) < 0) {
+            fprintf(stderr, "Failed to start audio stream, continuing with LED only\n");
+            drop_audio();
+            has_audio = 0;
+        }
+    }
+
+    avclock_song_start(has_audio ? audio_device_rate : 0);
+
+    if (start_gated && has_audio)
+        audio_preroll();
+    threads_known = 0;
+
     struct sched_param audio_param = {.sched_priority = 75};
     struct sched_param led_param   = {.sched_priority = 80};
 
@@ -509,7 +1617,18 @@ void play_song(const char *base_name) {
     if (rc != 0) {
         fprintf(stderr, "Warning: Failed to create LED thread with SCHED_FIFO (rc=%d), trying default\n", rc);
         pthread_attr_init(&led_attr);
-        pthread_create(&led_thread, &led_attr, led_thread_fn, NULL);
+        rc = pthread_create(&led_thread, &led_attr, led_thread_fn, NULL);
+    }
+    int led_started = rc == 0;
+
+    // No LED thread, no song: nothing runs, nothing is waited for
+    if (!led_started) {
+        fprintf(stderr, "Failed to create LED thread (rc=%d), skipping '%s'\n", rc, base_name);
+        start_gated = 0;
+        if (has_audio) {
+            drop_audio();
+            has_audio = 0;
+        }
     }
 
     if (has_audio) {
@@ -519,23 +1638,76 @@ void play_song(const char *base_name) {
         pthread_attr_setschedpolicy(&audio_attr, SCHED_FIFO);
         pthread_attr_setschedparam(&audio_attr, &audio_param);
 
-        rc = pthread_create(&audio_thread, &audio_attr, audio_thread_fn, NULL);
+        void *(*audio_fn)(void *) =
+            audio_poll_mode ? audio_thread_poll_fn : audio_thread_fn;
+
+        rc = pthread_create(&audio_thread, &audio_attr, audio_fn, NULL);
         if (rc != 0) {
             fprintf(stderr, "Warning: Failed to create audio thread with SCHED_FIFO (rc=%d), trying default\n", rc);
             pthread_attr_init(&audio_attr);
-            pthread_create(&audio_thread, &audio_attr, audio_thread_fn, NULL);
+            rc = pthread_create(&audio_thread, &audio_attr, audio_fn, NULL);
         }
+        if (rc != 0) {
+            fprintf(stderr, "Failed to create audio thread (rc=%d), continuing with LED only\n", rc);
+            drop_audio();
+            has_audio = 0;
+            avclock_song_start(0);
+        }
+    }
+
+    // Release the threads that did start, sized to them
+    if (start_gated)
+        pthread_barrier_init(&start_barrier, NULL, 1 + led_started + has_audio);
+    pthread_mutex_lock(&threads_lock);
+    threads_known = 1;
+    pthread_cond_broadcast(&threads_cond);
+    pthread_mutex_unlock(&threads_lock);
+
+    // Both RT threads parked: everything up to the first frame is done
+    if (start_gated) {
+        pthread_barrier_wait(&start_barrier);
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        start_ready_ms = (timespec_to_ns(start_gate) - timespec_to_ns(now)) / 1e6;
+        if (start_ready_ms > 0)
+            printf("Ready %.1f ms before the start\n", start_ready_ms);
+    }
+
+    if (has_audio) {
         pthread_join(audio_thread, NULL);
+
+        if (latency_adaptive_enabled())
+            latency_song_end();
     }
 
-    pthread_join(led_thread, NULL);
+    if (led_started)
+        pthread_join(led_thread, NULL);
+    if (start_gated)
+        pthread_barrier_destroy(&start_barrier);
+
+    PwmStats pwm_stats = {0};
+    if (pwm_active) {
+        pwm_stop();
+        pwm_get_stats(&pwm_stats);
+    }
+
+    if (recording)
+        recorder_stop();
+
+    PixelStats pixel_stats = {0};
+    if (pixels_active) {
+        pixels_stop();
+        pixels_get_stats(&pixel_stats);
+    }
 
     // Only turn off LEDs if auto_off_mode is enabled (-o flag)
     if (auto_off_mode) {
-        gpio_all_off(led_lines, 8);
+        output_all_off();
     }
 
-    if (has_audio) {
+    // With a fixed device rate the device stays open for the next song;
+    // its queued tail keeps playing meanwhile
+    if (has_audio && !(fixed_device_rate && audio_device_rate == fixed_device_rate)) {
         alsa_close();
     }
 
@@ -549,10 +1721,34 @@ void play_song(const char *base_name) {
     // Print stats summary if verbose mode (-v flag)
     print_stats(has_audio, duration_sec);
 
+    // Followers report to the leader, which prints the inter-node skew
+    NetSyncStats netsync_stats;
+    if (shared_timeline) {
+        if (timeline.cues > 0)
+            timeline.led_avg_us /= timeline.cues;
+        if (timeline_audio_count > 0)
+            timeline.audio_avg_us /= timeline_audio_count;
+        netsync_song_end(&timeline);
+        netsync_get_stats(&netsync_stats);
+    }
+    if (verbose_mode && pwm_active) {
+        printf("PWM thread:    %.1f Hz (target %u, cpu %d), duty error avg=%.3f%% max=%.3f%%, %llu late slots\n",
+               pwm_stats.achieved_hz, pwm_stats.target_hz, pwm_stats.cpu,
+               pwm_stats.duty_err_avg, pwm_stats.duty_err_max,
+               (unsigned long long)pwm_stats.late_slots);
+    }
+    if (verbose_mode && pixels_active) {
+        printf("Pixels:        %u px, %llu frames (%llu cues merged), encode avg=%.1f us, write avg=%.1f us max=%.1f us\n",
+               pixel_stats.pixels, (unsigned long long)pixel_stats.frames,
+               (unsigned long long)pixel_stats.merged_cues, pixel_stats.encode_avg_us,
+               pixel_stats.write_avg_us, pixel_stats.write_max_us);
+    }
+
 #ifdef ENABLE_TRACE
     // Save full CSV report when compiled with ENABLE_TRACE=1
     {
         PlaybackStats stats = {0};
+        AvClockStats avclock_stats;
 
         // Audio stats
         if (has_audio) {
@@ -561,25 +1757,82 @@ void play_song(const char *base_name) {
             stats.audio_wake_interval_us = audio_wake_interval_us;
             stats.audio_buffer_frames = audio_buffer_frames;
             stats.alsa_delay_frames = alsa_delay_frames;
+            stats.audio_dsp_ns = audio_dsp_ns;
+            stats.dsp_gain_db = dsp_gain_db();
+            stats.dsp_limiter = dsp_limiter_enabled();
+            stats.dsp_limited_samples = dsp_limited_samples();
             stats.audio_samples = audio_sample_index;
             stats.underrun_count = underrun_count;
             stats.buffer_stall_count = buffer_stall_count;
-            stats.audio_format = audio_stream->format == AUDIO_FORMAT_MP3 ? "MP3" : "WAV";
+            stats.audio_format = audio_format_name(audio_stream);
             stats.sample_rate = audio_stream->sample_rate;
             stats.channels = audio_stream->channels;
+            stats.device_rate = audio_device_rate;
+            stats.resampler = resampler ? resample_quality_name(resample_quality) : "off";
+            stats.alsa_access = alsa_mmap_active ? "MMAP" : "RW";
+            stats.audio_mode = audio_poll_mode ? "POLL" : "TIMER";
+            stats.audio_wake_target_us = audio_poll_mode ?
+                AUDIO_PERIOD_MS * 1000 : AUDIO_THREAD_PERIOD_MS * 1000;
+            stats.audio_wakeups = audio_wakeup_count;
+            if (first_sample_time.tv_sec != 0)
+                stats.time_to_first_sample_ms =
+                    time_diff_us(playback_start_time, first_sample_time) / 1000.0;
+            stats.audio_locked_peak_bytes = audio_peak_locked_bytes(audio_stream);
+            avclock_get_stats(&avclock_stats, led_audio_locked);
+            stats.avclock = &avclock_stats;
+            stats.sync_offset_us = sync_offset_us;
+            stats.sync_offset_source = sync_offset_source;
+            if (strcmp(sync_offset_source, "calibrated") == 0)
+                stats.calibration = &sync_cal;
+            if (latency_adaptive_enabled()) {
+                stats.latency_adaptive = 1;
+                stats.latency_decisions = latency_decisions(&stats.latency_decision_count);
+                stats.latency_target_periods = latency_target_periods();
+                stats.latency_buffer_periods = latency_buffer_periods();
+            }
         } else {
             stats.audio_format = "NONE";
             stats.sample_rate = 0;
             stats.channels = 0;
         }
 
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+            stats.peak_rss_kb = usage.ru_maxrss;
+
         // GPIO stats
         stats.gpio_write_ns = gpio_write_ns;
         stats.gpio_jitter_ns = gpio_jitter_ns;
         stats.gpio_samples = gpio_timing_index;
+        stats.led_wakeups = led_wakeup_count;
+        stats.led_channels = led_count;
+        stats.gpio_banks = show.banks;
+        stats.output_backend = output_name();
+        if (led_precise) {
+            stats.led_spin_ns = led_spin_ns;
+            stats.led_margin_ns = led_margin_ns;
+            stats.led_late_wakes = led_late_wakes;
+        }
+        output_sim_log(NULL, &stats.output_commits);
+        stats.output_failures = output_failures(&stats.output_errno);
+        if (pwm_active)
+            stats.pwm = &pwm_stats;
+        if (pixels_active)
+            stats.pixels = &pixel_stats;
+        if (shared_timeline && netsync_stats.role != NETSYNC_OFF)
+            stats.netsync = &netsync_stats;
+        if (start_gated) {
+            stats.start_gated = 1;
+            stats.start_ready_ms = start_ready_ms;
+            stats.start_audio_us = start_audio_us;
+            stats.start_led_us = start_led_us;
+        }
+        stats.start_offset_us = song_offset_us;
+        stats.seek_ms = seek_ms;
+        stats.first_cue = led_first_cue;
 
         // General info
-        stats.pattern_count = pattern_count;
+        stats.pattern_count = show.source_cues;
         stats.playback_duration_sec = duration_sec;
 
         save_playback_report(report_file, &stats);
@@ -590,6 +1843,9 @@ void play_song(const char *base_name) {
         audio_close(audio_stream);
         audio_stream = NULL;
     }
+    resampler_free(resampler);
+    resampler = NULL;
+    show_free(&show);
 
     printf("Playback finished for '%s'.\n", base_name);
 }
@@ -0,0 +1,229 @@
+#include "predecode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <mpg123.h>
+#include <syslog.h>
+
+// MPEG frames decoded and discarded before each segment. Layer III can
+// reference up to 511 bytes of earlier frames (bit reservoir) and the
+// synthesis filterbank needs history, so a few frames fully prime it.
+#define PREDECODE_OVERLAP_FRAMES 4
+#define PREDECODE_MAX_WORKERS    16
+
+typedef struct {
+    const char *filename;
+    off_t *index;             // Shared frame index from the scan
+    off_t index_step;
+    size_t index_fill;
+    off_t start_frame;        // MPEG frame where this segment begins
+    off_t first_sample;       // PCM frame offset of the segment
+    off_t end_sample;         // One past the last PCM frame
+    int16_t *out;             // Whole-song buffer
+    uint16_t channels;
+    int error;
+} SegmentJob;
+
+static mpg123_handle *open_handle(const char *filename, long *rate) {
+    int err;
+    mpg123_handle *mh = mpg123_new(NULL, &err);
+    if (!mh) {
+        fprintf(stderr, "mpg123_new: %s\n", mpg123_plain_strerror(err));
+        return NULL;
+    }
+
+    // Same output setup as the streaming decoder: 16-bit, forced stereo
+    mpg123_param(mh, MPG123_FLAGS, MPG123_FORCE_STEREO, 0);
+    mpg123_param(mh, MPG123_ADD_FLAGS, MPG123_QUIET, 0);
+
+    if (mpg123_open(mh, filename) != MPG123_OK) {
+        fprintf(stderr, "mpg123_open: %s\n", mpg123_strerror(mh));
+        mpg123_delete(mh);
+        return NULL;
+    }
+
+    int channels, encoding;
+    if (mpg123_getformat(mh, rate, &channels, &encoding) != MPG123_OK) {
+        fprintf(stderr, "mpg123_getformat: %s\n", mpg123_strerror(mh));
+        mpg123_close(mh);
+        mpg123_delete(mh);
+        return NULL;
+    }
+
+    mpg123_format_none(mh);
+    mpg123_format(mh, *rate, MPG123_STEREO, MPG123_ENC_SIGNED_16);
+    return mh;
+}
+
+static void *segment_worker(void *arg) {
+    SegmentJob *job = arg;
+    long rate;
+    mpg123_handle *mh = open_handle(job->filename, &rate);
+    if (!mh) {
+        job->error = 1;
+        return NULL;
+    }
+
+    // Reuse the scan's index so seeks are exact without rescanning
+    if (job->index_fill > 0)
+        mpg123_set_index(mh, job->index, job->index_step, job->index_fill);
+
+    off_t seek_frame = job->start_frame - PREDECODE_OVERLAP_FRAMES;
+    if (seek_frame < 0) seek_frame = 0;
+
+    if (mpg123_seek_frame(mh, seek_frame, SEEK_SET) < 0) {
+        syslog(LOG_ERR, "predecode seek: %s", mpg123_strerror(mh));
+        job->error = 1;
+        mpg123_close(mh);
+        mpg123_delete(mh);
+        return NULL;
+    }
+
+    // pos tracks the PCM frame of the next decoded sample
+    off_t pos = mpg123_tell(mh);
+    const size_t frame_bytes = job->channels * sizeof(int16_t);
+    const size_t chunk_frames = 4096;
+    int16_t *buf = malloc(chunk_frames * frame_bytes);
+
+    while (buf && pos < job->end_sample) {
+        size_t done = 0;
+        int ret = mpg123_read(mh, (unsigned char *)buf, chunk_frames * frame_bytes, &done);
+        if (ret != MPG123_OK && ret != MPG123_NEW_FORMAT && ret != MPG123_DONE) {
+            syslog(LOG_ERR, "predecode read: %s", mpg123_strerror(mh));
+            job->error = 1;
+            break;
+        }
+
+        off_t got = done / frame_bytes;
+        off_t from = pos, to = pos + got;
+
+        // Keep only [first_sample, end_sample): drops the priming overlap
+        // and whatever belongs to the next segment
+        if (from < job->first_sample) from = job->first_sample;
+        if (to > job->end_sample) to = job->end_sample;
+        if (to > from) {
+            memcpy(&job->out[from * job->channels],
+                   &buf[(from - pos) * job->channels],
+                   (to - from) * frame_bytes);
+        }
+        pos += got;
+
+        if (ret == MPG123_DONE || (ret == MPG123_OK && done == 0))
+            break;
+    }
+
+    free(buf);
+    mpg123_close(mh);
+    mpg123_delete(mh);
+    return NULL;
+}
+
+int predecode_mp3(const char *filename, int workers, PredecodedPcm *out) {
+    memset(out, 0, sizeof(*out));
+    mpg123_init();
+
+    if (workers <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > 0 ? (int)cpus : 1;
+    }
+    if (workers > PREDECODE_MAX_WORKERS) workers = PREDECODE_MAX_WORKERS;
+
+    long rate;
+    mpg123_handle *mh = open_handle(filename, &rate);
+    if (!mh)
+        return -1;
+
+    // Full scan: exact length and a complete frame index for seeking
+    if (mpg123_scan(mh) != MPG123_OK) {
+        fprintf(stderr, "mpg123_scan: %s\n", mpg123_strerror(mh));
+        goto fail;
+    }
+
+    off_t total = mpg123_length(mh);
+    off_t mpeg_frames = mpg123_framelength(mh);
+    if (total <= 0 || mpeg_frames <= 0) {
+        fprintf(stderr, "predecode: cannot determine length of %s\n", filename);
+        goto fail;
+    }
+    if (workers > mpeg_frames) workers = (int)mpeg_frames;
+
+    off_t *index = NULL, step = 0;
+    size_t fill = 0;
+    mpg123_index(mh, &index, &step, &fill);
+
+    out->channels = 2;
+    out->sample_rate = (uint32_t)rate;
+    out->frames = (size_t)total;
+    out->bytes = out->frames * out->channels * sizeof(int16_t);
+    out->pcm = mmap(NULL, out->bytes, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (out->pcm == MAP_FAILED) {
+        perror("mmap predecode buffer");
+        out->pcm = NULL;
+        goto fail;
+    }
+
+    // Frame-aligned segment boundaries and their PCM offsets, taken from
+    // the same decoder so gapless trimming is accounted for identically
+    SegmentJob jobs[PREDECODE_MAX_WORKERS];
+    for (int k = 0; k < workers; k++) {
+        off_t frame = mpeg_frames * k / workers;
+        off_t sample = 0;
+        if (k > 0) {
+            if (mpg123_seek_frame(mh, frame, SEEK_SET) < 0)
+                goto fail_unmap;
+            sample = mpg123_tell(mh);
+        }
+        jobs[k] = (SegmentJob){
+            .filename = filename, .index = index, .index_step = step,
+            .index_fill = fill, .start_frame = frame, .first_sample = sample,
+            .out = out->pcm, .channels = out->channels,
+        };
+    }
+    for (int k = 0; k < workers; k++)
+        jobs[k].end_sample = (k + 1 < workers) ? jobs[k + 1].first_sample : total;
+
+    pthread_t threads[PREDECODE_MAX_WORKERS];
+    int started = 0;
+    for (int k = 0; k < workers; k++) {
+        if (pthread_create(&threads[k], NULL, segment_worker, &jobs[k]) != 0) {
+            jobs[k].error = 1;
+            break;
+        }
+        started++;
+    }
+    for (int k = 0; k < started; k++)
+        pthread_join(threads[k], NULL);
+
+    int failed = started < workers;
+    for (int k = 0; k < workers; k++)
+        failed |= jobs[k].error;
+    if (failed)
+        goto fail_unmap;
+
+    mpg123_close(mh);
+    mpg123_delete(mh);
+
+    // Pin the decoded song like a WAV so playback never page-faults
+    if (mlock(out->pcm, out->bytes) != 0)
+        perror("mlock predecode buffer (continuing anyway)");
+
+    return 0;
+
+fail_unmap:
+    munmap(out->pcm, out->bytes);
+    out->pcm = NULL;
+fail:
+    mpg123_close(mh);
+    mpg123_delete(mh);
+    return -1;
+}
+
+void predecode_free(PredecodedPcm *pcm) {
+    if (pcm->pcm)
+        munmap(pcm->pcm, pcm->bytes);
+    memset(pcm, 0, sizeof(*pcm));
+}
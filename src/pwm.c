@@ -0,0 +1,224 @@
+#define _GNU_SOURCE
+#include "pwm.h"
+#include "gpio.h"
+#include "output.h"
+#include "player.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+// Slots shorter than this (and the tail of longer ones) are busy-waited
+#define PWM_SPIN_NS  60000L
+
+static unsigned int pwm_hz = PWM_DEFAULT_HZ;
+static int pwm_cpu_request = -1;
+
+static pthread_t pwm_thread;
+static atomic_int running = 0;
+static _Atomic(const PwmFrame *) next_frame = NULL;
+static const PwmFrame *last_frame = NULL;   // Last frame shown
+static long spin_ns = 0;
+
+// Stats, written by the PWM thread only, read after join
+static PwmStats stats;
+static double duty_err_sum;
+
+void pwm_set_frequency(unsigned int hz) {
+    if (hz > 0)
+        pwm_hz = hz;
+}
+
+unsigned int pwm_frequency(void) {
+    return pwm_hz;
+}
+
+void pwm_set_cpu(int cpu) {
+    pwm_cpu_request = cpu;
+}
+
+void pwm_build_frame(PwmFrame *frame, const uint8_t *levels, int count,
+                     const unsigned int *lines) {
+    uint64_t led_mask = gpio_pins_mask(lines, count);
+    for (int b = 0; b < PWM_BITS; b++) {
+        uint64_t set = 0;
+        for (int i = 0; i < count; i++) {
+            if ((levels[i] >> b) & 1)
+                set |= 1ull << lines[i];
+        }
+        uint64_t clr = led_mask & ~set;
+        frame->slot[b] = (PwmSlot){
+            { (uint32_t)set, (uint32_t)(set >> 32) },
+            { (uint32_t)clr, (uint32_t)(clr >> 32) },
+        };
+    }
+}
+
+void pwm_set_frame(const PwmFrame *frame) {
+    atomic_store_explicit(&next_frame, frame, memory_order_release);
+}
+
+static inline void write_slot(const PwmSlot *s) {
+    output_commit(s->set, s->clr);
+}
+
+static inline int64_t ts_ns(struct timespec t) {
+    return (int64_t)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+static inline struct timespec ns_ts(int64_t ns) {
+    return (struct timespec){ .tv_sec = ns / 1000000000LL, .tv_nsec = ns % 1000000000LL };
+}
+
+static inline int64_t now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return ts_ns(t);
+}
+
+// Sleep until shortly before the deadline, then spin the rest
+static void wait_until(int64_t deadline) {
+    if (deadline - now_ns() > spin_ns) {
+        struct timespec t = ns_ts(deadline - spin_ns);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL);
+    }
+    while (spin_ns && now_ns() < deadline)
+        ;
+}
+
+// Actual slot lengths against their binary weights, for one period
+static void account_period(const int64_t *written, int64_t end) {
+    double period = (double)(end - written[0]);
+    if (period <= 0)
+        return;
+
+    double err = 0;
+    for (int b = 0; b < PWM_BITS; b++) {
+        int64_t slot_end = b + 1 < PWM_BITS ? written[b + 1] : end;
+        double d = (slot_end - written[b]) / period - (double)(1 << b) / PWM_MAX_LEVEL;
+        err += d < 0 ? -d : d;
+    }
+    err *= 100.0;
+    duty_err_sum += err;
+    if (err > stats.duty_err_max)
+        stats.duty_err_max = err;
+    stats.periods++;
+}
+
+static void *pwm_thread_fn(void *arg) {
+    const int64_t unit_ns = 1000000000LL / pwm_hz / PWM_MAX_LEVEL;
+    int64_t written[PWM_BITS], prev[PWM_BITS];
+    int64_t busy_ns = 0;    // Length of the accounted periods
+    int have_prev = 0;
+    const PwmFrame *frame = NULL;
+
+    int64_t t = now_ns();
+    while (atomic_load_explicit(&running, memory_order_acquire) && !stop_requested) {
+        // New frames only at period boundaries
+        frame = atomic_load_explicit(&next_frame, memory_order_acquire);
+        if (!frame) {
+            // Nothing to show yet: idle one period, no GPIO writes
+            t += unit_ns * PWM_MAX_LEVEL;
+            wait_until(t);
+            continue;
+        }
+        last_frame = frame;
+
+        // Fell more than a period behind (preempted): restart from now
+        // rather than rushing through the missed slots
+        int64_t now = now_ns();
+        if (now - t > unit_ns * PWM_MAX_LEVEL) {
+            t = now;
+            have_prev = 0;
+        }
+
+        int64_t slot_start = t;
+        for (int b = 0; b < PWM_BITS; b++) {
+            wait_until(slot_start);
+            if (stop_requested)
+                return NULL;
+            now = now_ns();
+            if (now - slot_start > unit_ns / 2)
+                stats.late_slots++;
+            write_slot(&frame->slot[b]);
+            written[b] = now;
+            slot_start += unit_ns << b;
+        }
+
+        // The previous period ended where this one started
+        if (have_prev) {
+            account_period(prev, written[0]);
+            busy_ns += written[0] - prev[0];
+        }
+        memcpy(prev, written, sizeof(prev));
+        have_prev = 1;
+
+        t = slot_start;
+        if (busy_ns > 0)
+            stats.achieved_hz = stats.periods * 1e9 / (double)busy_ns;
+    }
+    return NULL;
+}
+
+int pwm_start(void) {
+    memset(&stats, 0, sizeof(stats));
+    duty_err_sum = 0;
+    last_frame = NULL;
+    atomic_store(&next_frame, NULL);
+    stats.target_hz = pwm_hz;
+    stats.cpu = -1;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    // Spinning is only affordable with a core to spare
+    spin_ns = cpus > 1 ? PWM_SPIN_NS : 0;
+
+    atomic_store(&running, 1);
+
+    struct sched_param param = {.sched_priority = PWM_PRIORITY};
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    pthread_attr_setschedparam(&attr, &param);
+
+    int cpu = pwm_cpu_request >= 0 ? pwm_cpu_request : (int)cpus - 1;
+    if (cpus > 1 && cpu >= 0 && cpu < cpus) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (pthread_attr_setaffinity_np(&attr, sizeof(set), &set) == 0)
+            stats.cpu = cpu;
+    }
+
+    int rc = pthread_create(&pwm_thread, &attr, pwm_thread_fn, NULL);
+    if (rc != 0) {
+        fprintf(stderr, "Warning: Failed to create PWM thread with SCHED_FIFO (rc=%d), trying default\n", rc);
+        stats.cpu = -1;
+        pthread_attr_init(&attr);
+        rc = pthread_create(&pwm_thread, &attr, pwm_thread_fn, NULL);
+    }
+    if (rc != 0) {
+        atomic_store(&running, 0);
+        return -1;
+    }
+    return 0;
+}
+
+void pwm_stop(void) {
+    if (!atomic_exchange(&running, 0))
+        return;
+    pthread_join(pwm_thread, NULL);
+
+    // Hold the last frame as plain on/off: its MSB slot is level >= 128
+    if (last_frame && !stop_requested && output_ready())
+        write_slot(&last_frame->slot[PWM_BITS - 1]);
+}
+
+void pwm_get_stats(PwmStats *out) {
+    *out = stats;
+    out->duty_err_avg = stats.periods ? duty_err_sum / stats.periods : 0;
+}
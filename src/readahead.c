@@ -0,0 +1,150 @@
+#include "readahead.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <syslog.h>
+
+// How often the reader thread checks the play position
+#define READAHEAD_POLL_MS 10
+
+struct ReadAhead {
+    uint8_t *base;            // Page-aligned mapping
+    size_t size;
+    size_t data_offset;       // Offset of PCM data in the mapping
+    size_t bytes_per_frame;
+    atomic_size_t *position;  // Frames consumed (written by audio thread)
+    size_t window;            // Bytes kept locked ahead of the position
+    size_t step;              // Refill/release granularity
+    size_t page;
+
+    size_t locked_start;      // [locked_start, locked_end) is resident
+    size_t locked_end;
+    atomic_size_t peak_locked; // Read by the player while the thread runs
+    int mlock_ok;
+
+    pthread_t thread;
+    atomic_int stop;
+};
+
+static size_t page_down(const ReadAhead *ra, size_t off) {
+    return off - off % ra->page;
+}
+
+static size_t page_up(const ReadAhead *ra, size_t off) {
+    size_t up = page_down(ra, off + ra->page - 1);
+    return up > ra->size ? ra->size : up;
+}
+
+// Fault [start, end) in and pin it. If mlock is not permitted we still
+// prefetch and touch every page so the audio thread rarely faults.
+static void lock_range(ReadAhead *ra, size_t start, size_t end) {
+    if (end <= start) return;
+    madvise(ra->base + start, end - start, MADV_WILLNEED);
+
+    if (ra->mlock_ok && mlock(ra->base + start, end - start) != 0) {
+        syslog(LOG_WARNING, "readahead mlock failed, prefetch only");
+        ra->mlock_ok = 0;
+    }
+    if (!ra->mlock_ok) {
+        volatile uint8_t sink = 0;
+        for (size_t off = start; off < end; off += ra->page)
+            sink ^= ra->base[off];
+        (void)sink;
+    }
+}
+
+static void release_range(ReadAhead *ra, size_t start, size_t end) {
+    if (end <= start) return;
+    if (ra->mlock_ok)
+        munlock(ra->base + start, end - start);
+    madvise(ra->base + start, end - start, MADV_DONTNEED);
+}
+
+static void update_window(ReadAhead *ra) {
+    size_t pos = ra->data_offset +
+                 atomic_load_explicit(ra->position, memory_order_relaxed) *
+                 ra->bytes_per_frame;
+    size_t want_start = page_down(ra, pos);
+    size_t want_end = page_up(ra, pos + ra->window);
+
+    if (want_start < ra->locked_start || want_start >= ra->locked_end) {
+        // Position jumped outside the window: start over
+        release_range(ra, ra->locked_start, ra->locked_end);
+        lock_range(ra, want_start, want_end);
+        ra->locked_start = want_start;
+        ra->locked_end = want_end;
+    } else {
+        // Slide in step-sized chunks to keep the syscall count low
+        if (want_end >= ra->locked_end + ra->step || want_end == ra->size) {
+            lock_range(ra, ra->locked_end, want_end);
+            ra->locked_end = want_end > ra->locked_end ? want_end : ra->locked_end;
+        }
+        if (want_start >= ra->locked_start + ra->step) {
+            release_range(ra, ra->locked_start, want_start);
+            ra->locked_start = want_start;
+        }
+    }
+
+    size_t locked = ra->locked_end - ra->locked_start;
+    if (locked > atomic_load_explicit(&ra->peak_locked, memory_order_relaxed))
+        atomic_store_explicit(&ra->peak_locked, locked, memory_order_relaxed);
+}
+
+static void *readahead_thread(void *arg) {
+    ReadAhead *ra = arg;
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = READAHEAD_POLL_MS * 1000000L };
+
+    while (!atomic_load(&ra->stop)) {
+        update_window(ra);
+        nanosleep(&ts, NULL);
+    }
+    return NULL;
+}
+
+ReadAhead *readahead_start(void *mapping, size_t mapping_size,
+                           const void *data, size_t bytes_per_frame,
+                           atomic_size_t *position, size_t window_bytes) {
+    ReadAhead *ra = calloc(1, sizeof(ReadAhead));
+    if (!ra) return NULL;
+
+    ra->base = mapping;
+    ra->size = mapping_size;
+    ra->data_offset = (const uint8_t *)data - (const uint8_t *)mapping;
+    ra->bytes_per_frame = bytes_per_frame;
+    ra->position = position;
+    ra->page = (size_t)sysconf(_SC_PAGESIZE);
+    ra->window = window_bytes < 4 * ra->page ? 4 * ra->page : window_bytes;
+    ra->step = page_down(ra, ra->window / 4);
+    ra->mlock_ok = 1;
+    atomic_init(&ra->stop, 0);
+
+    // First window before playback starts: this is the startup cost now
+    ra->locked_start = 0;
+    ra->locked_end = page_up(ra, ra->data_offset + ra->window);
+    lock_range(ra, ra->locked_start, ra->locked_end);
+    atomic_init(&ra->peak_locked, ra->locked_end);
+
+    if (pthread_create(&ra->thread, NULL, readahead_thread, ra) != 0) {
+        perror("pthread_create readahead");
+        release_range(ra, ra->locked_start, ra->locked_end);
+        free(ra);
+        return NULL;
+    }
+    return ra;
+}
+
+void readahead_stop(ReadAhead *ra) {
+    if (!ra) return;
+    atomic_store(&ra->stop, 1);
+    pthread_join(ra->thread, NULL);
+    if (ra->mlock_ok)
+        munlock(ra->base + ra->locked_start, ra->locked_end - ra->locked_start);
+    free(ra);
+}
+
+size_t readahead_peak_locked(const ReadAhead *ra) {
+    return ra ? atomic_load_explicit(&ra->peak_locked, memory_order_relaxed) : 0;
+}
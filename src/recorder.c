@@ -0,0 +1,386 @@
+#include "recorder.h"
+#include "output.h"
+#include "gpio.h"
+#include "load.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+#define REC_RING_SIZE     8192      // Records, power of two (~0.3 MB)
+#define REC_FLUSH_MS      50
+#define REC_LATE_NS       1000000L  // Analyzer: "late" above 1 ms
+
+typedef struct {
+    char     magic[8];          // REC_MAGIC
+    uint32_t version;
+    uint32_t header_size;
+    int64_t  start_mono_ns;     // LED timeline start (song time 0), CLOCK_MONOTONIC
+    int64_t  start_real_ns;     // Same instant, CLOCK_REALTIME
+    uint64_t total_us;          // Show length
+    uint64_t records;
+    uint64_t dropped;           // Ring overflows (writer fell behind)
+    uint32_t flags;
+    uint32_t cue_count;         // Show records at recording time
+    uint32_t pin_count;
+    uint32_t first_cue;         // Started mid-show: cues before it were skipped
+    uint32_t pin_map[LED_MAX_CHANNELS];
+    char     pattern_path[REC_PATH_MAX];
+} RecHeader;
+
+_Static_assert(sizeof(RecHeader) % 8 == 0, "records must stay 8-byte aligned");
+_Static_assert(sizeof(RecRecord) == 32, "RecRecord is part of the file format");
+
+static const char *rec_path = NULL;
+static int rec_levels = 0;
+
+static FILE *rec_file;
+static RecHeader rec_header;
+static RecRecord *rec_ring;
+static _Alignas(64) atomic_size_t rec_head;   // LED thread
+static _Alignas(64) atomic_size_t rec_tail;   // Writer thread
+static uint64_t rec_dropped;                  // LED thread only
+static struct timespec rec_start;
+static atomic_int rec_running = 0;
+static pthread_t rec_thread;
+
+void recorder_configure(const char *path, int read_levels) {
+    rec_path = path;
+    rec_levels = read_levels;
+}
+
+int recorder_enabled(void) {
+    return rec_path != NULL;
+}
+
+// --------------------------------------------------------------
+// Recording
+// --------------------------------------------------------------
+static size_t drain(void) {
+    size_t head = atomic_load_explicit(&rec_head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&rec_tail, memory_order_relaxed);
+    size_t n = head - tail;
+    while (tail != head) {
+        size_t pos = tail & (REC_RING_SIZE - 1);
+        size_t chunk = REC_RING_SIZE - pos;
+        if (chunk > head - tail)
+            chunk = head - tail;
+        fwrite(&rec_ring[pos], sizeof(RecRecord), chunk, rec_file);
+        tail += chunk;
+    }
+    atomic_store_explicit(&rec_tail, tail, memory_order_release);
+    rec_header.records += n;
+    return n;
+}
+
+static void *writer_thread_fn(void *arg) {
+    const struct timespec period = { 0, REC_FLUSH_MS * 1000000L };
+    while (atomic_load(&rec_running)) {
+        nanosleep(&period, NULL);
+        drain();
+    }
+    return NULL;
+}
+
+int recorder_start(const char *song, const char *pattern_file, const Show *show) {
+    if (!rec_path)
+        return -1;
+
+    char path[REC_PATH_MAX];
+    struct stat st;
+    int n;
+    if (stat(rec_path, &st) == 0 && S_ISDIR(st.st_mode))
+        n = snprintf(path, sizeof(path), "%s/%s.rec", rec_path, song);
+    else
+        n = snprintf(path, sizeof(path), "%s", rec_path);
+    if (n < 0 || (size_t)n >= sizeof(path))
+        return -1;
+
+    if (!rec_ring && !(rec_ring = calloc(REC_RING_SIZE, sizeof(RecRecord))))
+        return -1;
+    rec_file = fopen(path, "wb");
+    if (!rec_file) {
+        perror(path);
+        return -1;
+    }
+
+    memset(&rec_header, 0, sizeof(rec_header));
+    memcpy(rec_header.magic, REC_MAGIC, sizeof(REC_MAGIC));
+    rec_header.version = REC_VERSION;
+    rec_header.header_size = sizeof(RecHeader);
+    rec_header.total_us = show->total_us;
+    rec_header.cue_count = show->count;
+    rec_header.flags = (rec_levels ? REC_FLAG_LEVELS : 0) | (show->frames ? REC_FLAG_DIMMED : 0);
+    rec_header.pin_count = (uint32_t)led_count;
+    for (int i = 0; i < led_count; i++)
+        rec_header.pin_map[i] = led_lines[i];
+    if (realpath(pattern_file, rec_header.pattern_path) == NULL)
+        snprintf(rec_header.pattern_path, sizeof(rec_header.pattern_path), "%s", pattern_file);
+
+    // Placeholder; the final header (counts, start time) is written at stop
+    fwrite(&rec_header, sizeof(rec_header), 1, rec_file);
+
+    atomic_store(&rec_head, 0);
+    atomic_store(&rec_tail, 0);
+    rec_dropped = 0;
+    atomic_store(&rec_running, 1);
+    if (pthread_create(&rec_thread, NULL, writer_thread_fn, NULL) != 0) {
+        atomic_store(&rec_running, 0);
+        fclose(rec_file);
+        rec_file = NULL;
+        return -1;
+    }
+    printf("Recording output timeline to %s%s\n", path, rec_levels ? " (with level readback)" : "");
+    return 0;
+}
+
+void recorder_timeline_start(struct timespec start, uint32_t first_cue) {
+    rec_start = start;
+    rec_header.first_cue = first_cue;
+}
+
+void recorder_commit(uint32_t cue, struct timespec when, const uint32_t set[2], int failed) {
+    if (!atomic_load_explicit(&rec_running, memory_order_relaxed))
+        return;
+    size_t head = atomic_load_explicit(&rec_head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&rec_tail, memory_order_acquire);
+    if (head - tail >= REC_RING_SIZE) {
+        rec_dropped++;
+        return;
+    }
+
+    RecRecord *r = &rec_ring[head & (REC_RING_SIZE - 1)];
+    r->t_ns = (uint64_t)((when.tv_sec - rec_start.tv_sec) * 1000000000LL +
+                         (when.tv_nsec - rec_start.tv_nsec));
+    r->cue = cue;
+    r->set[0] = set[0];
+    r->set[1] = set[1];
+    r->flags = failed ? REC_FLAG_FAILED : 0;
+    r->level[0] = r->level[1] = 0;
+    if (rec_levels) {
+        output_read_levels(r->level);
+        r->flags |= REC_FLAG_LEVELS;
+    }
+    atomic_store_explicit(&rec_head, head + 1, memory_order_release);
+}
+
+void recorder_stop(void) {
+    if (!atomic_exchange(&rec_running, 0))
+        return;
+    pthread_join(rec_thread, NULL);
+    drain();
+
+    // Map the monotonic start onto the wall clock for the header
+    struct timespec mono, real;
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    clock_gettime(CLOCK_REALTIME, &real);
+    rec_header.start_mono_ns = (int64_t)rec_start.tv_sec * 1000000000LL + rec_start.tv_nsec;
+    rec_header.start_real_ns = (int64_t)real.tv_sec * 1000000000LL + real.tv_nsec -
+                               ((int64_t)mono.tv_sec * 1000000000LL + mono.tv_nsec -
+                                rec_header.start_mono_ns);
+    rec_header.dropped = rec_dropped;
+    fseek(rec_file, 0, SEEK_SET);
+    fwrite(&rec_header, sizeof(rec_header), 1, rec_file);
+    fclose(rec_file);
+    rec_file = NULL;
+
+    printf("Recorded %llu commits", (unsigned long long)rec_header.records);
+    if (rec_dropped)
+        printf(", %llu dropped (ring full)", (unsigned long long)rec_dropped);
+    printf("\n");
+}
+
+// --------------------------------------------------------------
+// Analyzer
+// --------------------------------------------------------------
+static int cmp_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64_t words64(const uint32_t w[2]) {
+    return (uint64_t)w[1] << 32 | w[0];
+}
+
+int recorder_analyze(const char *path, const char *pattern_file) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    RecHeader h;
+    if (fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, REC_MAGIC, sizeof(REC_MAGIC)) != 0 ||
+        h.version != REC_VERSION || h.header_size != sizeof(RecHeader) ||
+        h.pin_count == 0 || h.pin_count > LED_MAX_CHANNELS) {
+        fprintf(stderr, "%s: not a recording (or another version)\n", path);
+        fclose(f);
+        return -1;
+    }
+    // The map indexes GPIO masks below: same checks as --pins
+    if (gpio_set_pin_lines(h.pin_map, (int)h.pin_count) != 0) {
+        fprintf(stderr, "%s: bad pin map in the recording\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    size_t cap = h.records ? h.records : 1, n = 0;
+    RecRecord *recs = malloc(cap * sizeof(RecRecord));
+    if (recs)
+        n = fread(recs, sizeof(RecRecord), cap, f);
+    fclose(f);
+    if (!recs)
+        return -1;
+    if (n < h.records)
+        fprintf(stderr, "%s: truncated, %zu of %llu records\n", path, n, (unsigned long long)h.records);
+
+    // Intended timeline: the same records the player built, same pin map
+    // (installed with the header checks)
+    h.pattern_path[REC_PATH_MAX - 1] = '\0';
+    if (!pattern_file)
+        pattern_file = h.pattern_path;
+    Show show;
+    if (show_load(pattern_file, &show) != 0) {
+        fprintf(stderr, "Cannot load pattern file %s\n", pattern_file);
+        free(recs);
+        return -1;
+    }
+    if (show.count != h.cue_count)
+        printf("Warning: %s now has %u changes, %u when recorded\n",
+               pattern_file, show.count, h.cue_count);
+
+    uint64_t pins = gpio_pins_mask(led_lines, led_count);
+    uint32_t *seen = calloc(show.count + 1, sizeof(uint32_t));
+    int64_t *late = calloc(show.count + 1, sizeof(int64_t));
+    int64_t *sorted = malloc((show.count + 1) * sizeof(int64_t));
+    uint8_t *pins_bad = calloc(show.count + 1, 1);
+    if (!seen || !late || !sorted || !pins_bad) {
+        free(seen); free(late); free(sorted); free(pins_bad); free(recs);
+        show_free(&show);
+        return -1;
+    }
+
+    size_t unknown = 0, duplicated = 0, out_of_order = 0, mask_bad = 0, level_bad = 0;
+    size_t write_failed = 0;
+    uint32_t last_cue = 0;
+    uint64_t prev_t = 0;
+    int levels_checked = (h.flags & REC_FLAG_LEVELS) && !(h.flags & REC_FLAG_DIMMED);
+    for (size_t i = 0; i < n; i++) {
+        const RecRecord *r = &recs[i];
+        if (r->cue >= show.count) {
+            unknown++;
+            continue;
+        }
+        if (r->t_ns < prev_t)
+            out_of_order++;
+        prev_t = r->t_ns;
+        if (seen[r->cue]++) {
+            duplicated++;
+            continue;
+        }
+        if (r->cue > last_cue)
+            last_cue = r->cue;
+
+        const ShowCue *cue = &show.cues[r->cue];
+        late[r->cue] = (int64_t)r->t_ns - (int64_t)cue->abs_time_us * 1000;
+        if (r->flags & REC_FLAG_FAILED) {
+            // The words never reached the pins, whatever they were
+            write_failed++;
+            pins_bad[r->cue] = 1;
+        } else if (words64(r->set) != words64(cue->gpset_mask)) {
+            mask_bad++;
+            pins_bad[r->cue] = 1;
+        } else if (levels_checked && (r->flags & REC_FLAG_LEVELS) &&
+                   (words64(r->level) & pins) != (words64(cue->gpset_mask) & pins)) {
+            level_bad++;
+            pins_bad[r->cue] = 1;
+        }
+    }
+
+    // Lateness over the committed cues; drift as a least-squares slope
+    size_t missed = 0, not_reached = 0, m = 0, late_cues = 0;
+    uint32_t first_cue = h.first_cue < show.count ? h.first_cue : 0;
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    int64_t worst = 0;
+    uint32_t worst_cue = 0;
+    for (uint32_t c = first_cue; c < show.count; c++) {
+        if (!seen[c]) {
+            if (n > 0 && c < last_cue) missed++;
+            else not_reached++;
+            continue;
+        }
+        sorted[m++] = late[c];
+        if (llabs(late[c]) > REC_LATE_NS)
+            late_cues++;
+        if (llabs(late[c]) >= llabs(worst)) {
+            worst = late[c];
+            worst_cue = c;
+        }
+        double x = show.cues[c].abs_time_us / 1e6, y = late[c] / 1e3;
+        sx += x; sy += y; sxx += x * x; sxy += x * y;
+    }
+
+    printf("%s: %zu commits for %u cues (%s, %.3f s)\n", path, n, show.count,
+           pattern_file, show.total_us / 1e6);
+    if (h.dropped)
+        printf("  Dropped by the recorder: %llu\n", (unsigned long long)h.dropped);
+    if (first_cue > 0) {
+        char from[32];
+        format_timecode(from, sizeof(from), show.cues[first_cue].abs_time_us);
+        printf("  Started at:     cue %u (%s), %u before it not played\n",
+               first_cue, from, first_cue);
+    }
+    if (m > 0) {
+        qsort(sorted, m, sizeof(int64_t), cmp_i64);
+        double sum = 0;
+        for (size_t i = 0; i < m; i++)
+            sum += sorted[i];
+        char when[32];
+        format_timecode(when, sizeof(when), show.cues[worst_cue].abs_time_us);
+        printf("  Lateness:       min=%.1f avg=%.1f p50=%.1f p99=%.1f max=%.1f us\n",
+               sorted[0] / 1e3, sum / m / 1e3, sorted[m / 2] / 1e3,
+               sorted[m * 99 / 100] / 1e3, sorted[m - 1] / 1e3);
+        printf("  Worst cue:      #%u at %s, %+.1f us\n", worst_cue, when, worst / 1e3);
+        printf("  Late > %ld ms:    %zu\n", REC_LATE_NS / 1000000, late_cues);
+        double denom = m * sxx - sx * sx;
+        if (m > 1 && denom > 0) {
+            double slope = (m * sxy - sx * sy) / denom;   // us per s
+            printf("  Drift:          %+.2f ppm (%+.1f us over the show)\n",
+                   slope, slope * show.cues[show.count - 1].abs_time_us / 1e6);
+        }
+    }
+    printf("  Missed:         %zu", missed);
+    if (not_reached)
+        printf(" (+%zu not reached, recording ended at cue %u)", not_reached, last_cue);
+    printf("\n  Duplicated:     %zu%s\n", duplicated,
+           unknown ? " (plus records for cues not in the show)" : "");
+    printf("  Wrong pins:     %zu written, %zu read back%s\n", mask_bad, level_bad,
+           levels_checked ? "" : " (no level readback)");
+    if (write_failed)
+        printf("  Output failed:  %zu commits rejected by the backend\n", write_failed);
+    if (out_of_order)
+        printf("  Out of order:   %zu\n", out_of_order);
+
+    // Per-cue detail next to the recording
+    char csv[REC_PATH_MAX + 8];
+    snprintf(csv, sizeof(csv), "%s.csv", path);
+    FILE *out = fopen(csv, "w");
+    if (out) {
+        fprintf(out, "cue,time_us,commits,lateness_us,pins_ok\n");
+        for (uint32_t c = 0; c < show.count; c++)
+            fprintf(out, "%u,%llu,%u,%.3f,%d\n", c, (unsigned long long)show.cues[c].abs_time_us,
+                    seen[c], seen[c] ? late[c] / 1e3 : 0.0, !pins_bad[c]);
+        fclose(out);
+        printf("  Per-cue detail: %s\n", csv);
+    }
+
+    int failed = missed || duplicated || unknown || mask_bad || level_bad || write_failed ||
+                 h.dropped;
+    printf("  Result:         %s\n", failed ? "FAIL" : "OK");
+
+    free(seen); free(late); free(sorted); free(pins_bad); free(recs);
+    show_free(&show);
+    return failed ? 1 : 0;
+}
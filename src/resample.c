@@ -0,0 +1,298 @@
+#include "resample.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RESAMPLE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define RESAMPLE_SSE2 1
+#endif
+
+#define RESAMPLE_HIGH_TAPS   32     // Per phase; multiple of 8 for the SIMD loop
+#define RESAMPLE_KAISER_BETA 8.0    // ~80 dB stopband
+#define RESAMPLE_ROLLOFF     0.92   // Passband edge, fraction of the lower Nyquist
+#define RESAMPLE_CHUNK       1024   // Input frames pulled per refill
+
+struct Resampler {
+    unsigned L, M;            // out/in ratio reduced to L/M
+    unsigned taps;
+    ResampleQuality quality;
+    int16_t *coeffs;          // L phases x taps, Q15, reversed for a forward dot product
+
+    // Planar input history: [pos, fill) not yet fully consumed
+    int16_t *left, *right;
+    size_t cap, fill, pos;
+    unsigned phase;           // Output position between input pos and pos+1, in 1/L
+
+    int16_t *scratch;         // Interleaved input chunk from the source
+    int finished;
+};
+
+static unsigned gcd(unsigned a, unsigned b) {
+    while (b) {
+        unsigned t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        double f = x / (2.0 * k);
+        term *= f * f;
+        sum += term;
+    }
+    return sum;
+}
+
+static int16_t clamp_s16(int32_t v) {
+    if (v > 32767) return 32767;
+    if (v < -32768) return -32768;
+    return (int16_t)v;
+}
+
+// Kaiser-windowed sinc, sampled at each phase's fractional offset and
+// normalized so every phase has unity DC gain. Tap i multiplies
+// history[pos + i]; phase p produces the output at pos + taps/2 - 1 + p/L.
+static void design_sinc(Resampler *r) {
+    const unsigned L = r->L, taps = r->taps;
+    const double half = taps / 2.0;
+    const double cut = (L < r->M ? (double)L / r->M : 1.0) * RESAMPLE_ROLLOFF;
+    const double i0_beta = bessel_i0(RESAMPLE_KAISER_BETA);
+    double h[RESAMPLE_HIGH_TAPS];
+
+    for (unsigned p = 0; p < L; p++) {
+        double sum = 0;
+        for (unsigned i = 0; i < taps; i++) {
+            double t = (double)i - (half - 1) - (double)p / L;  // In input samples
+            double x = M_PI * cut * t;
+            double sinc = fabs(x) < 1e-9 ? 1.0 : sin(x) / x;
+            double w = t / half;
+            double win = bessel_i0(RESAMPLE_KAISER_BETA * sqrt(fmax(0.0, 1.0 - w * w))) / i0_beta;
+            h[i] = cut * sinc * win;
+            sum += h[i];
+        }
+        for (unsigned i = 0; i < taps; i++)
+            r->coeffs[p * taps + i] = clamp_s16((int32_t)lrint(h[i] / sum * 32768.0));
+    }
+}
+
+// Linear interpolation: only the Q15 fraction of each phase is stored
+static void design_linear(Resampler *r) {
+    for (unsigned p = 0; p < r->L; p++) {
+        r->coeffs[p * 2] = 0;
+        r->coeffs[p * 2 + 1] = (int16_t)((p * 32768u) / r->L);
+    }
+}
+
+Resampler *resampler_create(uint32_t in_rate, uint32_t out_rate, ResampleQuality quality) {
+    if (in_rate == 0 || out_rate == 0) return NULL;
+
+    unsigned g = gcd(in_rate, out_rate);
+    unsigned L = out_rate / g, M = in_rate / g;
+    if (L > RESAMPLE_MAX_PHASES) {
+        fprintf(stderr, "Resampler: %u -> %u Hz needs %u phases (max %d)\n",
+                in_rate, out_rate, L, RESAMPLE_MAX_PHASES);
+        return NULL;
+    }
+
+    Resampler *r = calloc(1, sizeof(Resampler));
+    if (!r) return NULL;
+
+    r->L = L;
+    r->M = M;
+    r->quality = quality;
+    r->taps = quality == RESAMPLE_HIGH ? RESAMPLE_HIGH_TAPS : 2;
+    r->cap = RESAMPLE_CHUNK + 2 * r->taps;
+
+    // 16-byte aligned so every phase row (taps * 2 bytes) is aligned too
+    size_t coeff_bytes = ((size_t)L * r->taps * sizeof(int16_t) + 15) & ~(size_t)15;
+    size_t hist_bytes = (r->cap * sizeof(int16_t) + 15) & ~(size_t)15;
+    r->coeffs = aligned_alloc(16, coeff_bytes);
+    r->left = aligned_alloc(16, hist_bytes);
+    r->right = aligned_alloc(16, hist_bytes);
+    r->scratch = malloc(RESAMPLE_CHUNK * 2 * sizeof(int16_t));
+    if (!r->coeffs || !r->left || !r->right || !r->scratch) {
+        resampler_free(r);
+        return NULL;
+    }
+
+    if (quality == RESAMPLE_HIGH)
+        design_sinc(r);
+    else
+        design_linear(r);
+
+    // Prime with silence so output frame 0 lines up with input frame 0
+    r->fill = r->taps / 2 - 1;
+    memset(r->left, 0, r->fill * sizeof(int16_t));
+    memset(r->right, 0, r->fill * sizeof(int16_t));
+    return r;
+}
+
+void resampler_free(Resampler *r) {
+    if (!r) return;
+    free(r->coeffs);
+    free(r->left);
+    free(r->right);
+    free(r->scratch);
+    free(r);
+}
+
+// ----------------------------------------------------------------------------
+// Kernels
+// ----------------------------------------------------------------------------
+
+static inline void dot_stereo(const int16_t *l, const int16_t *rt, const int16_t *c,
+                              unsigned taps, int32_t *out_l, int32_t *out_r) {
+#if defined(RESAMPLE_NEON)
+    int32x4_t al = vdupq_n_s32(0), ar = vdupq_n_s32(0);
+    for (unsigned k = 0; k < taps; k += 8) {
+        int16x8_t cv = vld1q_s16(c + k);
+        int16x8_t lv = vld1q_s16(l + k), rv = vld1q_s16(rt + k);
+        al = vmlal_s16(al, vget_low_s16(lv), vget_low_s16(cv));
+        al = vmlal_s16(al, vget_high_s16(lv), vget_high_s16(cv));
+        ar = vmlal_s16(ar, vget_low_s16(rv), vget_low_s16(cv));
+        ar = vmlal_s16(ar, vget_high_s16(rv), vget_high_s16(cv));
+    }
+    int32x2_t sl = vadd_s32(vget_low_s32(al), vget_high_s32(al));
+    int32x2_t sr = vadd_s32(vget_low_s32(ar), vget_high_s32(ar));
+    int32x2_t s = vpadd_s32(sl, sr);
+    *out_l = vget_lane_s32(s, 0);
+    *out_r = vget_lane_s32(s, 1);
+#elif defined(RESAMPLE_SSE2)
+    __m128i al = _mm_setzero_si128(), ar = _mm_setzero_si128();
+    for (unsigned k = 0; k < taps; k += 8) {
+        __m128i cv = _mm_load_si128((const __m128i *)(c + k));
+        al = _mm_add_epi32(al, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(l + k)), cv));
+        ar = _mm_add_epi32(ar, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(rt + k)), cv));
+    }
+    // Horizontal sums of both accumulators at once
+    __m128i lo = _mm_unpacklo_epi32(al, ar);    // l0 r0 l1 r1
+    __m128i hi = _mm_unpackhi_epi32(al, ar);    // l2 r2 l3 r3
+    __m128i s = _mm_add_epi32(lo, hi);
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    *out_l = _mm_cvtsi128_si32(s);
+    *out_r = _mm_cvtsi128_si32(_mm_shuffle_epi32(s, _MM_SHUFFLE(1, 1, 1, 1)));
+#else
+    int32_t sl = 0, sr = 0;
+    for (unsigned k = 0; k < taps; k++) {
+        sl += (int32_t)l[k] * c[k];
+        sr += (int32_t)rt[k] * c[k];
+    }
+    *out_l = sl;
+    *out_r = sr;
+#endif
+}
+
+static size_t produce(Resampler *r, int16_t *out, size_t frames) {
+    size_t n = 0;
+
+    if (r->quality == RESAMPLE_FAST) {
+        while (n < frames && r->pos + 2 <= r->fill) {
+            int32_t frac = r->coeffs[r->phase * 2 + 1];
+            const int16_t *l = r->left + r->pos, *rt = r->right + r->pos;
+            out[2 * n]     = (int16_t)(l[0] + (((l[1] - l[0]) * frac + (1 << 14)) >> 15));
+            out[2 * n + 1] = (int16_t)(rt[0] + (((rt[1] - rt[0]) * frac + (1 << 14)) >> 15));
+            n++;
+            for (r->phase += r->M; r->phase >= r->L; r->phase -= r->L)
+                r->pos++;
+        }
+        return n;
+    }
+
+    while (n < frames && r->pos + r->taps <= r->fill) {
+        int32_t acc_l, acc_r;
+        dot_stereo(r->left + r->pos, r->right + r->pos,
+                   r->coeffs + (size_t)r->phase * r->taps, r->taps, &acc_l, &acc_r);
+        out[2 * n]     = clamp_s16((acc_l + (1 << 14)) >> 15);
+        out[2 * n + 1] = clamp_s16((acc_r + (1 << 14)) >> 15);
+        n++;
+        for (r->phase += r->M; r->phase >= r->L; r->phase -= r->L)
+            r->pos++;
+    }
+    return n;
+}
+
+// ----------------------------------------------------------------------------
+// Streaming
+// ----------------------------------------------------------------------------
+
+int resampler_read(Resampler *r, int16_t *out, size_t frames,
+                   ResampleSource source, void *ctx) {
+    size_t produced = 0;
+
+    while (produced < frames) {
+        produced += produce(r, out + 2 * produced, frames - produced);
+        if (produced == frames || r->finished)
+            break;
+
+        // Keep only the history still needed, then pull more input
+        if (r->pos > 0) {
+            size_t keep = r->fill > r->pos ? r->fill - r->pos : 0;
+            memmove(r->left, r->left + r->pos, keep * sizeof(int16_t));
+            memmove(r->right, r->right + r->pos, keep * sizeof(int16_t));
+            r->fill = keep;
+            r->pos = 0;
+        }
+
+        size_t want = r->cap - r->fill;
+        if (want > RESAMPLE_CHUNK) want = RESAMPLE_CHUNK;
+
+        int got = source(ctx, r->scratch, want);
+        if (got < 0) {
+            // Flush the filter tail with silence
+            size_t pad = r->taps / 2;
+            memset(r->left + r->fill, 0, pad * sizeof(int16_t));
+            memset(r->right + r->fill, 0, pad * sizeof(int16_t));
+            r->fill += pad;
+            r->finished = 1;
+            continue;
+        }
+        if (got == 0)
+            break;
+
+        for (int i = 0; i < got; i++) {
+            r->left[r->fill + i] = r->scratch[2 * i];
+            r->right[r->fill + i] = r->scratch[2 * i + 1];
+        }
+        r->fill += got;
+    }
+
+    if (produced == 0 && r->finished)
+        return -1;
+    return (int)produced;
+}
+
+size_t resampler_output_frames(const Resampler *r, size_t in_frames) {
+    size_t have = (r->fill > r->pos ? r->fill - r->pos : 0) + in_frames;
+    if (have < r->taps)
+        return 0;
+    return (size_t)(((uint64_t)(have - r->taps + 1) * r->L) / r->M);
+}
+
+unsigned resampler_taps(const Resampler *r) {
+    return r ? r->taps : 0;
+}
+
+const char *resample_quality_name(ResampleQuality quality) {
+    return quality == RESAMPLE_HIGH ? "high" : "fast";
+}
+
+int resample_quality_from_name(const char *name, ResampleQuality *out) {
+    if (strcasecmp(name, "high") == 0) {
+        *out = RESAMPLE_HIGH;
+        return 0;
+    }
+    if (strcasecmp(name, "fast") == 0) {
+        *out = RESAMPLE_FAST;
+        return 0;
+    }
+    return -1;
+}
@@ -0,0 +1,84 @@
+#include "ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+int ring_init(SpscRing *ring, size_t capacity) {
+    size_t cap = 1;
+    while (cap < capacity)
+        cap <<= 1;
+
+    ring->data = calloc(cap, sizeof(int16_t));
+    if (!ring->data)
+        return -1;
+
+    ring->capacity = cap;
+    ring->mask = cap - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return 0;
+}
+
+void ring_free(SpscRing *ring) {
+    free(ring->data);
+    ring->data = NULL;
+    ring->capacity = 0;
+    ring->mask = 0;
+}
+
+size_t ring_used(SpscRing *ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return head - tail;
+}
+
+size_t ring_space(SpscRing *ring) {
+    return ring->capacity - ring_used(ring);
+}
+
+// Producer side: only this thread stores head
+size_t ring_write(SpscRing *ring, const int16_t *src, size_t count) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    size_t space = ring->capacity - (head - tail);
+    if (count > space) count = space;
+    if (count == 0) return 0;
+
+    size_t pos = head & ring->mask;
+    size_t first_chunk = ring->capacity - pos;
+    if (first_chunk > count) first_chunk = count;
+
+    memcpy(&ring->data[pos], src, first_chunk * sizeof(int16_t));
+    if (count > first_chunk) {
+        memcpy(&ring->data[0], &src[first_chunk],
+               (count - first_chunk) * sizeof(int16_t));
+    }
+
+    // Publish the samples only after they are fully copied
+    atomic_store_explicit(&ring->head, head + count, memory_order_release);
+    return count;
+}
+
+// Consumer side: only this thread stores tail
+size_t ring_read(SpscRing *ring, int16_t *dst, size_t count) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    size_t used = head - tail;
+    if (count > used) count = used;
+    if (count == 0) return 0;
+
+    size_t pos = tail & ring->mask;
+    size_t first_chunk = ring->capacity - pos;
+    if (first_chunk > count) first_chunk = count;
+
+    memcpy(dst, &ring->data[pos], first_chunk * sizeof(int16_t));
+    if (count > first_chunk) {
+        memcpy(&dst[first_chunk], &ring->data[0],
+               (count - first_chunk) * sizeof(int16_t));
+    }
+
+    // Hand the slots back to the producer only after copying out
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    return count;
+}
@@ -2,11 +2,108 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 // Target period: 10ms worth of frames
 #define AUDIO_PERIOD_MS 10
 
 snd_pcm_t *pcm = NULL;
+int alsa_mmap_active = 0;
+snd_pcm_uframes_t alsa_buffer_frames = 0;
+
+static int alsa_mmap_requested = 0;
+static char device_name[128] = "";
+static unsigned int alsa_buffer_periods = ALSA_DEFAULT_BUFFER_PERIODS;
+
+// Configuration of the open device, so alsa_setup_persistent() can tell
+// whether it can be kept across songs
+static unsigned int open_rate, open_channels, open_periods;
+static int open_mmap_requested;
+
+void alsa_request_mmap(int enabled) {
+    alsa_mmap_requested = enabled;
+}
+
+void alsa_set_buffer_periods(unsigned int periods) {
+    alsa_buffer_periods = periods < 2 ? 2 : periods;
+}
+
+// Card name and device number of the open PCM (plugins like dmix report
+// the card they sit on), or the PCM name when there is no card
+static void read_device_name(void) {
+    snprintf(device_name, sizeof(device_name), "%s", snd_pcm_name(pcm));
+
+    snd_pcm_info_t *info;
+    if (snd_pcm_info_malloc(&info) != 0)
+        return;
+    if (snd_pcm_info(pcm, info) == 0) {
+        int card = snd_pcm_info_get_card(info);
+        char *card_name = NULL;
+        if (card >= 0 && snd_card_get_name(card, &card_name) == 0) {
+            snprintf(device_name, sizeof(device_name), "%s,%u",
+                     card_name, snd_pcm_info_get_device(info));
+            free(card_name);
+        }
+    }
+    snd_pcm_info_free(info);
+}
+
+void alsa_enable_tstamps(snd_pcm_t *p, snd_pcm_sw_params_t *sw_params) {
+    snd_pcm_sw_params_set_tstamp_mode(p, sw_params, SND_PCM_TSTAMP_ENABLE);
+    snd_pcm_sw_params_set_tstamp_type(p, sw_params, SND_PCM_TSTAMP_TYPE_MONOTONIC);
+}
+
+int alsa_hold_start(snd_pcm_t *p, int hold) {
+    static snd_pcm_uframes_t auto_threshold = 1;
+    snd_pcm_sw_params_t *sw_params;
+    int err = snd_pcm_sw_params_malloc(&sw_params);
+    if (err < 0)
+        return err;
+
+    snd_pcm_uframes_t threshold = auto_threshold;
+    err = snd_pcm_sw_params_current(p, sw_params);
+    if (err == 0 && hold) {
+        // Past the boundary the write pointer can never reach it
+        snd_pcm_sw_params_get_start_threshold(sw_params, &auto_threshold);
+        err = snd_pcm_sw_params_get_boundary(sw_params, &threshold);
+    }
+    if (err == 0)
+        err = snd_pcm_sw_params_set_start_threshold(p, sw_params, threshold);
+    if (err == 0)
+        err = snd_pcm_sw_params(p, sw_params);
+    snd_pcm_sw_params_free(sw_params);
+    return err;
+}
+
+const char *alsa_device_name(void) {
+    return device_name;
+}
+
+int alsa_stream_position(snd_pcm_t *p, snd_pcm_uframes_t buffer_frames,
+                         uint64_t frames_done, struct timespec *when, int64_t *pos) {
+    // Prepared but not started, the position does not move yet
+    if (snd_pcm_state(p) != SND_PCM_STATE_RUNNING)
+        return -1;
+
+    snd_pcm_sframes_t delay;
+    if (snd_pcm_delay(p, &delay) < 0)   // Also syncs the hw pointer
+        return -1;
+    clock_gettime(CLOCK_MONOTONIC, when);
+
+    int capture = snd_pcm_stream(p) == SND_PCM_STREAM_CAPTURE;
+    snd_pcm_uframes_t avail;
+    snd_htimestamp_t tstamp;
+    if (snd_pcm_htimestamp(p, &avail, &tstamp) == 0 && tstamp.tv_sec != 0 &&
+        avail <= buffer_frames) {
+        // Pointer and the time it was read as one pair: finer than the
+        // DMA bursts delay + clock_gettime() would see
+        delay = capture ? (snd_pcm_sframes_t)avail
+                        : (snd_pcm_sframes_t)(buffer_frames - avail);
+        *when = tstamp;
+    }
+    *pos = capture ? (int64_t)frames_done + delay : (int64_t)frames_done - delay;
+    return 0;
+}
 
 void setup_alsa(unsigned int sample_rate, unsigned int channels) {
     snd_pcm_hw_params_t *params;
@@ -17,20 +114,45 @@ void setup_alsa(unsigned int sample_rate, unsigned int channels) {
 
     snd_pcm_hw_params_malloc(&params);
     snd_pcm_hw_params_any(pcm, params);
-    snd_pcm_hw_params_set_access(pcm, params, SND_PCM_ACCESS_RW_INTERLEAVED);
+
+    // Prefer direct DMA-area access when requested; fall back to writei()
+    // if the device (or plugin chain) does not support it
+    alsa_mmap_active = 0;
+    if (alsa_mmap_requested) {
+        if (snd_pcm_hw_params_set_access(pcm, params,
+                                         SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0) {
+            alsa_mmap_active = 1;
+        } else {
+            fprintf(stderr, "ALSA mmap access not supported, using writei\n");
+        }
+    }
+    if (!alsa_mmap_active)
+        snd_pcm_hw_params_set_access(pcm, params, SND_PCM_ACCESS_RW_INTERLEAVED);
     snd_pcm_hw_params_set_format(pcm, params, SND_PCM_FORMAT_S16_LE);
     snd_pcm_hw_params_set_channels(pcm, params, channels);
     snd_pcm_hw_params_set_rate(pcm, params, sample_rate, 0);
 
     // Calculate period size based on sample rate (10ms worth of frames)
     snd_pcm_uframes_t period_frames = (sample_rate * AUDIO_PERIOD_MS) / 1000;
-    snd_pcm_uframes_t buffer_size = period_frames * 12;
+    snd_pcm_uframes_t buffer_size = period_frames * alsa_buffer_periods;
     snd_pcm_uframes_t period_size = period_frames;
     snd_pcm_hw_params_set_period_size_near(pcm, params, &period_size, 0);
     snd_pcm_hw_params_set_buffer_size_near(pcm, params, &buffer_size);
 
     snd_pcm_hw_params(pcm, params);
+    snd_pcm_hw_params_get_buffer_size(params, &buffer_size);
     snd_pcm_hw_params_free(params);
+    alsa_buffer_frames = buffer_size;
+
+    // Wake poll()/snd_pcm_wait() once a full period is free
+    snd_pcm_sw_params_t *sw_params;
+    snd_pcm_sw_params_malloc(&sw_params);
+    snd_pcm_sw_params_current(pcm, sw_params);
+    snd_pcm_sw_params_set_avail_min(pcm, sw_params, period_size);
+    alsa_enable_tstamps(pcm, sw_params);
+    snd_pcm_sw_params(pcm, sw_params);
+    snd_pcm_sw_params_free(sw_params);
+
     snd_pcm_prepare(pcm);
 
     // --- PRE-FILL ALSA BUFFER WITH SILENCE ---
@@ -38,7 +160,10 @@ void setup_alsa(unsigned int sample_rate, unsigned int channels) {
     if (silence) {
         // Write several silent periods to fully flush old data
         for (int i = 0; i < 4; i++) {
-            snd_pcm_writei(pcm, silence, period_frames);
+            if (alsa_mmap_active)
+                snd_pcm_mmap_writei(pcm, silence, period_frames);
+            else
+                snd_pcm_writei(pcm, silence, period_frames);
         }
         free(silence);
     }
@@ -46,6 +171,28 @@ void setup_alsa(unsigned int sample_rate, unsigned int channels) {
     // Re-prepare device again to reset buffer pointers
     snd_pcm_drop(pcm);
     snd_pcm_prepare(pcm);
+
+    read_device_name();
+    open_rate = sample_rate;
+    open_channels = channels;
+    open_periods = alsa_buffer_periods;
+    open_mmap_requested = alsa_mmap_requested;
+}
+
+void alsa_setup_persistent(unsigned int sample_rate, unsigned int channels) {
+    if (pcm && open_rate == sample_rate && open_channels == channels &&
+        open_periods == alsa_buffer_periods &&
+        open_mmap_requested == alsa_mmap_requested) {
+        // Same configuration: keep the device, and the tail of the previous
+        // song still queued in it, running. Only recover from an xrun.
+        snd_pcm_state_t state = snd_pcm_state(pcm);
+        if (state != SND_PCM_STATE_RUNNING && state != SND_PCM_STATE_PREPARED)
+            snd_pcm_prepare(pcm);
+        return;
+    }
+
+    alsa_close();
+    setup_alsa(sample_rate, channels);
 }
 
 void alsa_close(void) {
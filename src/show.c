@@ -0,0 +1,248 @@
+#include "show.h"
+#include "load.h"
+#include "gpio.h"
+#include "pwm.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SHOW_PATH_MAX 512
+
+typedef struct {
+    char     magic[8];          // SHOW_MAGIC
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t source_size;       // Pattern file this was compiled from
+    int64_t  source_mtime_sec;
+    int64_t  source_mtime_nsec;
+    uint32_t count;
+    uint32_t source_cues;
+    uint64_t total_us;
+    uint32_t frame_count;       // PWM frames after the cues: 0 or count
+    uint32_t reserved;
+    uint32_t pin_count;         // led_count and led_lines at compile time
+    uint32_t pin_map[LED_MAX_CHANNELS];
+} ShowHeader;
+
+_Static_assert(sizeof(ShowHeader) % 8 == 0, "records must stay 8-byte aligned");
+_Static_assert(sizeof(ShowCue) == 24, "ShowCue is part of the file format");
+_Static_assert(sizeof(PwmFrame) == 128, "PwmFrame is part of the file format");
+
+int show_compiled_path(const char *txt_path, char *out, size_t len) {
+    const char *slash = strrchr(txt_path, '/');
+    const char *ext = strrchr(txt_path, '.');
+    int base_len = (ext && (!slash || ext > slash)) ? (int)(ext - txt_path)
+                                                   : (int)strlen(txt_path);
+    int n = snprintf(out, len, "%.*s.show", base_len, txt_path);
+    return (n < 0 || (size_t)n >= len) ? -1 : 0;
+}
+
+static int same_pattern(int i, int j) {
+    if (pattern_dimmed)
+        return memcmp(pattern_levels[i], pattern_levels[j], PATTERN_MAX_CHANNELS) == 0;
+    return patterns[i].pattern == patterns[j].pattern;
+}
+
+// patterns[] -> GPIO words, plus PWM slot masks when frames is not NULL.
+// Repeated patterns produce no record, so the LED thread only wakes for
+// real changes.
+static uint32_t build_cues(ShowCue *out, PwmFrame *frames) {
+    uint64_t led_mask = gpio_pins_mask(led_lines, led_count);
+    int channels = led_count < PATTERN_MAX_CHANNELS ? led_count : PATTERN_MAX_CHANNELS;
+
+    uint32_t n = 0;
+    for (int i = 0; i < pattern_count; i++) {
+        if (i > 0 && same_pattern(i, i - 1))
+            continue;
+
+        if (frames)
+            pwm_build_frame(&frames[n], pattern_levels[i], channels, led_lines);
+
+        uint64_t set_mask = 0;
+        for (int j = 0; j < channels; ++j) {
+            if ((patterns[i].pattern >> j) & 1)
+                set_mask |= (1ull << led_lines[j]);
+        }
+        uint64_t clr_mask = led_mask & ~set_mask;
+        out[n++] = (ShowCue){
+            patterns[i].start_us,
+            { (uint32_t)set_mask, (uint32_t)(set_mask >> 32) },
+            { (uint32_t)clr_mask, (uint32_t)(clr_mask >> 32) },
+        };
+    }
+    return n;
+}
+
+static int pin_map_banks(void) {
+    return (gpio_pins_mask(led_lines, led_count) >> 32) ? 2 : 1;
+}
+
+static void fill_header(ShowHeader *h, const struct stat *src, uint32_t count,
+                        uint32_t frame_count) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, SHOW_MAGIC, sizeof(SHOW_MAGIC));
+    h->version = SHOW_VERSION;
+    h->header_size = sizeof(ShowHeader);
+    h->source_size = (uint64_t)src->st_size;
+    h->source_mtime_sec = (int64_t)src->st_mtim.tv_sec;
+    h->source_mtime_nsec = (int64_t)src->st_mtim.tv_nsec;
+    h->pin_count = (uint32_t)led_count;
+    for (int j = 0; j < led_count; ++j)
+        h->pin_map[j] = led_lines[j];
+    h->count = count;
+    h->source_cues = (uint32_t)pattern_count;
+    h->total_us = pattern_total_us;
+    h->frame_count = frame_count;
+}
+
+int show_compile(const char *txt_path) {
+    char out_path[SHOW_PATH_MAX], tmp_path[SHOW_PATH_MAX];
+    struct stat st;
+
+    if (stat(txt_path, &st) != 0) {
+        perror(txt_path);
+        return -1;
+    }
+    if (show_compiled_path(txt_path, out_path, sizeof(out_path)) != 0)
+        return -1;
+    int n = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%d", out_path, (int)getpid());
+    if (n < 0 || (size_t)n >= sizeof(tmp_path))
+        return -1;
+
+    load_patterns(txt_path);
+
+    static ShowCue cues[MAX_PATTERNS];
+    static PwmFrame frames[MAX_PATTERNS];
+    ShowHeader h;
+    uint32_t count = build_cues(cues, pattern_dimmed ? frames : NULL);
+    uint32_t frame_count = pattern_dimmed ? count : 0;
+    fill_header(&h, &st, count, frame_count);
+
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        perror(tmp_path);
+        return -1;
+    }
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+             fwrite(cues, sizeof(ShowCue), count, f) == count &&
+             fwrite(frames, sizeof(PwmFrame), frame_count, f) == frame_count;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp_path, out_path) != 0) {
+        perror(out_path);
+        unlink(tmp_path);
+        return -1;
+    }
+
+    printf("%s: %d cues -> %u records, %d channels%s, %.3f s\n", out_path, pattern_count,
+           count, led_count, frame_count ? " (dimmed)" : "", pattern_total_us / 1e6);
+    return 0;
+}
+
+// Map path if it is a valid, up-to-date compilation of src
+static int map_compiled(const char *path, const struct stat *src, Show *show) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShowHeader)) {
+        close(fd);
+        return -1;
+    }
+    void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return -1;
+
+    const ShowHeader *h = mapping;
+    int valid = memcmp(h->magic, SHOW_MAGIC, sizeof(SHOW_MAGIC)) == 0 &&
+                h->version == SHOW_VERSION &&
+                h->header_size == sizeof(ShowHeader) &&
+                (h->frame_count == 0 || h->frame_count == h->count) &&
+                (uint64_t)st.st_size == sizeof(ShowHeader) + (uint64_t)h->count * sizeof(ShowCue) +
+                                        (uint64_t)h->frame_count * sizeof(PwmFrame) &&
+                h->source_size == (uint64_t)src->st_size &&
+                h->source_mtime_sec == (int64_t)src->st_mtim.tv_sec &&
+                h->source_mtime_nsec == (int64_t)src->st_mtim.tv_nsec;
+    valid = valid && h->pin_count == (uint32_t)led_count;
+    for (int j = 0; valid && j < led_count; ++j)
+        valid = h->pin_map[j] == led_lines[j];
+    if (!valid) {
+        munmap(mapping, st.st_size);
+        return -1;
+    }
+
+    // Pin the cues, the LED thread must never fault on them
+    if (mlock(mapping, st.st_size) != 0)
+        perror("mlock show");
+
+    show->mapping = mapping;
+    show->mapping_size = st.st_size;
+    show->cues = (const ShowCue *)((const uint8_t *)mapping + sizeof(ShowHeader));
+    show->count = h->count;
+    if (h->frame_count)
+        show->frames = (const PwmFrame *)(show->cues + h->count);
+    show->source_cues = h->source_cues;
+    show->total_us = h->total_us;
+    show->banks = pin_map_banks();
+    show->compiled = 1;
+    return 0;
+}
+
+int show_load(const char *txt_path, Show *show) {
+    char path[SHOW_PATH_MAX];
+    struct stat st;
+
+    memset(show, 0, sizeof(*show));
+    if (stat(txt_path, &st) != 0)
+        return -1;
+
+    if (show_compiled_path(txt_path, path, sizeof(path)) == 0 &&
+        map_compiled(path, &st, show) == 0)
+        return 0;
+
+    // No usable .show: parse the text and build the same records in memory
+    load_patterns(txt_path);
+    size_t n = pattern_count ? pattern_count : 1;
+    show->owned = malloc(n * sizeof(ShowCue));
+    if (pattern_dimmed)
+        show->owned_frames = malloc(n * sizeof(PwmFrame));
+    if (!show->owned || (pattern_dimmed && !show->owned_frames)) {
+        show_free(show);
+        return -1;
+    }
+    show->count = build_cues(show->owned, show->owned_frames);
+    show->cues = show->owned;
+    show->frames = show->owned_frames;
+    show->source_cues = (uint32_t)pattern_count;
+    show->total_us = pattern_total_us;
+    show->banks = pin_map_banks();
+    return 0;
+}
+
+void show_free(Show *show) {
+    if (show->mapping) {
+        munlock(show->mapping, show->mapping_size);
+        munmap(show->mapping, show->mapping_size);
+    }
+    free(show->owned);
+    free(show->owned_frames);
+    memset(show, 0, sizeof(*show));
+}
+
+uint32_t show_find(const Show *show, uint64_t song_us) {
+    uint32_t lo = 0, hi = show->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (show->cues[mid].abs_time_us < song_us)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
@@ -41,13 +41,55 @@ int receive_udp_song(char *song_out, size_t len) {
         return -1;
     }
 
+    char cmd[16] = "", at[40];
+    p = strstr(buf, "\"cmd\"");
+    if (p && sscanf(p, "\"cmd\"%*[: ]\"%15[^\"]\"", cmd) != 1)
+        cmd[0] = '\0';
+
+    // {"cmd":"seek","song":"name","offset":90000} starts the song 90 s in,
+    // at once; an arm may carry an offset too (a restart mid-show)
+    double offset_ms = -1;
+    p = strstr(buf, "\"offset\"");
+    if (strcmp(cmd, "seek") == 0 || (strcmp(cmd, "arm") == 0 && p)) {
+        if (!p || sscanf(p, "\"offset\"%*[: \"]%lf", &offset_ms) != 1 || !(offset_ms >= 0)) {
+            fprintf(stderr, "Invalid or missing 'offset' in %s.\n", cmd);
+            close(sock);
+            return -1;
+        }
+    }
+
+    // {"cmd":"arm","song":"name","at":"1760644800.25"} (or "+seconds"):
+    // the song is prepared now and starts at that instant
+    int armed = 0;
+    if (strcmp(cmd, "arm") == 0) {
+        p = strstr(buf, "\"at\"");
+        if (!p || (sscanf(p, "\"at\"%*[: ]\"%39[^\"]\"", at) != 1 &&
+                   sscanf(p, "\"at\"%*[: ]%39[0-9.+]", at) != 1) ||
+            set_start_at(at) != 0) {
+            fprintf(stderr, "Invalid or missing 'at' in arm.\n");
+            close(sock);
+            return -1;
+        }
+        armed = 1;
+    }
+    if (offset_ms >= 0)
+        set_start_offset_ms(offset_ms);
+
     char ack[256];
-    snprintf(ack, sizeof(ack), "{\"ack\":\"ok\",\"song\":\"%s\"}", song_out);
+    if (armed)
+        snprintf(ack, sizeof(ack), "{\"ack\":\"armed\",\"song\":\"%s\",\"at\":\"%s\",\"offset\":%.0f}",
+                 song_out, at, offset_ms > 0 ? offset_ms : 0);
+    else if (offset_ms >= 0)
+        snprintf(ack, sizeof(ack), "{\"ack\":\"seek\",\"song\":\"%s\",\"offset\":%.0f}",
+                 song_out, offset_ms);
+    else
+        snprintf(ack, sizeof(ack), "{\"ack\":\"ok\",\"song\":\"%s\"}", song_out);
     sendto(sock, ack, strlen(ack), 0, (struct sockaddr *)&client, clen);
 
-    printf("Parsed song name: '%s'\n", song_out);
+    printf("Parsed song name: '%s'%s\n", song_out,
+           armed ? " (armed)" : offset_ms >= 0 ? " (seek)" : "");
     close(sock);
-    return 0;
+    return armed || offset_ms >= 0;
 }
 
 void emulate_udp_from_file(const char *filename) {
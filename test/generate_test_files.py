@@ -17,6 +17,7 @@ VOLUME = 1.0                    # 0.0 .. 1.0
 AUDIO_WAV_FILENAME = "test.wav"
 AUDIO_MP3_FILENAME = "test.mp3"
 CONTROL_FILENAME = "test.txt"
+MIXED_CONTROL_FILENAME = "test_mixed.txt"
 
 # Patterns to write in the control file for each tick (cycled)
 PATTERNS = [
@@ -81,6 +82,39 @@ def generate_control_file():
     print(f"Control file written: {CONTROL_FILENAME}")
 
 
+def format_timecode(ms):
+    return f"{ms // 60000:02d}:{ms // 1000 % 60:02d}.{ms % 1000:03d}"
+
+
+def generate_mixed_control_file():
+    """
+    Same ticks as the control file, alternating blocks of absolute cues and
+    legacy cues. Each legacy block is anchored by a bare @mm:ss.mmm line, so
+    every tick still lights exactly one LED, on the beat: a cue playing at
+    the wrong time or missing (zero-length) shows up against the clicks.
+    """
+    interval_samples = int(SAMPLE_RATE * INTERVAL_MS / 1000.0)
+    num_samples = int(DURATION_SECONDS * SAMPLE_RATE)
+    num_ticks = num_samples // interval_samples
+
+    pattern_cycle = itertools.cycle(PATTERNS)
+    block = len(PATTERNS)
+
+    with open(MIXED_CONTROL_FILENAME, "w", encoding="utf-8") as f:
+        for tick in range(num_ticks):
+            pattern = next(pattern_cycle)
+            at = tick * INTERVAL_MS
+            if (tick // block) % 2:
+                f.write(f"@{format_timecode(at)} {pattern}\n")
+            else:
+                if tick % block == 0:
+                    f.write(f"@{format_timecode(at)}\n")
+                f.write(f"{INTERVAL_MS:04d} {pattern}\n")
+        f.write(f"@{format_timecode(num_ticks * INTERVAL_MS)} end\n")
+
+    print(f"Control file written: {MIXED_CONTROL_FILENAME}")
+
+
 def convert_wav_to_mp3():
     """
     Convert the generated WAV to MP3 using system ffmpeg.
@@ -107,5 +141,6 @@ def convert_wav_to_mp3():
 if __name__ == "__main__":
     generate_metronome_wav()
     generate_control_file()
+    generate_mixed_control_file()
     convert_wav_to_mp3()
 